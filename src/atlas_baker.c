@@ -0,0 +1,225 @@
+/*
+ * Atlas Baker Implementation
+ *
+ * Collects the app's source text, shapes it with each font at each size
+ * found, and saves whatever the font cache rasterized.
+ */
+
+#include "atlas_baker.h"
+#include "font_cache.h"
+#include "file_map.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <math.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+/* Same page size and glyph limit as the renderer's font cache; atlases
+ * baked with another page size are ignored at load */
+#define BAKE_ATLAS_SIZE 512
+#define BAKE_MAX_GLYPHS 2048
+
+#define MAX_BAKE_FONTS  16
+#define MAX_BAKE_SIZES  32
+#define MAX_SCAN_DEPTH  16
+#define MAX_PATH_LEN    1024
+
+/* Sizes of the default stylesheet: body text first, then h1-h6 */
+static const float DEFAULT_SIZES[] = { 16.0f, 32.0f, 24.0f, 18.72f, 13.28f, 10.72f };
+
+/* ============================================================================
+ * Source Scanning
+ * ============================================================================ */
+
+typedef struct {
+    char  *text;                    /* All sources, concatenated */
+    size_t len;
+    size_t capacity;
+    float  sizes[MAX_BAKE_SIZES];   /* In order of first appearance */
+    int    size_count;
+} BakeSources;
+
+static bool is_source_file(const char *name) {
+    const char *dot = strrchr(name, '.');
+    if (!dot) return false;
+    return strcasecmp(dot, ".html") == 0 || strcasecmp(dot, ".htm") == 0 ||
+           strcasecmp(dot, ".css") == 0 || strcasecmp(dot, ".js") == 0 ||
+           strcasecmp(dot, ".mjs") == 0 || strcasecmp(dot, ".json") == 0;
+}
+
+static void append_file(BakeSources *src, const char *path) {
+    MinirendFileMap *map = minirend_file_map_open(path);
+    if (!map) return;
+
+    size_t size = 0;
+    const uint8_t *data = minirend_file_map_data(map, &size);
+
+    /* Room for a separating newline and the terminator */
+    size_t needed = src->len + size + 2;
+    if (needed > src->capacity) {
+        size_t new_cap = src->capacity ? src->capacity : 64 * 1024;
+        while (new_cap < needed) new_cap *= 2;
+        char *text = realloc(src->text, new_cap);
+        if (!text) {
+            minirend_file_map_close(map);
+            return;
+        }
+        src->text = text;
+        src->capacity = new_cap;
+    }
+
+    memcpy(src->text + src->len, data, size);
+    src->len += size;
+    src->text[src->len++] = '\n';
+    src->text[src->len] = '\0';
+    minirend_file_map_close(map);
+}
+
+static void scan_dir(BakeSources *src, const char *dir, int depth) {
+    if (depth > MAX_SCAN_DEPTH) return;
+
+    DIR *d = opendir(dir);
+    if (!d) return;
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+
+        char path[MAX_PATH_LEN];
+        int n = snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (n < 0 || n >= (int)sizeof(path)) continue;
+
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            scan_dir(src, path, depth + 1);
+        } else if (S_ISREG(st.st_mode) && is_source_file(entry->d_name)) {
+            append_file(src, path);
+        }
+    }
+    closedir(d);
+}
+
+static void add_size(BakeSources *src, float size) {
+    if (size < 4.0f || size > 256.0f) return;
+
+    /* The cache keys sizes by half pixel */
+    for (int i = 0; i < src->size_count; i++) {
+        if (fabsf(src->sizes[i] - size) < 0.25f) return;
+    }
+    if (src->size_count < MAX_BAKE_SIZES) {
+        src->sizes[src->size_count++] = size;
+    }
+}
+
+/* Font sizes set in CSS or script: "font-size: 14px", "fontSize = '1.5rem'"
+ * (em/rem against the 16px default) */
+static void scan_sizes(BakeSources *src) {
+    static const char *const keys[] = { "font-size", "fontSize" };
+
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) {
+        const char *p = src->text;
+        while ((p = strstr(p, keys[k])) != NULL) {
+            p += strlen(keys[k]);
+            while (*p && strchr(" \t:='\"", *p)) p++;
+
+            char *end;
+            float value = strtof(p, &end);
+            if (end == p) continue;
+
+            if (strncmp(end, "px", 2) == 0) {
+                add_size(src, value);
+            } else if (strncmp(end, "rem", 3) == 0 || strncmp(end, "em", 2) == 0) {
+                add_size(src, value * 16.0f);
+            }
+            p = end;
+        }
+    }
+}
+
+/* ============================================================================
+ * Baking
+ * ============================================================================ */
+
+bool minirend_atlas_bake(const char *app_dir,
+                         const char *const *font_paths, int font_count,
+                         const char *out_path) {
+    if (!app_dir || !font_paths || font_count <= 0 || !out_path) return false;
+
+    MinirendFontCache *cache = minirend_font_cache_create(BAKE_ATLAS_SIZE, BAKE_MAX_GLYPHS);
+    if (!cache) return false;
+
+    /* Start empty, even if this executable already carries an atlas */
+    minirend_font_cache_clear(cache);
+
+    int fonts[MAX_BAKE_FONTS];
+    if (font_count > MAX_BAKE_FONTS) font_count = MAX_BAKE_FONTS;
+    for (int i = 0; i < font_count; i++) {
+        fonts[i] = minirend_font_cache_load_font(cache, font_paths[i]);
+        if (fonts[i] < 0) {
+            fprintf(stderr, "[atlas] Failed to load font: %s\n", font_paths[i]);
+            minirend_font_cache_destroy(cache);
+            return false;
+        }
+    }
+
+    BakeSources src = {0};
+    for (size_t i = 0; i < sizeof(DEFAULT_SIZES) / sizeof(DEFAULT_SIZES[0]); i++) {
+        add_size(&src, DEFAULT_SIZES[i]);
+    }
+    scan_dir(&src, app_dir, 0);
+    if (!src.text) {
+        fprintf(stderr, "[atlas] No HTML, CSS or JS found under %s\n", app_dir);
+        minirend_font_cache_destroy(cache);
+        return false;
+    }
+    scan_sizes(&src);
+
+    /* Everything is rasterized within one frame, so nothing is evicted;
+     * once the cache is full the remaining (least likely) sizes are
+     * left to runtime */
+    bool full = false;
+    int sizes_baked = 0;
+    for (int s = 0; s < src.size_count && !full; s++) {
+        for (int f = 0; f < font_count && !full; f++) {
+            MinirendShapedRun run;
+            if (!minirend_font_cache_shape(cache, fonts[f], src.text, (int32_t)src.len,
+                                           src.sizes[s], &run)) {
+                continue;
+            }
+            for (int i = 0; i < run.glyph_count; i++) {
+                MinirendGlyph glyph;
+                if (!minirend_font_cache_get_glyph_by_index(cache, run.glyphs[i].font_id,
+                                                            run.glyphs[i].glyph,
+                                                            src.sizes[s], &glyph)) {
+                    full = true;
+                    break;
+                }
+            }
+        }
+        if (!full) sizes_baked++;
+    }
+
+    bool ok = minirend_font_cache_save_atlas(cache, out_path);
+
+    MinirendFontCacheStats stats;
+    minirend_font_cache_get_stats(cache, &stats);
+    if (ok) {
+        fprintf(stderr, "[atlas] Baked %d glyphs at %d of %d sizes into %s (%d pages)\n",
+                stats.glyph_count, sizes_baked, src.size_count, out_path,
+                stats.page_count);
+    } else {
+        fprintf(stderr, "[atlas] Failed to write %s\n", out_path);
+    }
+
+    free(src.text);
+    minirend_font_cache_destroy(cache);
+    return ok;
+}
@@ -0,0 +1,25 @@
+#ifndef MINIREND_ATLAS_BAKER_H
+#define MINIREND_ATLAS_BAKER_H
+
+/*
+ * Atlas Baker - Build-time glyph prerasterization.
+ *
+ * Scans an app's HTML, CSS and JS for the characters and font sizes it
+ * uses, rasterizes those glyphs with the font cache and saves the atlas
+ * (minirend_font_cache_save_atlas). Shipped as app/font_atlas.bin, it is
+ * loaded by every font cache at startup, so the first frame draws its
+ * text without rasterizing.
+ *
+ * Run by the Makefile as:  minirend --bake-atlas out.bin app/ font.ttf...
+ */
+
+#include <stdbool.h>
+
+/* Bake the glyphs used under app_dir in each of the given fonts into
+ * out_path. Returns false if a font cannot be loaded or the file cannot
+ * be written. */
+bool minirend_atlas_bake(const char *app_dir,
+                         const char *const *font_paths, int font_count,
+                         const char *out_path);
+
+#endif /* MINIREND_ATLAS_BAKER_H */
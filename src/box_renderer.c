@@ -5,6 +5,8 @@
  */
 
 #include "box_renderer.h"
+#include "stream_buffer.h"
+#include "soft_raster.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -26,7 +28,7 @@
  * ============================================================================ */
 
 typedef struct {
-    float x, y;           /* Position */
+    float x, y, z;        /* Position, z = depth (0 nearest, 1 farthest) */
     float r, g, b, a;     /* Color (normalized 0-1) */
 } BoxVertex;
 
@@ -38,13 +40,13 @@ typedef struct {
 static const char *vs_source_glsl330 =
     "#version 330\n"
     "uniform vec2 u_viewport;\n"
-    "in vec2 a_pos;\n"
+    "in vec3 a_pos;\n"
     "in vec4 a_color;\n"
     "out vec4 v_color;\n"
     "void main() {\n"
-    "    vec2 pos = a_pos / u_viewport * 2.0 - 1.0;\n"
+    "    vec2 pos = a_pos.xy / u_viewport * 2.0 - 1.0;\n"
     "    pos.y = -pos.y;\n"  /* Flip Y for screen coords */
-    "    gl_Position = vec4(pos, 0.0, 1.0);\n"
+    "    gl_Position = vec4(pos, a_pos.z, 1.0);\n"
     "    v_color = a_color;\n"
     "}\n";
 
@@ -61,13 +63,13 @@ static const char *fs_source_glsl330 =
 static const char *vs_source_glsl100 =
     "#version 100\n"
     "uniform vec2 u_viewport;\n"
-    "attribute vec2 a_pos;\n"
+    "attribute vec3 a_pos;\n"
     "attribute vec4 a_color;\n"
     "varying vec4 v_color;\n"
     "void main() {\n"
-    "    vec2 pos = a_pos / u_viewport * 2.0 - 1.0;\n"
+    "    vec2 pos = a_pos.xy / u_viewport * 2.0 - 1.0;\n"
     "    pos.y = -pos.y;\n"
-    "    gl_Position = vec4(pos, 0.0, 1.0);\n"
+    "    gl_Position = vec4(pos, a_pos.z, 1.0);\n"
     "    v_color = a_color;\n"
     "}\n";
 
@@ -84,9 +86,14 @@ static const char *fs_source_glsl100 =
  * ============================================================================ */
 
 struct MinirendBoxRenderer {
+    MinirendSoftRaster *soft;  /* CPU backend (borrowed); NULL for sokol_gfx */
+    
     sg_shader     shader;
     sg_pipeline   pipeline;
-    sg_buffer     vbuf;
+    sg_pipeline   layer_pipeline;  /* Same state, compositor layer target */
+    sg_pipeline   opaque_pipeline;
+    sg_pipeline   layer_opaque_pipeline;
+    MinirendStreamBuffer *vstream;
     sg_buffer     ibuf;
     sg_bindings   bindings;
     
@@ -97,7 +104,11 @@ struct MinirendBoxRenderer {
     float         viewport_width;
     float         viewport_height;
     
+    float         depth;
+    
     bool          in_frame;
+    bool          to_layer;
+    bool          opaque;
     bool          scissor_active;
 };
 
@@ -156,7 +167,7 @@ MinirendBoxRenderer *minirend_box_renderer_create(void) {
         .shader = r->shader,
         .layout = {
             .attrs = {
-                [0] = { .format = SG_VERTEXFORMAT_FLOAT2 },   /* a_pos */
+                [0] = { .format = SG_VERTEXFORMAT_FLOAT3 },   /* a_pos */
                 [1] = { .format = SG_VERTEXFORMAT_FLOAT4 },   /* a_color */
             },
         },
@@ -171,18 +182,34 @@ MinirendBoxRenderer *minirend_box_renderer_create(void) {
         },
         .depth = {
             .write_enabled = false,
-            .compare = SG_COMPAREFUNC_ALWAYS,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
         },
         .primitive_type = SG_PRIMITIVETYPE_TRIANGLES,
     };
     
     r->pipeline = sg_make_pipeline(&pipeline_desc);
     
-    /* Create dynamic vertex buffer */
-    r->vbuf = sg_make_buffer(&(sg_buffer_desc){
-        .size = MAX_QUADS * VERTICES_PER_QUAD * sizeof(BoxVertex),
-        .usage = SG_USAGE_STREAM,
-    });
+    /* Opaque variant: no blending, writes depth so that content behind it
+     * fails the depth test */
+    sg_pipeline_desc opaque_desc = pipeline_desc;
+    opaque_desc.colors[0].blend.enabled = false;
+    opaque_desc.depth.write_enabled = true;
+    r->opaque_pipeline = sg_make_pipeline(&opaque_desc);
+    
+    /* Layer passes render into single-sampled RGBA8 + depth targets */
+    pipeline_desc.sample_count = 1;
+    pipeline_desc.colors[0].pixel_format = SG_PIXELFORMAT_RGBA8;
+    pipeline_desc.depth.pixel_format = SG_PIXELFORMAT_DEPTH;
+    r->layer_pipeline = sg_make_pipeline(&pipeline_desc);
+    
+    opaque_desc.sample_count = 1;
+    opaque_desc.colors[0].pixel_format = SG_PIXELFORMAT_RGBA8;
+    opaque_desc.depth.pixel_format = SG_PIXELFORMAT_DEPTH;
+    r->layer_opaque_pipeline = sg_make_pipeline(&opaque_desc);
+    
+    /* Create streaming vertex buffer (one batch's worth to start, grows) */
+    r->vstream = minirend_stream_buffer_create(
+        MAX_QUADS * VERTICES_PER_QUAD * sizeof(BoxVertex));
     
     /* Create static index buffer */
     uint16_t *indices = calloc(MAX_QUADS * INDICES_PER_QUAD, sizeof(uint16_t));
@@ -206,18 +233,42 @@ MinirendBoxRenderer *minirend_box_renderer_create(void) {
         free(indices);
     }
     
-    /* Set up bindings */
-    r->bindings.vertex_buffers[0] = r->vbuf;
+    /* Set up bindings (vertex buffer/offset are set per flush) */
     r->bindings.index_buffer = r->ibuf;
     
     return r;
 }
 
+MinirendBoxRenderer *minirend_box_renderer_create_soft(MinirendSoftRaster *raster) {
+    if (!raster) return NULL;
+    
+    MinirendBoxRenderer *r = calloc(1, sizeof(MinirendBoxRenderer));
+    if (!r) return NULL;
+    
+    r->vertices = calloc(MAX_QUADS * VERTICES_PER_QUAD, sizeof(BoxVertex));
+    if (!r->vertices) {
+        free(r);
+        return NULL;
+    }
+    
+    r->soft = raster;
+    return r;
+}
+
 void minirend_box_renderer_destroy(MinirendBoxRenderer *r) {
     if (!r) return;
     
-    sg_destroy_buffer(r->vbuf);
+    if (r->soft) {
+        free(r->vertices);
+        free(r);
+        return;
+    }
+    
+    minirend_stream_buffer_destroy(r->vstream);
     sg_destroy_buffer(r->ibuf);
+    sg_destroy_pipeline(r->layer_opaque_pipeline);
+    sg_destroy_pipeline(r->opaque_pipeline);
+    sg_destroy_pipeline(r->layer_pipeline);
     sg_destroy_pipeline(r->pipeline);
     sg_destroy_shader(r->shader);
     
@@ -237,29 +288,69 @@ void minirend_box_renderer_begin(MinirendBoxRenderer *r,
     r->viewport_height = viewport_height;
     r->vertex_count = 0;
     r->quad_count = 0;
+    r->depth = 0.0f;
     r->in_frame = true;
+    r->to_layer = false;
+    r->opaque = false;
     r->scissor_active = false;
 }
 
+void minirend_box_renderer_begin_layer(MinirendBoxRenderer *r,
+                                       float width, float height) {
+    if (!r) return;
+    
+    minirend_box_renderer_begin(r, width, height);
+    r->to_layer = true;
+}
+
+static sg_pipeline current_pipeline(const MinirendBoxRenderer *r) {
+    if (r->to_layer) {
+        return r->opaque ? r->layer_opaque_pipeline : r->layer_pipeline;
+    }
+    return r->opaque ? r->opaque_pipeline : r->pipeline;
+}
+
+/* Hand the batched quads to the CPU rasterizer. Quads are axis-aligned
+ * with a flat color: vertex 0 is top-left, vertex 2 bottom-right. */
+static void flush_batch_soft(MinirendBoxRenderer *r) {
+    for (int q = 0; q < r->quad_count; q++) {
+        const BoxVertex *v = &r->vertices[q * VERTICES_PER_QUAD];
+        minirend_soft_raster_fill_rect(r->soft, v[0].x, v[0].y, v[2].x, v[2].y,
+                                       v[0].z, r->opaque,
+                                       v[0].r, v[0].g, v[0].b, v[0].a);
+    }
+}
+
 static void flush_batch(MinirendBoxRenderer *r) {
     if (!r || r->quad_count == 0) return;
     
-    /* Upload vertices */
-    sg_update_buffer(r->vbuf, &(sg_range){
-        .ptr = r->vertices,
-        .size = r->vertex_count * sizeof(BoxVertex),
-    });
-    
-    /* Apply pipeline and bindings */
-    sg_apply_pipeline(r->pipeline);
-    sg_apply_bindings(&r->bindings);
-    
-    /* Set viewport uniform */
-    float viewport[2] = { r->viewport_width, r->viewport_height };
-    sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, &SG_RANGE(viewport));
+    if (r->soft) {
+        flush_batch_soft(r);
+        r->vertex_count = 0;
+        r->quad_count = 0;
+        return;
+    }
     
-    /* Draw */
-    sg_draw(0, r->quad_count * INDICES_PER_QUAD, 1);
+    /* Upload vertices as a new segment of the per-frame stream */
+    uint32_t vbuf_id = 0;
+    int vbuf_offset = 0;
+    if (minirend_stream_buffer_append(r->vstream, r->vertices,
+                                      r->vertex_count * sizeof(BoxVertex),
+                                      &vbuf_id, &vbuf_offset)) {
+        r->bindings.vertex_buffers[0] = (sg_buffer){ vbuf_id };
+        r->bindings.vertex_buffer_offsets[0] = vbuf_offset;
+        
+        /* Apply pipeline and bindings */
+        sg_apply_pipeline(current_pipeline(r));
+        sg_apply_bindings(&r->bindings);
+        
+        /* Set viewport uniform */
+        float viewport[2] = { r->viewport_width, r->viewport_height };
+        sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, &SG_RANGE(viewport));
+        
+        /* Draw */
+        sg_draw(0, r->quad_count * INDICES_PER_QUAD, 1);
+    }
     
     /* Reset batch */
     r->vertex_count = 0;
@@ -286,21 +377,22 @@ static void push_quad(MinirendBoxRenderer *r,
     }
     
     BoxVertex *v = &r->vertices[r->vertex_count];
+    float z = r->depth;
     
     /* Top-left */
-    v[0].x = x0; v[0].y = y0;
+    v[0].x = x0; v[0].y = y0; v[0].z = z;
     v[0].r = cr; v[0].g = cg; v[0].b = cb; v[0].a = ca;
     
     /* Top-right */
-    v[1].x = x1; v[1].y = y0;
+    v[1].x = x1; v[1].y = y0; v[1].z = z;
     v[1].r = cr; v[1].g = cg; v[1].b = cb; v[1].a = ca;
     
     /* Bottom-right */
-    v[2].x = x1; v[2].y = y1;
+    v[2].x = x1; v[2].y = y1; v[2].z = z;
     v[2].r = cr; v[2].g = cg; v[2].b = cb; v[2].a = ca;
     
     /* Bottom-left */
-    v[3].x = x0; v[3].y = y1;
+    v[3].x = x0; v[3].y = y1; v[3].z = z;
     v[3].r = cr; v[3].g = cg; v[3].b = cb; v[3].a = ca;
     
     r->vertex_count += 4;
@@ -378,6 +470,19 @@ void minirend_box_draw_rounded_border(MinirendBoxRenderer *r,
                              border_width, border_width, color);
 }
 
+void minirend_box_set_depth(MinirendBoxRenderer *r, float depth) {
+    if (!r) return;
+    r->depth = depth;
+}
+
+void minirend_box_set_opaque(MinirendBoxRenderer *r, bool opaque) {
+    if (!r || r->opaque == opaque) return;
+    
+    /* Flush current batch before switching pipelines */
+    flush_batch(r);
+    r->opaque = opaque;
+}
+
 void minirend_box_set_scissor(MinirendBoxRenderer *r,
                               float x, float y, float width, float height) {
     if (!r) return;
@@ -385,7 +490,11 @@ void minirend_box_set_scissor(MinirendBoxRenderer *r,
     /* Flush current batch before changing scissor */
     flush_batch(r);
     
-    sg_apply_scissor_rect((int)x, (int)y, (int)width, (int)height, true);
+    if (r->soft) {
+        minirend_soft_raster_set_scissor(r->soft, (int)x, (int)y, (int)width, (int)height);
+    } else {
+        sg_apply_scissor_rect((int)x, (int)y, (int)width, (int)height, true);
+    }
     r->scissor_active = true;
 }
 
@@ -395,7 +504,11 @@ void minirend_box_clear_scissor(MinirendBoxRenderer *r) {
     /* Flush current batch before changing scissor */
     flush_batch(r);
     
-    sg_apply_scissor_rect(0, 0, (int)r->viewport_width, (int)r->viewport_height, true);
+    if (r->soft) {
+        minirend_soft_raster_clear_scissor(r->soft);
+    } else {
+        sg_apply_scissor_rect(0, 0, (int)r->viewport_width, (int)r->viewport_height, true);
+    }
     r->scissor_active = false;
 }
 
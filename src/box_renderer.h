@@ -4,7 +4,8 @@
 /*
  * Box Renderer - Draws rectangles, backgrounds, and borders using sokol_gfx.
  *
- * Uses batched quad rendering with a simple color shader.
+ * Uses batched quad rendering with a simple color shader, or the CPU
+ * rasterizer (soft_raster.h) for headless rendering.
  */
 
 #include <stddef.h>
@@ -13,6 +14,9 @@
 
 #include "style_resolver.h"  /* For MinirendColor */
 
+/* Forward declarations */
+typedef struct MinirendSoftRaster MinirendSoftRaster;
+
 /* ============================================================================
  * Box Renderer Context
  * ============================================================================ */
@@ -22,6 +26,10 @@ typedef struct MinirendBoxRenderer MinirendBoxRenderer;
 /* Create the box renderer. Must be called after sokol_gfx is initialized. */
 MinirendBoxRenderer *minirend_box_renderer_create(void);
 
+/* Create a box renderer that rasterizes on the CPU into `raster`
+ * (borrowed, not owned). Needs no graphics context. */
+MinirendBoxRenderer *minirend_box_renderer_create_soft(MinirendSoftRaster *raster);
+
 /* Destroy the box renderer and free GPU resources. */
 void minirend_box_renderer_destroy(MinirendBoxRenderer *renderer);
 
@@ -29,6 +37,12 @@ void minirend_box_renderer_destroy(MinirendBoxRenderer *renderer);
 void minirend_box_renderer_begin(MinirendBoxRenderer *renderer,
                                  float viewport_width, float viewport_height);
 
+/* Begin drawing into a compositor layer instead of the swapchain.
+ * Call inside minirend_compositor_begin_layer(); width/height are the
+ * layer's texture size. Finish with minirend_box_renderer_end(). */
+void minirend_box_renderer_begin_layer(MinirendBoxRenderer *renderer,
+                                       float width, float height);
+
 /* End the frame and flush all batched draws. */
 void minirend_box_renderer_end(MinirendBoxRenderer *renderer);
 
@@ -59,6 +73,15 @@ void minirend_box_draw_rounded_border(MinirendBoxRenderer *renderer,
                                       float border_width,
                                       MinirendColor color, float radius);
 
+/* Set the depth of subsequent quads (0 = nearest, 1 = farthest; default 0).
+ * Quads are depth tested against opaque content with LESS_EQUAL. */
+void minirend_box_set_depth(MinirendBoxRenderer *renderer, float depth);
+
+/* Switch between blended drawing (default) and opaque drawing. Opaque
+ * quads are drawn without blending and write depth, so drawing them
+ * front-to-back lets the depth test reject hidden pixels. */
+void minirend_box_set_opaque(MinirendBoxRenderer *renderer, bool opaque);
+
 /* Set scissor rectangle for clipping. */
 void minirend_box_set_scissor(MinirendBoxRenderer *renderer,
                               float x, float y, float width, float height);
@@ -16,15 +16,41 @@
  * ============================================================================ */
 
 #define MAX_LAYERS 64
+#define MAX_SURFACES 128
+#define MIN_SURFACE_SIZE 64
+#define DEFAULT_MEMORY_BUDGET (64u * 1024u * 1024u)
+
+/* ============================================================================
+ * Render Target Pool
+ * ============================================================================ */
+
+/* A color + depth render target of one size class */
+typedef struct {
+    sg_image       color;
+    sg_image       depth;
+    sg_attachments attachments;
+    int            width;
+    int            height;
+    size_t         bytes;
+    uint64_t       last_used;  /* Pool tick when last released */
+    bool           alive;
+    bool           in_use;
+} LayerSurface;
 
 /* ============================================================================
  * Compositor Structure
  * ============================================================================ */
 
 struct MinirendCompositor {
-    /* Layers */
-    MinirendLayer *layers[MAX_LAYERS];
-    int            layer_count;
+    /* Layers (fixed storage, no per-layer heap allocation) */
+    MinirendLayer layers[MAX_LAYERS];
+    bool          layer_used[MAX_LAYERS];
+    
+    /* Render target pool */
+    LayerSurface surfaces[MAX_SURFACES];
+    uint64_t     pool_tick;
+    size_t       pool_budget;
+    MinirendCompositorPoolStats stats;
     
     /* Current render target stack */
     MinirendLayer *layer_stack[16];
@@ -52,12 +78,13 @@ struct MinirendCompositor {
 static const char *comp_vs_glsl330 =
     "#version 330\n"
     "uniform mat4 u_mvp;\n"
+    "uniform vec4 u_uv_rect;\n"
     "in vec2 a_pos;\n"
     "in vec2 a_uv;\n"
     "out vec2 v_uv;\n"
     "void main() {\n"
     "    gl_Position = u_mvp * vec4(a_pos, 0.0, 1.0);\n"
-    "    v_uv = a_uv;\n"
+    "    v_uv = u_uv_rect.xy + a_uv * u_uv_rect.zw;\n"
     "}\n";
 
 static const char *comp_fs_glsl330 =
@@ -67,10 +94,190 @@ static const char *comp_fs_glsl330 =
     "in vec2 v_uv;\n"
     "out vec4 frag_color;\n"
     "void main() {\n"
-    "    vec4 color = texture(u_texture, v_uv);\n"
-    "    frag_color = vec4(color.rgb, color.a * u_opacity);\n"
+    "    frag_color = texture(u_texture, v_uv) * u_opacity;\n"
     "}\n";
 
+/* ============================================================================
+ * Render Target Pool
+ * ============================================================================ */
+
+/* Round a dimension up to its size class: powers of two and the midpoints
+ * between them (64, 96, 128, 192, 256, ...), so reuse wastes < 50%. */
+static int size_class(int v) {
+    int size = MIN_SURFACE_SIZE;
+    while (size < v) {
+        int mid = size + size / 2;
+        if (mid >= v) return mid;
+        size *= 2;
+    }
+    return size;
+}
+
+static void destroy_surface(MinirendCompositor *c, int index) {
+    LayerSurface *surf = &c->surfaces[index];
+    
+    sg_destroy_attachments(surf->attachments);
+    sg_destroy_image(surf->color);
+    sg_destroy_image(surf->depth);
+    
+    c->stats.surfaces_total--;
+    c->stats.bytes_total -= surf->bytes;
+    memset(surf, 0, sizeof(*surf));
+}
+
+/* Destroy the least-recently-used free target. Returns false if every
+ * target is backing a live layer. */
+static bool evict_lru(MinirendCompositor *c) {
+    int victim = -1;
+    for (int i = 0; i < MAX_SURFACES; i++) {
+        LayerSurface *surf = &c->surfaces[i];
+        if (!surf->alive || surf->in_use) continue;
+        if (victim < 0 || surf->last_used < c->surfaces[victim].last_used) {
+            victim = i;
+        }
+    }
+    if (victim < 0) return false;
+    
+    destroy_surface(c, victim);
+    c->stats.evictions++;
+    return true;
+}
+
+/* Evict free targets until `incoming` more bytes fit in the budget, or
+ * nothing free is left. */
+static void evict_to_budget(MinirendCompositor *c, size_t incoming) {
+    while (c->stats.bytes_total + incoming > c->pool_budget) {
+        if (!evict_lru(c)) return;
+    }
+}
+
+static int find_dead_surface(const MinirendCompositor *c) {
+    for (int i = 0; i < MAX_SURFACES; i++) {
+        if (!c->surfaces[i].alive) return i;
+    }
+    return -1;
+}
+
+static int create_surface(MinirendCompositor *c, int width, int height) {
+    size_t bytes = (size_t)width * (size_t)height * 8;  /* RGBA8 + depth */
+    evict_to_budget(c, bytes);
+    
+    /* Slots exhausted: make room by dropping the oldest free target */
+    int index = find_dead_surface(c);
+    if (index < 0 && evict_lru(c)) {
+        index = find_dead_surface(c);
+    }
+    if (index < 0) return -1;
+    
+    LayerSurface *surf = &c->surfaces[index];
+    
+    /* Create render target texture */
+    surf->color = sg_make_image(&(sg_image_desc){
+        .render_target = true,
+        .width = width,
+        .height = height,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+    });
+    
+    /* Create depth buffer */
+    surf->depth = sg_make_image(&(sg_image_desc){
+        .render_target = true,
+        .width = width,
+        .height = height,
+        .pixel_format = SG_PIXELFORMAT_DEPTH,
+    });
+    
+    /* Create framebuffer attachments */
+    surf->attachments = sg_make_attachments(&(sg_attachments_desc){
+        .colors[0].image = surf->color,
+        .depth_stencil.image = surf->depth,
+    });
+    
+    /* Pool exhausted or creation failed: the slot stays dead */
+    if (sg_query_image_state(surf->color) != SG_RESOURCESTATE_VALID ||
+        sg_query_image_state(surf->depth) != SG_RESOURCESTATE_VALID ||
+        sg_query_attachments_state(surf->attachments) != SG_RESOURCESTATE_VALID) {
+        sg_destroy_attachments(surf->attachments);
+        sg_destroy_image(surf->color);
+        sg_destroy_image(surf->depth);
+        memset(surf, 0, sizeof(*surf));
+        return -1;
+    }
+    
+    surf->width = width;
+    surf->height = height;
+    surf->bytes = bytes;
+    surf->alive = true;
+    
+    c->stats.surfaces_total++;
+    c->stats.bytes_total += bytes;
+    return index;
+}
+
+/* Take a free target of the size class, or create one. */
+static int acquire_surface(MinirendCompositor *c, int width, int height) {
+    int cw = size_class(width);
+    int ch = size_class(height);
+    
+    /* Prefer the most recently released target: its memory is warmest */
+    int best = -1;
+    for (int i = 0; i < MAX_SURFACES; i++) {
+        LayerSurface *surf = &c->surfaces[i];
+        if (!surf->alive || surf->in_use) continue;
+        if (surf->width != cw || surf->height != ch) continue;
+        if (best < 0 || surf->last_used > c->surfaces[best].last_used) {
+            best = i;
+        }
+    }
+    
+    if (best >= 0) {
+        c->stats.hits++;
+    } else {
+        best = create_surface(c, cw, ch);
+        if (best < 0) return -1;
+        c->stats.misses++;
+    }
+    
+    c->surfaces[best].in_use = true;
+    c->stats.surfaces_in_use++;
+    c->stats.bytes_in_use += c->surfaces[best].bytes;
+    return best;
+}
+
+static void release_surface(MinirendCompositor *c, int index) {
+    if (index < 0 || index >= MAX_SURFACES) return;
+    
+    LayerSurface *surf = &c->surfaces[index];
+    if (!surf->alive || !surf->in_use) return;
+    
+    surf->in_use = false;
+    surf->last_used = ++c->pool_tick;
+    c->stats.surfaces_in_use--;
+    c->stats.bytes_in_use -= surf->bytes;
+    
+    evict_to_budget(c, 0);
+}
+
+void minirend_compositor_set_memory_budget(MinirendCompositor *c, size_t bytes) {
+    if (!c) return;
+    
+    c->pool_budget = bytes;
+    evict_to_budget(c, 0);
+}
+
+void minirend_compositor_get_pool_stats(const MinirendCompositor *c,
+                                        MinirendCompositorPoolStats *out_stats) {
+    if (!out_stats) return;
+    
+    if (!c) {
+        memset(out_stats, 0, sizeof(*out_stats));
+        return;
+    }
+    
+    *out_stats = c->stats;
+    out_stats->bytes_budget = c->pool_budget;
+}
+
 /* ============================================================================
  * Create/Destroy
  * ============================================================================ */
@@ -84,8 +291,9 @@ MinirendCompositor *minirend_compositor_create(void) {
         .vs = {
             .source = comp_vs_glsl330,
             .uniform_blocks[0] = {
-                .size = 64,  /* mat4 */
+                .size = 80,  /* mat4 + vec4 */
                 .uniforms[0] = { .name = "u_mvp", .type = SG_UNIFORMTYPE_MAT4 },
+                .uniforms[1] = { .name = "u_uv_rect", .type = SG_UNIFORMTYPE_FLOAT4 },
             },
         },
         .fs = {
@@ -118,7 +326,8 @@ MinirendCompositor *minirend_compositor_create(void) {
     
     c->comp_shader = sg_make_shader(&shader_desc);
     
-    /* Create pipeline */
+    /* Create pipeline. Layer content is rendered over transparent black
+     * and therefore holds premultiplied color. */
     c->comp_pipeline = sg_make_pipeline(&(sg_pipeline_desc){
         .shader = c->comp_shader,
         .layout = {
@@ -130,11 +339,16 @@ MinirendCompositor *minirend_compositor_create(void) {
         .colors[0] = {
             .blend = {
                 .enabled = true,
-                .src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA,
+                .src_factor_rgb = SG_BLENDFACTOR_ONE,
                 .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                .src_factor_alpha = SG_BLENDFACTOR_ONE,
+                .dst_factor_alpha = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
             },
         },
-        .depth.write_enabled = false,
+        .depth = {
+            .write_enabled = false,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
+        },
     });
     
     /* Create quad vertex buffer */
@@ -162,6 +376,8 @@ MinirendCompositor *minirend_compositor_create(void) {
         .mag_filter = SG_FILTER_LINEAR,
     });
     
+    c->pool_budget = DEFAULT_MEMORY_BUDGET;
+    
     /* Layer pass action (clear to transparent) */
     c->layer_pass_action = (sg_pass_action){
         .colors[0] = {
@@ -176,10 +392,10 @@ MinirendCompositor *minirend_compositor_create(void) {
 void minirend_compositor_destroy(MinirendCompositor *c) {
     if (!c) return;
     
-    /* Destroy all layers */
-    for (int i = 0; i < c->layer_count; i++) {
-        if (c->layers[i]) {
-            minirend_compositor_destroy_layer(c, c->layers[i]);
+    /* Destroy all render targets (live layers included) */
+    for (int i = 0; i < MAX_SURFACES; i++) {
+        if (c->surfaces[i].alive) {
+            destroy_surface(c, i);
         }
     }
     
@@ -220,45 +436,41 @@ void minirend_compositor_end(MinirendCompositor *c) {
 
 MinirendLayer *minirend_compositor_create_layer(MinirendCompositor *c,
                                                 float width, float height) {
-    if (!c || c->layer_count >= MAX_LAYERS) return NULL;
+    if (!c || width < 1.0f || height < 1.0f) return NULL;
     
-    MinirendLayer *layer = calloc(1, sizeof(MinirendLayer));
-    if (!layer) return NULL;
+    int slot = -1;
+    for (int i = 0; i < MAX_LAYERS; i++) {
+        if (!c->layer_used[i]) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) return NULL;
     
-    layer->width = width;
-    layer->height = height;
-    layer->opacity = 1.0f;
-    layer->transform = minirend_transform_identity();
+    int iwidth = (int)ceilf(width);
+    int iheight = (int)ceilf(height);
     
-    int iwidth = (int)width;
-    int iheight = (int)height;
+    int surface = acquire_surface(c, iwidth, iheight);
+    if (surface < 0) return NULL;
     
-    /* Create render target texture */
-    layer->texture = sg_make_image(&(sg_image_desc){
-        .render_target = true,
-        .width = iwidth,
-        .height = iheight,
-        .pixel_format = SG_PIXELFORMAT_RGBA8,
-    }).id;
+    LayerSurface *surf = &c->surfaces[surface];
     
-    /* Create depth buffer */
-    layer->depth_buffer = sg_make_image(&(sg_image_desc){
-        .render_target = true,
-        .width = iwidth,
-        .height = iheight,
-        .pixel_format = SG_PIXELFORMAT_DEPTH,
-    }).id;
+    MinirendLayer *layer = &c->layers[slot];
+    memset(layer, 0, sizeof(*layer));
     
-    /* Create framebuffer attachments */
-    sg_attachments_desc att_desc = {
-        .colors[0].image = (sg_image){ layer->texture },
-        .depth_stencil.image = (sg_image){ layer->depth_buffer },
-    };
-    layer->framebuffer = sg_make_attachments(&att_desc).id;
+    layer->width = width;
+    layer->height = height;
+    layer->opacity = 1.0f;
+    layer->transform = minirend_transform_identity();
     
-    /* Add to layer list */
-    c->layers[c->layer_count++] = layer;
+    layer->framebuffer = surf->attachments.id;
+    layer->texture = surf->color.id;
+    layer->depth_buffer = surf->depth.id;
+    layer->texture_width = (float)surf->width;
+    layer->texture_height = (float)surf->height;
+    layer->surface = surface;
     
+    c->layer_used[slot] = true;
     return layer;
 }
 
@@ -266,20 +478,12 @@ void minirend_compositor_destroy_layer(MinirendCompositor *c,
                                        MinirendLayer *layer) {
     if (!c || !layer) return;
     
-    /* Remove from layer list */
-    for (int i = 0; i < c->layer_count; i++) {
-        if (c->layers[i] == layer) {
-            c->layers[i] = c->layers[--c->layer_count];
-            break;
-        }
-    }
-    
-    /* Destroy resources */
-    sg_destroy_attachments((sg_attachments){ layer->framebuffer });
-    sg_destroy_image((sg_image){ layer->texture });
-    sg_destroy_image((sg_image){ layer->depth_buffer });
+    ptrdiff_t slot = layer - c->layers;
+    if (slot < 0 || slot >= MAX_LAYERS || !c->layer_used[slot]) return;
     
-    free(layer);
+    /* Hand the render target back to the pool */
+    release_surface(c, layer->surface);
+    c->layer_used[slot] = false;
 }
 
 void minirend_compositor_begin_layer(MinirendCompositor *c,
@@ -295,6 +499,9 @@ void minirend_compositor_begin_layer(MinirendCompositor *c,
         .attachments = (sg_attachments){ layer->framebuffer },
     };
     sg_begin_pass(&pass);
+    
+    /* The pooled target may be larger than the layer */
+    sg_apply_viewport(0, 0, (int)ceilf(layer->width), (int)ceilf(layer->height), true);
 }
 
 void minirend_compositor_end_layer(MinirendCompositor *c) {
@@ -309,23 +516,50 @@ void minirend_compositor_draw_layer(MinirendCompositor *c,
                                     float x, float y) {
     if (!c || !layer) return;
     
-    /* Build MVP matrix */
+    if (c->viewport_width <= 0 || c->viewport_height <= 0) return;
+    
+    /* Unit quad -> layer size -> layer transform around its origin ->
+     * screen position */
+    float ox = layer->transform_origin_x;
+    float oy = layer->transform_origin_y;
+    MinirendTransform2D m = minirend_transform_translate(x + ox, y + oy);
+    m = minirend_transform_multiply(m, layer->transform);
+    m = minirend_transform_multiply(m, minirend_transform_translate(-ox, -oy));
+    m = minirend_transform_multiply(m,
+            minirend_transform_scale(layer->width, layer->height));
+    
+    /* Screen pixels -> clip space */
     float sx = 2.0f / c->viewport_width;
     float sy = -2.0f / c->viewport_height;
-    float tx = -1.0f + x * sx;
-    float ty = 1.0f + y * sy;
-    
-    float w = layer->width * sx;
-    float h = layer->height * sy;
-    
-    /* Simple orthographic projection with position */
-    float mvp[16] = {
-        w, 0, 0, 0,
-        0, h, 0, 0,
-        0, 0, 1, 0,
-        tx, ty, 0, 1,
+    
+    struct {
+        float mvp[16];
+        float uv_rect[4];
+    } vs_params = {
+        .mvp = {
+            m.m[0] * sx, m.m[1] * sy, 0, 0,
+            m.m[2] * sx, m.m[3] * sy, 0, 0,
+            0, 0, 1, 0,
+            m.m[4] * sx - 1.0f, m.m[5] * sy + 1.0f, layer->depth, 1,
+        },
     };
     
+    /* Content occupies the top-left of the (possibly larger) target.
+     * Render targets are stored bottom-up on GL. */
+    float u_extent = layer->width / layer->texture_width;
+    float v_extent = layer->height / layer->texture_height;
+    if (sg_query_features().origin_top_left) {
+        vs_params.uv_rect[0] = 0.0f;
+        vs_params.uv_rect[1] = 0.0f;
+        vs_params.uv_rect[2] = u_extent;
+        vs_params.uv_rect[3] = v_extent;
+    } else {
+        vs_params.uv_rect[0] = 0.0f;
+        vs_params.uv_rect[1] = 1.0f;
+        vs_params.uv_rect[2] = u_extent;
+        vs_params.uv_rect[3] = -v_extent;
+    }
+    
     /* Apply pipeline */
     sg_apply_pipeline(c->comp_pipeline);
     
@@ -341,7 +575,7 @@ void minirend_compositor_draw_layer(MinirendCompositor *c,
     sg_apply_bindings(&bindings);
     
     /* Apply uniforms */
-    sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, &SG_RANGE(mvp));
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, &SG_RANGE(vs_params));
     sg_apply_uniforms(SG_SHADERSTAGE_FS, 0, &SG_RANGE(layer->opacity));
     
     /* Draw */
@@ -6,6 +6,7 @@
  *
  * Handles:
  * - Creating offscreen render targets for layers
+ * - Pooling render targets by size class under a GPU memory budget
  * - Compositing layers with transforms and opacity
  * - Managing layer tree for elements with transforms, opacity < 1, etc.
  */
@@ -37,10 +38,19 @@ typedef struct MinirendLayer {
     /* Opacity */
     float opacity;
     
-    /* Render target (sokol_gfx handles) */
+    /* Depth when compositing (0 = nearest, 1 = farthest); the quad is depth
+     * tested against opaque content already drawn in the pass */
+    float depth;
+    
+    /* Render target (sokol_gfx handles). Borrowed from the compositor's
+     * pool; the texture may be larger than the layer, content occupies
+     * the top-left width x height region. */
     uint32_t framebuffer;
     uint32_t texture;
     uint32_t depth_buffer;
+    float    texture_width;
+    float    texture_height;
+    int32_t  surface;  /* Pool slot backing the render target */
     
     /* Layer tree */
     struct MinirendLayer *parent;
@@ -52,6 +62,21 @@ typedef struct MinirendLayer {
     
 } MinirendLayer;
 
+/* ============================================================================
+ * Render Target Pool Statistics
+ * ============================================================================ */
+
+typedef struct {
+    int      surfaces_total;    /* Pooled render targets (in use + free) */
+    int      surfaces_in_use;   /* Render targets backing live layers */
+    size_t   bytes_total;       /* Estimated GPU memory of all targets */
+    size_t   bytes_in_use;      /* Estimated GPU memory of live targets */
+    size_t   bytes_budget;      /* Budget for pooled memory */
+    uint64_t hits;              /* Layer creations served from the pool */
+    uint64_t misses;            /* Layer creations that made a new target */
+    uint64_t evictions;         /* Free targets destroyed to fit the budget */
+} MinirendCompositorPoolStats;
+
 /* ============================================================================
  * Compositor Context
  * ============================================================================ */
@@ -71,11 +96,22 @@ void minirend_compositor_begin(MinirendCompositor *compositor,
 /* End compositing and render final output to screen. */
 void minirend_compositor_end(MinirendCompositor *compositor);
 
-/* Create a new layer. Returns layer handle or NULL on failure. */
+/* Set the GPU memory budget for pooled render targets, in bytes.
+ * Free targets are evicted least-recently-used first while the pool is
+ * over budget. Targets backing live layers are never evicted. */
+void minirend_compositor_set_memory_budget(MinirendCompositor *compositor,
+                                           size_t bytes);
+
+/* Get render target pool statistics. */
+void minirend_compositor_get_pool_stats(const MinirendCompositor *compositor,
+                                        MinirendCompositorPoolStats *out_stats);
+
+/* Create a new layer. The render target is taken from the pool when one of
+ * the same size class is free. Returns layer handle or NULL on failure. */
 MinirendLayer *minirend_compositor_create_layer(MinirendCompositor *compositor,
                                                 float width, float height);
 
-/* Destroy a layer and free its resources. */
+/* Destroy a layer and return its render target to the pool. */
 void minirend_compositor_destroy_layer(MinirendCompositor *compositor,
                                        MinirendLayer *layer);
 
@@ -86,7 +122,9 @@ void minirend_compositor_begin_layer(MinirendCompositor *compositor,
 /* End rendering to current layer. */
 void minirend_compositor_end_layer(MinirendCompositor *compositor);
 
-/* Composite a layer to the current target. */
+/* Composite a layer to the current target at (x, y), applying the layer's
+ * transform (around transform_origin, relative to the layer) and opacity.
+ * Layer content is treated as premultiplied alpha. */
 void minirend_compositor_draw_layer(MinirendCompositor *compositor,
                                     MinirendLayer *layer,
                                     float x, float y);
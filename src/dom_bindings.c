@@ -1,54 +1,553 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 #include "minirend.h"
 #include "quickjs.h"
 
 #include "dom_runtime.h"
+#include "dom_element.h"
+#include "dom_events.h"
+#include "dom_event_types.h"
+#include "dom_mutations.h"
+#include "dom_query.h"
 #include "ui_tree.h"
 #include "lexbor_adapter.h"
 
+#include <lexbor/dom/dom.h>
+
 static int32_t g_next_node_id = 3; /* 1=document, 2=body */
 
+/* The document JS sees is the one the renderer lays out. */
+static LexborDocument *g_doc = NULL;
+static lxb_dom_node_t *g_doc_node = NULL;
+
+static const char k_empty_document[] = "<html><head></head><body></body></html>";
+
+/* Elements whose style was written this frame (owned refs); each is
+ * serialized into its style attribute once, at flush. */
+static JSValue *g_pending_styles = NULL;
+static int      g_pending_len = 0;
+static int      g_pending_cap = 0;
+
+static JSClassID js_element_class_id;
+
 static JSValue js_document_createElement(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
 static JSValue js_document_elementFromPoint(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
 static JSValue js_element_appendChild(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_removeChild(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_getAttribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_setAttribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_removeAttribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_querySelector(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_querySelectorAll(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_getElementsByClassName(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+
+/* Frees the detached tree holding node once none of its nodes has a
+ * wrapper left: script can no longer reach it. */
+static void free_if_unreachable(lxb_dom_node_t *node) {
+    lxb_dom_node_t *root = node;
+    while (lxb_dom_node_parent(root)) root = lxb_dom_node_parent(root);
+    if (root == g_doc_node || root->user) return;
+
+    /* The rest of a collected tree may not be finalized yet; its last
+     * wrapper frees it. */
+    lxb_dom_node_t *n = root;
+    while (n) {
+        if (n->user) return;
+
+        lxb_dom_node_t *child = lxb_dom_node_first_child(n);
+        if (child) {
+            n = child;
+            continue;
+        }
+        while (n != root && !lxb_dom_node_next(n)) n = lxb_dom_node_parent(n);
+        n = (n == root) ? NULL : lxb_dom_node_next(n);
+    }
+    minirend_lexbor_destroy_node(root);
+    minirend_dom_mutations_invalidate(0); /* cached queries may hold its nodes */
+}
+
+static void js_element_finalizer(JSRuntime *rt, JSValue val) {
+    DomElement *e = (DomElement *)JS_GetOpaque(val, js_element_class_id);
+    if (!e) return;
+    minirend_dom_unregister_node(e->node_id);
+    minirend_ui_tree_remove_node(e->node_id);
+    /* The document may already be gone during teardown; don't touch node. */
+    if (e->node && g_doc_node) {
+        e->node->user = NULL;
+        free_if_unreachable(e->node);
+    }
+    JS_FreeValueRT(rt, e->children);
+    JS_FreeValueRT(rt, e->style);
+    minirend_event_target_free(rt, &e->events);
+    JS_FreeValueRT(rt, e->owner);
+    for (int i = 0; i < e->owned_len; i++) JS_FreeValueRT(rt, e->owned[i]);
+    free(e->owned);
+    free(e);
+}
+
+static void js_element_gc_mark(JSRuntime *rt, JSValueConst val, JS_MarkFunc *mark_func) {
+    DomElement *e = (DomElement *)JS_GetOpaque(val, js_element_class_id);
+    if (!e) return;
+    JS_MarkValue(rt, e->children, mark_func);
+    JS_MarkValue(rt, e->style, mark_func);
+    minirend_event_target_mark(rt, &e->events, mark_func);
+    JS_MarkValue(rt, e->owner, mark_func);
+    for (int i = 0; i < e->owned_len; i++) JS_MarkValue(rt, e->owned[i], mark_func);
+}
+
+static JSClassDef js_element_class = {
+    "Element",
+    .finalizer = js_element_finalizer,
+    .gc_mark = js_element_gc_mark,
+};
+
+static DomElement *get_element(JSValueConst val) {
+    return (DomElement *)JS_GetOpaque(val, js_element_class_id);
+}
+
+DomElement *minirend_dom_get_element(JSValueConst val) {
+    return get_element(val);
+}
+
+static bool is_element(lxb_dom_node_t *node) {
+    return node && lxb_dom_node_type(node) == LXB_DOM_NODE_TYPE_ELEMENT;
+}
+
+/* Attached to the rendered document (so mutating it changes the page). */
+static bool is_connected(lxb_dom_node_t *node) {
+    for (lxb_dom_node_t *p = node; p; p = lxb_dom_node_parent(p)) {
+        if (p == g_doc_node) return true;
+    }
+    return false;
+}
+
+static JSValue new_element(JSContext *ctx, lxb_dom_node_t *node, int32_t node_id) {
+    DomElement *e = (DomElement *)calloc(1, sizeof(DomElement));
+    if (!e) return JS_ThrowOutOfMemory(ctx);
+
+    JSValue obj = JS_NewObjectClass(ctx, js_element_class_id);
+    if (JS_IsException(obj)) {
+        free(e);
+        return obj;
+    }
+    e->node_id = node_id;
+    e->node = node;
+    e->obj = obj;
+    e->children = JS_UNDEFINED;
+    e->style = JS_UNDEFINED;
+    e->owner = JS_UNDEFINED;
+    JS_SetOpaque(obj, e);
+    if (node) node->user = e;
+    return obj;
+}
+
+/* Pre-order successor of n within root's subtree, or NULL. */
+static lxb_dom_node_t *subtree_next(lxb_dom_node_t *root, lxb_dom_node_t *n) {
+    lxb_dom_node_t *child = lxb_dom_node_first_child(n);
+    if (child) return child;
+    while (n != root && !lxb_dom_node_next(n)) n = lxb_dom_node_parent(n);
+    return (n == root) ? NULL : lxb_dom_node_next(n);
+}
+
+static DomElement *wrapped_ancestor(lxb_dom_node_t *node) {
+    for (lxb_dom_node_t *p = lxb_dom_node_parent(node); p; p = lxb_dom_node_parent(p)) {
+        if (p->user) return (DomElement *)p->user;
+    }
+    return NULL;
+}
+
+/* Drops the links between a detached wrapper and its owner. */
+static void unlink_owner(JSContext *ctx, DomElement *e) {
+    if (JS_IsUndefined(e->owner)) return;
+    /* Either side may be the last thing holding the other. */
+    JSValue self = JS_DupValue(ctx, e->obj);
+    DomElement *o = get_element(e->owner);
+    for (int i = 0; o && i < o->owned_len; i++) {
+        if (get_element(o->owned[i]) != e) continue;
+        JSValue v = o->owned[i];
+        o->owned[i] = o->owned[--o->owned_len];
+        JS_FreeValue(ctx, v);
+        break;
+    }
+    JSValue owner = e->owner;
+    e->owner = JS_UNDEFINED;
+    JS_FreeValue(ctx, owner);
+    JS_FreeValue(ctx, self);
+}
+
+static void link_owner(JSContext *ctx, DomElement *owner, DomElement *e) {
+    if (get_element(e->owner) == owner) return;
+    unlink_owner(ctx, e);
+    if (owner->owned_len == owner->owned_cap) {
+        int cap = owner->owned_cap ? owner->owned_cap * 2 : 4;
+        JSValue *owned = (JSValue *)realloc(owner->owned, (size_t)cap * sizeof(JSValue));
+        if (!owned) return; /* stays weak, as script-held wrappers were */
+        owner->owned = owned;
+        owner->owned_cap = cap;
+    }
+    owner->owned[owner->owned_len++] = JS_DupValue(ctx, e->obj);
+    e->owner = JS_DupValue(ctx, owner->obj);
+}
 
-static JSValue make_element(JSContext *ctx, const char *tag, int32_t node_id) {
-    JSValue elem = JS_NewObject(ctx);
-    JS_SetPropertyStr(ctx, elem, "__nodeId", JS_NewInt32(ctx, node_id));
-    JS_SetPropertyStr(ctx, elem, "tagName", JS_NewString(ctx, tag));
+/* root was just detached: link every wrapper below it to its nearest
+ * wrapped ancestor (the subtree had no links while connected). */
+static void adopt_detached(JSContext *ctx, lxb_dom_node_t *root) {
+    for (lxb_dom_node_t *n = subtree_next(root, root); n; n = subtree_next(root, n)) {
+        if (!n->user) continue;
+        DomElement *a = wrapped_ancestor(n);
+        if (a) link_owner(ctx, a, (DomElement *)n->user);
+    }
+}
 
-    /* DOM-ish tree links. */
-    JS_SetPropertyStr(ctx, elem, "parentNode", JS_NULL);
-    JS_SetPropertyStr(ctx, elem, "children", JS_NewArray(ctx));
+/* root was just connected; the registry holds its wrappers now. */
+static void release_owners(JSContext *ctx, lxb_dom_node_t *root) {
+    for (lxb_dom_node_t *n = root; n; n = subtree_next(root, n)) {
+        if (n->user) unlink_owner(ctx, (DomElement *)n->user);
+    }
+}
 
-    /* Style placeholder. */
-    JS_SetPropertyStr(ctx, elem, "style", JS_NewObject(ctx));
+static JSValue make_element(JSContext *ctx, lxb_dom_node_t *node, int32_t node_id) {
+    JSValue elem = new_element(ctx, node, node_id);
+    if (JS_IsException(elem)) return elem;
 
     /* canvas specific defaults */
-    if (strcmp(tag, "canvas") == 0) {
+    const char *tag = minirend_lexbor_get_tag_name(node);
+    if (tag && strcmp(tag, "canvas") == 0) {
         JS_SetPropertyStr(ctx, elem, "width", JS_NewInt32(ctx, 800));
         JS_SetPropertyStr(ctx, elem, "height", JS_NewInt32(ctx, 600));
     }
 
     /* Register for nodeId -> object and hit-test. */
     minirend_dom_register_node(ctx, node_id, elem);
+    if (is_connected(node)) {
+        minirend_dom_retain_node(ctx, node_id, true);
+    } else {
+        /* Slot in between the nearest wrapped ancestor and the wrappers
+         * below this node it owned. */
+        DomElement *e = get_element(elem);
+        DomElement *a = wrapped_ancestor(node);
+        if (a) {
+            for (int i = a->owned_len - 1; i >= 0; i--) {
+                DomElement *d = get_element(a->owned[i]);
+                lxb_dom_node_t *p = d ? lxb_dom_node_parent(d->node) : NULL;
+                while (p && p != node && p != a->node) p = lxb_dom_node_parent(p);
+                if (p == node) link_owner(ctx, e, d);
+            }
+            link_owner(ctx, a, e);
+        }
+    }
     minirend_ui_tree_register_node(node_id);
     return elem;
 }
 
+/* Retain the existing wrappers in root's subtree (it was connected) or
+ * release them (detached). */
+static void retain_subtree(JSContext *ctx, lxb_dom_node_t *root, bool retain) {
+    for (lxb_dom_node_t *n = root; n; n = subtree_next(root, n)) {
+        if (n->user) minirend_dom_retain_node(ctx, ((DomElement *)n->user)->node_id, retain);
+    }
+}
+
+/* JS object for a lexbor node, creating its wrapper on first use.
+ * Only the document and elements are exposed; other nodes map to null. */
+static JSValue wrap_node(JSContext *ctx, lxb_dom_node_t *node) {
+    if (!node) return JS_NULL;
+    if (node->user) return JS_DupValue(ctx, ((DomElement *)node->user)->obj);
+    if (!is_element(node)) return JS_NULL;
+    return make_element(ctx, node, g_next_node_id++);
+}
+
+static JSValue wrap_nodes(JSContext *ctx, lxb_dom_node_t *const *nodes, int count) {
+    JSValue arr = JS_NewArray(ctx);
+    if (JS_IsException(arr)) return arr;
+    for (int i = 0; i < count; i++) {
+        JS_SetPropertyUint32(ctx, arr, (uint32_t)i, wrap_node(ctx, nodes[i]));
+    }
+    return arr;
+}
+
+static lxb_dom_node_t *next_element(lxb_dom_node_t *node) {
+    while (node && !is_element(node)) node = lxb_dom_node_next(node);
+    return node;
+}
+
+static lxb_dom_node_t *prev_element(lxb_dom_node_t *node) {
+    while (node && !is_element(node)) node = lxb_dom_node_prev(node);
+    return node;
+}
+
+static void invalidate_children(JSContext *ctx, lxb_dom_node_t *node) {
+    DomElement *e = node ? (DomElement *)node->user : NULL;
+    if (!e) return;
+    JS_FreeValue(ctx, e->children);
+    e->children = JS_UNDEFINED;
+}
+
+static JSValue js_element_get_nodeId(JSContext *ctx, JSValueConst this_val) {
+    DomElement *e = get_element(this_val);
+    return e ? JS_NewInt32(ctx, e->node_id) : JS_UNDEFINED;
+}
+
+static JSValue js_element_get_tagName(JSContext *ctx, JSValueConst this_val) {
+    DomElement *e = get_element(this_val);
+    if (!e || !is_element(e->node)) return JS_UNDEFINED;
+    const char *tag = minirend_lexbor_get_tag_name(e->node);
+    return tag ? JS_NewString(ctx, tag) : JS_UNDEFINED;
+}
+
+static JSValue js_element_get_parentNode(JSContext *ctx, JSValueConst this_val) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_UNDEFINED;
+    return e->node ? wrap_node(ctx, lxb_dom_node_parent(e->node)) : JS_NULL;
+}
+
+static JSValue js_element_get_firstElementChild(JSContext *ctx, JSValueConst this_val) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_UNDEFINED;
+    return e->node ? wrap_node(ctx, next_element(lxb_dom_node_first_child(e->node))) : JS_NULL;
+}
+
+static JSValue js_element_get_lastElementChild(JSContext *ctx, JSValueConst this_val) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_UNDEFINED;
+    return e->node ? wrap_node(ctx, prev_element(lxb_dom_node_last_child(e->node))) : JS_NULL;
+}
+
+static JSValue js_element_get_nextElementSibling(JSContext *ctx, JSValueConst this_val) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_UNDEFINED;
+    return e->node ? wrap_node(ctx, next_element(lxb_dom_node_next(e->node))) : JS_NULL;
+}
+
+static JSValue js_element_get_previousElementSibling(JSContext *ctx, JSValueConst this_val) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_UNDEFINED;
+    return e->node ? wrap_node(ctx, prev_element(lxb_dom_node_prev(e->node))) : JS_NULL;
+}
+
+static JSValue js_element_get_children(JSContext *ctx, JSValueConst this_val) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_UNDEFINED;
+
+    /* Built on first read, rebuilt after the child list changes. */
+    if (JS_IsUndefined(e->children)) {
+        JSValue arr = JS_NewArray(ctx);
+        if (JS_IsException(arr)) return arr;
+        uint32_t i = 0;
+        lxb_dom_node_t *c = e->node ? next_element(lxb_dom_node_first_child(e->node)) : NULL;
+        for (; c; c = next_element(lxb_dom_node_next(c))) {
+            JS_SetPropertyUint32(ctx, arr, i++, wrap_node(ctx, c));
+        }
+        e->children = arr;
+    }
+    return JS_DupValue(ctx, e->children);
+}
+
+static JSValue js_element_get_style(JSContext *ctx, JSValueConst this_val) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_UNDEFINED;
+
+    if (JS_IsUndefined(e->style)) {
+        JSValue global_obj = JS_GetGlobalObject(ctx);
+        JSValue make = JS_GetPropertyStr(ctx, global_obj, "__minirendMakeStyle");
+        JSValue style = JS_Call(ctx, make, JS_UNDEFINED, 1, &this_val);
+        JS_FreeValue(ctx, make);
+        JS_FreeValue(ctx, global_obj);
+        if (JS_IsException(style)) return style;
+
+        /* Start from the document's inline style; seeding it is not a
+         * script write, so keep it off the pending list. */
+        const char *inline_style = e->node ? minirend_lexbor_get_inline_style(e->node) : NULL;
+        if (inline_style) {
+            e->style_pending = true;
+            JS_SetPropertyStr(ctx, style, "cssText", JS_NewString(ctx, inline_style));
+            e->style_pending = false;
+        }
+        e->style = style;
+    }
+    return JS_DupValue(ctx, e->style);
+}
+
+/* element.style was written: queue the element for this frame's flush. */
+static JSValue js_native_style_changed(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    (void)this_val;
+    DomElement *e = argc >= 1 ? get_element(argv[0]) : NULL;
+    if (!e || e->style_pending) return JS_UNDEFINED;
+
+    if (g_pending_len == g_pending_cap) {
+        int new_cap = g_pending_cap ? (g_pending_cap * 2) : 32;
+        JSValue *np = (JSValue *)realloc(g_pending_styles, (size_t)new_cap * sizeof(JSValue));
+        if (!np) return JS_ThrowOutOfMemory(ctx);
+        g_pending_styles = np;
+        g_pending_cap = new_cap;
+    }
+    g_pending_styles[g_pending_len++] = JS_DupValue(ctx, e->obj);
+    e->style_pending = true;
+
+    /* Invalidation is decided at flush, once the final value is known. */
+    minirend_dom_record_attribute(ctx, e->obj, "style", 0);
+    return JS_UNDEFINED;
+}
+
+static JSValue get_attr(JSContext *ctx, DomElement *e, const char *name) {
+    if (!is_element(e->node)) return JS_NULL;
+
+    /* Style writes reach the attribute at flush; report them already. */
+    if (strcasecmp(name, "style") == 0 && !JS_IsUndefined(e->style)) {
+        return JS_GetPropertyStr(ctx, e->style, "cssText");
+    }
+    const char *value = minirend_lexbor_get_attribute(e->node, name);
+    return value ? JS_NewString(ctx, value) : JS_NULL;
+}
+
+/* A NULL value removes the attribute. */
+static JSValue set_attr(JSContext *ctx, DomElement *e, const char *name, const char *value) {
+    if (!is_element(e->node)) return JS_ThrowTypeError(ctx, "not an element");
+
+    /* Once element.style exists it owns the attribute (see flush). */
+    if (strcasecmp(name, "style") == 0 && !JS_IsUndefined(e->style)) {
+        if (JS_SetPropertyStr(ctx, e->style, "cssText", JS_NewString(ctx, value ? value : "")) < 0) {
+            return JS_EXCEPTION;
+        }
+        return JS_UNDEFINED;
+    }
+
+    bool connected = is_connected(e->node);
+    bool indexed = connected && (strcasecmp(name, "id") == 0 || strcasecmp(name, "class") == 0);
+    if (indexed) minirend_dom_query_remove_element(e->node);
+    if (value) {
+        minirend_lexbor_set_attribute(e->node, name, value);
+    } else {
+        minirend_lexbor_remove_attribute(e->node, name);
+    }
+    if (indexed) minirend_dom_query_add_element(e->node);
+
+    /* Any attribute can change which selectors match. */
+    minirend_dom_record_attribute(ctx, e->obj, name,
+        connected ? (MINIREND_INVALIDATE_STYLE | MINIREND_INVALIDATE_LAYOUT) : 0);
+    return JS_UNDEFINED;
+}
+
+static JSValue get_attr_string(JSContext *ctx, JSValueConst this_val, const char *name) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_UNDEFINED;
+    JSValue v = get_attr(ctx, e, name);
+    return JS_IsNull(v) ? JS_NewString(ctx, "") : v;
+}
+
+static JSValue set_attr_value(JSContext *ctx, JSValueConst this_val, const char *name, JSValueConst val) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_ThrowTypeError(ctx, "not an element");
+    const char *value = JS_ToCString(ctx, val);
+    if (!value) return JS_EXCEPTION;
+    JSValue ret = set_attr(ctx, e, name, value);
+    JS_FreeCString(ctx, value);
+    return ret;
+}
+
+static JSValue js_element_get_id(JSContext *ctx, JSValueConst this_val) {
+    return get_attr_string(ctx, this_val, "id");
+}
+
+static JSValue js_element_set_id(JSContext *ctx, JSValueConst this_val, JSValueConst val) {
+    return set_attr_value(ctx, this_val, "id", val);
+}
+
+static JSValue js_element_get_className(JSContext *ctx, JSValueConst this_val) {
+    return get_attr_string(ctx, this_val, "class");
+}
+
+static JSValue js_element_set_className(JSContext *ctx, JSValueConst this_val, JSValueConst val) {
+    return set_attr_value(ctx, this_val, "class", val);
+}
+
+static void define_getter(JSContext *ctx, JSValue proto, const char *name,
+                          JSValue (*getter)(JSContext *, JSValueConst)) {
+    JSAtom atom = JS_NewAtom(ctx, name);
+    JS_DefinePropertyGetSet(ctx, proto, atom,
+        JS_NewCFunction2(ctx, (JSCFunction *)getter, name, 0, JS_CFUNC_getter, 0),
+        JS_UNDEFINED, JS_PROP_CONFIGURABLE);
+    JS_FreeAtom(ctx, atom);
+}
+
+static void define_accessor(JSContext *ctx, JSValue proto, const char *name,
+                            JSValue (*getter)(JSContext *, JSValueConst),
+                            JSValue (*setter)(JSContext *, JSValueConst, JSValueConst)) {
+    JSAtom atom = JS_NewAtom(ctx, name);
+    JS_DefinePropertyGetSet(ctx, proto, atom,
+        JS_NewCFunction2(ctx, (JSCFunction *)getter, name, 0, JS_CFUNC_getter, 0),
+        JS_NewCFunction2(ctx, (JSCFunction *)setter, name, 1, JS_CFUNC_setter, 0),
+        JS_PROP_CONFIGURABLE);
+    JS_FreeAtom(ctx, atom);
+}
+
+static void register_element_class(JSContext *ctx) {
+    static int registered = 0;
+    if (!registered) {
+        registered = 1;
+        JS_NewClassID(&js_element_class_id);
+        JS_NewClass(JS_GetRuntime(ctx), js_element_class_id, &js_element_class);
+    }
+
+    JSValue proto = JS_NewObject(ctx);
+    define_getter(ctx, proto, "__nodeId", js_element_get_nodeId);
+    define_getter(ctx, proto, "tagName", js_element_get_tagName);
+    define_getter(ctx, proto, "parentNode", js_element_get_parentNode);
+    define_getter(ctx, proto, "firstElementChild", js_element_get_firstElementChild);
+    define_getter(ctx, proto, "lastElementChild", js_element_get_lastElementChild);
+    define_getter(ctx, proto, "nextElementSibling", js_element_get_nextElementSibling);
+    define_getter(ctx, proto, "previousElementSibling", js_element_get_previousElementSibling);
+    define_getter(ctx, proto, "children", js_element_get_children);
+    define_getter(ctx, proto, "style", js_element_get_style);
+    define_accessor(ctx, proto, "id", js_element_get_id, js_element_set_id);
+    define_accessor(ctx, proto, "className", js_element_get_className, js_element_set_className);
+    JS_SetPropertyStr(ctx, proto, "appendChild",
+                      JS_NewCFunction(ctx, js_element_appendChild, "appendChild", 1));
+    JS_SetPropertyStr(ctx, proto, "removeChild",
+                      JS_NewCFunction(ctx, js_element_removeChild, "removeChild", 1));
+    JS_SetPropertyStr(ctx, proto, "getAttribute",
+                      JS_NewCFunction(ctx, js_element_getAttribute, "getAttribute", 1));
+    JS_SetPropertyStr(ctx, proto, "setAttribute",
+                      JS_NewCFunction(ctx, js_element_setAttribute, "setAttribute", 2));
+    JS_SetPropertyStr(ctx, proto, "removeAttribute",
+                      JS_NewCFunction(ctx, js_element_removeAttribute, "removeAttribute", 1));
+    JS_SetPropertyStr(ctx, proto, "querySelector",
+                      JS_NewCFunction(ctx, js_element_querySelector, "querySelector", 1));
+    JS_SetPropertyStr(ctx, proto, "querySelectorAll",
+                      JS_NewCFunction(ctx, js_element_querySelectorAll, "querySelectorAll", 1));
+    JS_SetPropertyStr(ctx, proto, "getElementsByClassName",
+                      JS_NewCFunction(ctx, js_element_getElementsByClassName, "getElementsByClassName", 1));
+    minirend_dom_events_install(ctx, proto);
+    JS_SetClassProto(ctx, js_element_class_id, proto);
+}
+
+/* Once dom_runtime has built it, put its element prototype under ours. */
+static void inherit_event_target(JSContext *ctx) {
+    JSValue global_obj = JS_GetGlobalObject(ctx);
+    JSValue target = JS_GetPropertyStr(ctx, global_obj, "__MinirendElementProto");
+    JSValue proto = JS_GetClassProto(ctx, js_element_class_id);
+    if (JS_IsObject(target)) {
+        JS_SetPrototype(ctx, proto, target);
+    }
+    JS_FreeValue(ctx, proto);
+    JS_FreeValue(ctx, target);
+    JS_FreeValue(ctx, global_obj);
+}
+
 static JSValue js_document_createElement(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
     (void)this_val;
     if (argc < 1) return JS_ThrowTypeError(ctx, "tag name required");
     const char *tag = JS_ToCString(ctx, argv[0]);
     if (!tag) return JS_EXCEPTION;
 
-    int32_t node_id = g_next_node_id++;
-    JSValue elem = make_element(ctx, tag, node_id);
-
+    lxb_dom_node_t *node = minirend_lexbor_create_element(g_doc, tag);
     JS_FreeCString(ctx, tag);
-    return elem;
+    if (!node) return JS_ThrowInternalError(ctx, "createElement failed");
+
+    return make_element(ctx, node, g_next_node_id++);
 }
 
 static JSValue js_document_elementFromPoint(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
@@ -65,30 +564,151 @@ static JSValue js_document_elementFromPoint(JSContext *ctx, JSValueConst this_va
 }
 
 static JSValue js_element_appendChild(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    if (argc < 1 || !JS_IsObject(argv[0])) return JS_DupValue(ctx, this_val);
-    JSValue child = JS_DupValue(ctx, argv[0]);
+    DomElement *parent = get_element(this_val);
+    if (!parent || !parent->node) return JS_ThrowTypeError(ctx, "not an element");
+    DomElement *child = argc >= 1 ? get_element(argv[0]) : NULL;
+    if (!child || !is_element(child->node)) {
+        return JS_ThrowTypeError(ctx, "appendChild: argument is not an element");
+    }
+
+    for (lxb_dom_node_t *p = parent->node; p; p = lxb_dom_node_parent(p)) {
+        if (p == child->node) return JS_ThrowRangeError(ctx, "appendChild: would create a cycle");
+    }
+
+    lxb_dom_node_t *old_parent = lxb_dom_node_parent(child->node);
+    bool was_connected = is_connected(child->node);
+    bool connected = is_connected(parent->node);
+    if (was_connected && !connected) minirend_dom_query_remove_subtree(child->node);
+    minirend_lexbor_append_child(parent->node, child->node);
+    if (connected && !was_connected) {
+        minirend_dom_query_add_subtree(child->node);
+        retain_subtree(ctx, child->node, true);
+        release_owners(ctx, child->node);
+    } else if (!connected) {
+        /* Link before the registry lets go, so nothing is collected. */
+        if (was_connected) adopt_detached(ctx, child->node);
+        link_owner(ctx, parent, child);
+        if (was_connected) retain_subtree(ctx, child->node, false);
+    }
+    invalidate_children(ctx, old_parent);
+    invalidate_children(ctx, parent->node);
+
+    /* Detached subtrees don't affect the page until they are attached. */
+    unsigned invalidate = (was_connected || connected)
+        ? (MINIREND_INVALIDATE_STYLE | MINIREND_INVALIDATE_LAYOUT) : 0;
+    minirend_dom_record_child_list(ctx, parent->obj, child->obj, JS_NULL, invalidate);
+
+    return JS_DupValue(ctx, child->obj); /* caller owns */
+}
+
+static JSValue js_element_removeChild(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DomElement *parent = get_element(this_val);
+    if (!parent || !parent->node) return JS_ThrowTypeError(ctx, "not an element");
+    DomElement *child = argc >= 1 ? get_element(argv[0]) : NULL;
+    if (!child || !child->node || lxb_dom_node_parent(child->node) != parent->node) {
+        return JS_ThrowRangeError(ctx, "removeChild: node is not a child of this element");
+    }
+
+    bool was_connected = is_connected(child->node);
+    if (was_connected) minirend_dom_query_remove_subtree(child->node);
+    minirend_lexbor_remove_node(child->node);
+    if (was_connected) {
+        adopt_detached(ctx, child->node);
+        retain_subtree(ctx, child->node, false);
+    } else {
+        unlink_owner(ctx, child); /* the caller holds it now */
+    }
+    invalidate_children(ctx, parent->node);
+
+    unsigned invalidate = was_connected
+        ? (MINIREND_INVALIDATE_STYLE | MINIREND_INVALIDATE_LAYOUT) : 0;
+    minirend_dom_record_child_list(ctx, parent->obj, JS_NULL, child->obj, invalidate);
+
+    return JS_DupValue(ctx, child->obj);
+}
 
-    /* child.parentNode = this */
-    JS_SetPropertyStr(ctx, child, "parentNode", JS_DupValue(ctx, this_val));
+static JSValue js_element_getAttribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_ThrowTypeError(ctx, "not an element");
+    if (argc < 1) return JS_ThrowTypeError(ctx, "getAttribute: name required");
+    const char *name = JS_ToCString(ctx, argv[0]);
+    if (!name) return JS_EXCEPTION;
+    JSValue ret = get_attr(ctx, e, name);
+    JS_FreeCString(ctx, name);
+    return ret;
+}
 
-    /* parent.children.push(child) */
-    JSValue children = JS_GetPropertyStr(ctx, this_val, "children");
-    if (!JS_IsArray(ctx, children)) {
-        JS_FreeValue(ctx, children);
-        children = JS_NewArray(ctx);
-        JS_SetPropertyStr(ctx, this_val, "children", JS_DupValue(ctx, children));
+static JSValue js_element_setAttribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_ThrowTypeError(ctx, "not an element");
+    if (argc < 2) return JS_ThrowTypeError(ctx, "setAttribute: name and value required");
+    const char *name = JS_ToCString(ctx, argv[0]);
+    if (!name) return JS_EXCEPTION;
+    const char *value = JS_ToCString(ctx, argv[1]);
+    if (!value) {
+        JS_FreeCString(ctx, name);
+        return JS_EXCEPTION;
     }
-    uint32_t len = 0;
-    JSValue lenv = JS_GetPropertyStr(ctx, children, "length");
-    JS_ToUint32(ctx, &len, lenv);
-    JS_FreeValue(ctx, lenv);
-    JS_SetPropertyUint32(ctx, children, len, JS_DupValue(ctx, child));
-    JS_FreeValue(ctx, children);
+    JSValue ret = set_attr(ctx, e, name, value);
+    JS_FreeCString(ctx, value);
+    JS_FreeCString(ctx, name);
+    return ret;
+}
+
+static JSValue js_element_removeAttribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DomElement *e = get_element(this_val);
+    if (!e) return JS_ThrowTypeError(ctx, "not an element");
+    if (argc < 1) return JS_ThrowTypeError(ctx, "removeAttribute: name required");
+    const char *name = JS_ToCString(ctx, argv[0]);
+    if (!name) return JS_EXCEPTION;
+    JSValue ret = set_attr(ctx, e, name, NULL);
+    JS_FreeCString(ctx, name);
+    return ret;
+}
 
-    /* TODO: mark layout dirty and rebuild when layout engine is implemented. */
-    (void)ctx;
+static JSValue js_element_querySelector(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DomElement *e = get_element(this_val);
+    if (!e || !e->node) return JS_ThrowTypeError(ctx, "not an element");
+    if (argc < 1) return JS_ThrowTypeError(ctx, "querySelector: selector required");
+    const char *selector = JS_ToCString(ctx, argv[0]);
+    if (!selector) return JS_EXCEPTION;
+    lxb_dom_node_t *node = minirend_dom_query_first(e->node, selector);
+    JS_FreeCString(ctx, selector);
+    return wrap_node(ctx, node);
+}
+
+static JSValue js_element_querySelectorAll(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DomElement *e = get_element(this_val);
+    if (!e || !e->node) return JS_ThrowTypeError(ctx, "not an element");
+    if (argc < 1) return JS_ThrowTypeError(ctx, "querySelectorAll: selector required");
+    const char *selector = JS_ToCString(ctx, argv[0]);
+    if (!selector) return JS_EXCEPTION;
+    int count = 0;
+    lxb_dom_node_t *const *nodes = minirend_dom_query_all(e->node, selector, &count);
+    JS_FreeCString(ctx, selector);
+    return wrap_nodes(ctx, nodes, count);
+}
+
+static JSValue js_element_getElementsByClassName(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DomElement *e = get_element(this_val);
+    if (!e || !e->node) return JS_ThrowTypeError(ctx, "not an element");
+    if (argc < 1) return JS_ThrowTypeError(ctx, "getElementsByClassName: names required");
+    const char *names = JS_ToCString(ctx, argv[0]);
+    if (!names) return JS_EXCEPTION;
+    int count = 0;
+    lxb_dom_node_t *const *nodes = minirend_dom_query_class_names(e->node, names, &count);
+    JS_FreeCString(ctx, names);
+    return wrap_nodes(ctx, nodes, count);
+}
 
-    return child; /* caller owns */
+static JSValue js_document_getElementById(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_NULL;
+    const char *id = JS_ToCString(ctx, argv[0]);
+    if (!id) return JS_EXCEPTION;
+    lxb_dom_node_t *node = minirend_dom_query_by_id(id);
+    JS_FreeCString(ctx, id);
+    return wrap_node(ctx, node);
 }
 
 void minirend_dom_set_viewport(JSContext *ctx, int width, int height) {
@@ -100,6 +720,59 @@ void minirend_dom_set_viewport(JSContext *ctx, int width, int height) {
     minirend_ui_tree_set_viewport(width, height);
 }
 
+/* Write queued style changes into the document, then hand the frame's
+ * mutations to the renderer and to observers. */
+void minirend_dom_flush(JSContext *ctx) {
+    JSValue *pending = g_pending_styles;
+    int count = g_pending_len;
+    g_pending_styles = NULL;
+    g_pending_len = 0;
+    g_pending_cap = 0;
+
+    for (int i = 0; i < count; i++) {
+        DomElement *e = get_element(pending[i]);
+        if (e) {
+            e->style_pending = false;
+            JSValue text = JS_GetPropertyStr(ctx, e->style, "cssText");
+            const char *css = JS_ToCString(ctx, text);
+            if (css && minirend_lexbor_set_attribute(e->node, "style", css) &&
+                is_connected(e->node)) {
+                minirend_dom_mutations_invalidate(MINIREND_INVALIDATE_STYLE | MINIREND_INVALIDATE_LAYOUT);
+            }
+            if (css) JS_FreeCString(ctx, css);
+            JS_FreeValue(ctx, text);
+        }
+        JS_FreeValue(ctx, pending[i]);
+    }
+    free(pending);
+
+    minirend_dom_mutations_flush(ctx);
+}
+
+void minirend_dom_shutdown(JSContext *ctx) {
+    for (int i = 0; i < g_pending_len; i++) {
+        JS_FreeValue(ctx, g_pending_styles[i]);
+    }
+    free(g_pending_styles);
+    g_pending_styles = NULL;
+    g_pending_len = 0;
+    g_pending_cap = 0;
+
+    minirend_dom_query_shutdown();
+    minirend_dom_event_types_shutdown(ctx);
+    minirend_dom_events_shutdown(ctx);
+    minirend_dom_mutations_shutdown(ctx);
+    minirend_dom_runtime_shutdown(ctx);
+
+    /* Wrappers finalized from here on leave the nodes alone. */
+    g_doc = NULL;
+    g_doc_node = NULL;
+}
+
+bool minirend_dom_uses_document(const LexborDocument *doc) {
+    return doc && doc == g_doc;
+}
+
 void minirend_dom_init(JSContext *ctx, MinirendApp *app) {
     (void)app;
 
@@ -108,6 +781,7 @@ void minirend_dom_init(JSContext *ctx, MinirendApp *app) {
     minirend_lexbor_adapter_init();
 
     JSValue global_obj = JS_GetGlobalObject(ctx);
+    register_element_class(ctx);
 
     /* window === global object (for our purposes). */
     JS_SetPropertyStr(ctx, global_obj, "window", JS_DupValue(ctx, global_obj));
@@ -116,36 +790,46 @@ void minirend_dom_init(JSContext *ctx, MinirendApp *app) {
     JS_SetPropertyStr(ctx, global_obj, "innerWidth", JS_NewInt32(ctx, 1280));
     JS_SetPropertyStr(ctx, global_obj, "innerHeight", JS_NewInt32(ctx, 720));
 
+    /* Share the renderer's document, or give it an empty one to build on. */
+    g_doc = minirend_renderer_get_document();
+    if (!g_doc) {
+        g_doc = minirend_lexbor_parse_html(k_empty_document, sizeof(k_empty_document) - 1);
+        if (g_doc) {
+            minirend_renderer_set_document(g_doc);
+        } else {
+            fprintf(stderr, "[dom] Failed to create document\n");
+        }
+    }
+    g_doc_node = minirend_lexbor_get_document_node(g_doc);
+    minirend_dom_query_init(g_doc);
+
     /* document object */
-    JSValue document = JS_NewObject(ctx);
+    JSValue document = new_element(ctx, g_doc_node, MINIREND_NODE_DOCUMENT);
     JS_SetPropertyStr(ctx, document, "createElement",
                       JS_NewCFunction(ctx, js_document_createElement, "createElement", 1));
     JS_SetPropertyStr(ctx, document, "elementFromPoint",
                       JS_NewCFunction(ctx, js_document_elementFromPoint, "elementFromPoint", 2));
-    /* stubs for now */
-    JS_SetPropertyStr(ctx, document, "getElementById", JS_UNDEFINED);
-    JS_SetPropertyStr(ctx, document, "querySelector", JS_UNDEFINED);
+    JS_SetPropertyStr(ctx, document, "getElementById",
+                      JS_NewCFunction(ctx, js_document_getElementById, "getElementById", 1));
 
-    JS_SetPropertyStr(ctx, document, "__nodeId", JS_NewInt32(ctx, MINIREND_NODE_DOCUMENT));
     JS_SetPropertyStr(ctx, global_obj, "document", JS_DupValue(ctx, document));
 
     /* Install EventTarget + helpers now that document exists. */
     minirend_dom_runtime_init(ctx);
+    inherit_event_target(ctx);
+    minirend_dom_mutations_init(ctx);
+    minirend_dom_event_types_init(ctx);
+    JS_SetPropertyStr(ctx, global_obj, "__minirendNativeStyleChanged",
+                      JS_NewCFunction(ctx, js_native_style_changed, "__minirendNativeStyleChanged", 1));
 
-    /* Register document (node 1) after runtime init so it gets the prototype. */
     minirend_dom_register_node(ctx, MINIREND_NODE_DOCUMENT, document);
+    minirend_dom_retain_node(ctx, MINIREND_NODE_DOCUMENT, true);
 
     /* body element (node 2) */
-    JSValue body = make_element(ctx, "body", MINIREND_NODE_BODY);
+    JSValue body = make_element(ctx, minirend_lexbor_get_body(g_doc), MINIREND_NODE_BODY);
     JS_SetPropertyStr(ctx, document, "body", JS_DupValue(ctx, body));
     JS_SetPropertyStr(ctx, document, "activeElement", JS_DupValue(ctx, body));
 
-    /* Provide appendChild on body for basic tree building. */
-    JS_SetPropertyStr(ctx, body, "appendChild",
-                      JS_NewCFunction(ctx, js_element_appendChild, "appendChild", 1));
-    JS_SetPropertyStr(ctx, document, "appendChild",
-                      JS_NewCFunction(ctx, js_element_appendChild, "appendChild", 1));
-
     /* Keep UI tree viewport in sync with the default innerWidth/innerHeight. */
     minirend_ui_tree_set_viewport(1280, 720);
 
@@ -0,0 +1,45 @@
+#ifndef MINIREND_DOM_ELEMENT_H
+#define MINIREND_DOM_ELEMENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "quickjs.h"
+#include "dom_events.h"
+
+typedef struct lxb_dom_node lxb_dom_node_t;
+
+/* Elements are native objects wrapping lexbor nodes: tree links are read
+ * from (and mutations go straight into) the lexbor tree, through getters
+ * on a shared prototype (which also carries the native EventTarget
+ * methods and inherits focus/pointer capture from dom_runtime). A node's wrapper hangs off lxb_dom_node_t.user and is
+ * created the first time script reaches the node. While the node is
+ * connected the registry retains the wrapper. In a detached tree each
+ * wrapper and its nearest wrapped ancestor hold each other, so holding
+ * any wrapper keeps the whole tree's wrappers (listeners, expandos) alive;
+ * an unreachable tree is collected as a cycle, and once its last wrapper
+ * is finalized its lexbor nodes are freed too. `children` and `style` are only created when
+ * script reads them. */
+typedef struct DomElement {
+    int32_t         node_id;
+    lxb_dom_node_t *node; /* NULL if the document failed to load */
+    JSValue         obj;  /* not owned; this is the wrapper itself */
+
+    JSValue children; /* cached array, JS_UNDEFINED until read */
+    JSValue style;    /* JS_UNDEFINED until read */
+    bool    style_pending; /* queued for the next flush */
+
+    MinirendEventTarget events; /* listeners, owned by the wrapper */
+
+    /* Only while detached: the nearest wrapped ancestor's wrapper, and the
+     * wrappers of the descendants this one is the nearest ancestor of. */
+    JSValue  owner; /* JS_UNDEFINED if none */
+    JSValue *owned;
+    int      owned_len;
+    int      owned_cap;
+} DomElement;
+
+/* The element behind a wrapper (document included), or NULL. */
+DomElement *minirend_dom_get_element(JSValueConst val);
+
+#endif /* MINIREND_DOM_ELEMENT_H */
@@ -0,0 +1,480 @@
+#include "dom_event_types.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+enum { EVENT_POOL_CAP = 4 };
+
+typedef struct EventKindInfo {
+    const char       *name;   /* global constructor; NULL if not exposed */
+    MinirendEventKind parent; /* the base kind inherits Event.prototype */
+} EventKindInfo;
+
+static const EventKindInfo k_kinds[MINIREND_EVENT_KIND_COUNT] = {
+    [MINIREND_EVENT_BASIC]    = { NULL,            MINIREND_EVENT_BASIC },
+    [MINIREND_EVENT_MOUSE]    = { "MouseEvent",    MINIREND_EVENT_BASIC },
+    [MINIREND_EVENT_POINTER]  = { "PointerEvent",  MINIREND_EVENT_MOUSE },
+    [MINIREND_EVENT_WHEEL]    = { "WheelEvent",    MINIREND_EVENT_MOUSE },
+    [MINIREND_EVENT_KEYBOARD] = { "KeyboardEvent", MINIREND_EVENT_BASIC },
+    [MINIREND_EVENT_FOCUS]    = { "FocusEvent",    MINIREND_EVENT_BASIC },
+    [MINIREND_EVENT_TEXT]     = { "TextEvent",     MINIREND_EVENT_BASIC },
+};
+
+enum {
+    F_TYPE,
+    F_BUBBLES,
+    F_CANCELABLE,
+    F_DEFAULT_PREVENTED,
+    F_EVENT_PHASE,
+    F_TARGET,
+    F_CURRENT_TARGET,
+    F_TIME_STAMP,
+    F_IS_TRUSTED,
+    F_CLIENT_X,
+    F_CLIENT_Y,
+    F_BUTTON,
+    F_BUTTONS,
+    F_ALT_KEY,
+    F_CTRL_KEY,
+    F_SHIFT_KEY,
+    F_META_KEY,
+    F_POINTER_ID,
+    F_POINTER_TYPE,
+    F_IS_PRIMARY,
+    F_DELTA_X,
+    F_DELTA_Y,
+    F_DELTA_MODE,
+    F_KEY_CODE,
+    F_DATA,
+};
+
+typedef struct EventField {
+    const char       *name;
+    int               field;
+    MinirendEventKind kind; /* prototype the getter lives on */
+} EventField;
+
+static const EventField k_fields[] = {
+    { "type",             F_TYPE,              MINIREND_EVENT_BASIC },
+    { "bubbles",          F_BUBBLES,           MINIREND_EVENT_BASIC },
+    { "cancelable",       F_CANCELABLE,        MINIREND_EVENT_BASIC },
+    { "defaultPrevented", F_DEFAULT_PREVENTED, MINIREND_EVENT_BASIC },
+    { "eventPhase",       F_EVENT_PHASE,       MINIREND_EVENT_BASIC },
+    { "target",           F_TARGET,            MINIREND_EVENT_BASIC },
+    { "currentTarget",    F_CURRENT_TARGET,    MINIREND_EVENT_BASIC },
+    { "timeStamp",        F_TIME_STAMP,        MINIREND_EVENT_BASIC },
+    { "isTrusted",        F_IS_TRUSTED,        MINIREND_EVENT_BASIC },
+
+    { "clientX",          F_CLIENT_X,          MINIREND_EVENT_MOUSE },
+    { "clientY",          F_CLIENT_Y,          MINIREND_EVENT_MOUSE },
+    { "button",           F_BUTTON,            MINIREND_EVENT_MOUSE },
+    { "buttons",          F_BUTTONS,           MINIREND_EVENT_MOUSE },
+    { "altKey",           F_ALT_KEY,           MINIREND_EVENT_MOUSE },
+    { "ctrlKey",          F_CTRL_KEY,          MINIREND_EVENT_MOUSE },
+    { "shiftKey",         F_SHIFT_KEY,         MINIREND_EVENT_MOUSE },
+    { "metaKey",          F_META_KEY,          MINIREND_EVENT_MOUSE },
+
+    { "pointerId",        F_POINTER_ID,        MINIREND_EVENT_POINTER },
+    { "pointerType",      F_POINTER_TYPE,      MINIREND_EVENT_POINTER },
+    { "isPrimary",        F_IS_PRIMARY,        MINIREND_EVENT_POINTER },
+
+    { "deltaX",           F_DELTA_X,           MINIREND_EVENT_WHEEL },
+    { "deltaY",           F_DELTA_Y,           MINIREND_EVENT_WHEEL },
+    { "deltaMode",        F_DELTA_MODE,        MINIREND_EVENT_WHEEL },
+
+    { "keyCode",          F_KEY_CODE,          MINIREND_EVENT_KEYBOARD },
+    { "altKey",           F_ALT_KEY,           MINIREND_EVENT_KEYBOARD },
+    { "ctrlKey",          F_CTRL_KEY,          MINIREND_EVENT_KEYBOARD },
+    { "shiftKey",         F_SHIFT_KEY,         MINIREND_EVENT_KEYBOARD },
+    { "metaKey",          F_META_KEY,          MINIREND_EVENT_KEYBOARD },
+
+    { "data",             F_DATA,              MINIREND_EVENT_TEXT },
+};
+
+static JSClassID js_event_class_id;
+static JSValue   g_protos[MINIREND_EVENT_KIND_COUNT];
+static bool      g_ready = false;
+
+/* Recycled event objects per kind (owned refs). */
+static JSValue g_pool[MINIREND_EVENT_KIND_COUNT][EVENT_POOL_CAP];
+static int     g_pool_len[MINIREND_EVENT_KIND_COUNT];
+
+static void event_clear(MinirendDomEvent *e, MinirendEventKind kind) {
+    MinirendPointerSample *samples = e->samples;
+    int sample_cap = e->sample_cap;
+    memset(e, 0, sizeof(*e));
+    e->kind = kind;
+    e->type = JS_ATOM_NULL;
+    e->target = JS_NULL;
+    e->current_target = JS_NULL;
+    e->data = JS_UNDEFINED;
+    e->samples = samples;
+    e->sample_cap = sample_cap;
+    e->coalesced = JS_UNDEFINED;
+}
+
+static void event_reset(JSRuntime *rt, MinirendDomEvent *e) {
+    JS_FreeAtomRT(rt, e->type);
+    JS_FreeValueRT(rt, e->target);
+    JS_FreeValueRT(rt, e->current_target);
+    JS_FreeValueRT(rt, e->data);
+    JS_FreeValueRT(rt, e->coalesced);
+    event_clear(e, e->kind);
+}
+
+static void js_event_finalizer(JSRuntime *rt, JSValue val) {
+    MinirendDomEvent *e = (MinirendDomEvent *)JS_GetOpaque(val, js_event_class_id);
+    if (!e) return;
+    event_reset(rt, e);
+    free(e->samples);
+    free(e);
+}
+
+static void js_event_gc_mark(JSRuntime *rt, JSValueConst val, JS_MarkFunc *mark_func) {
+    MinirendDomEvent *e = (MinirendDomEvent *)JS_GetOpaque(val, js_event_class_id);
+    if (!e) return;
+    JS_MarkValue(rt, e->target, mark_func);
+    JS_MarkValue(rt, e->current_target, mark_func);
+    JS_MarkValue(rt, e->data, mark_func);
+    JS_MarkValue(rt, e->coalesced, mark_func);
+}
+
+static JSClassDef js_event_class = {
+    "UIEvent",
+    .finalizer = js_event_finalizer,
+    .gc_mark = js_event_gc_mark,
+};
+
+MinirendDomEvent *minirend_dom_event_get(JSValueConst val) {
+    return (MinirendDomEvent *)JS_GetOpaque(val, js_event_class_id);
+}
+
+static JSValue event_alloc(JSContext *ctx, MinirendEventKind kind, MinirendDomEvent **out) {
+    *out = NULL;
+    MinirendDomEvent *e = (MinirendDomEvent *)calloc(1, sizeof(MinirendDomEvent));
+    if (!e) return JS_ThrowOutOfMemory(ctx);
+    JSValue obj = JS_NewObjectProtoClass(ctx, g_protos[kind], js_event_class_id);
+    if (JS_IsException(obj)) {
+        free(e);
+        return obj;
+    }
+    event_clear(e, kind);
+    JS_SetOpaque(obj, e);
+    *out = e;
+    return obj;
+}
+
+JSValue minirend_dom_event_new(JSContext *ctx, MinirendEventKind kind, JSAtom type,
+                               bool bubbles, bool cancelable, uint32_t time_ms,
+                               MinirendDomEvent **out) {
+    *out = NULL;
+    if (!g_ready) return JS_ThrowInternalError(ctx, "event types not initialized");
+
+    MinirendDomEvent *e;
+    JSValue ev;
+    if (g_pool_len[kind] > 0) {
+        ev = g_pool[kind][--g_pool_len[kind]];
+        e = minirend_dom_event_get(ev);
+        /* A listener may have swapped it; nothing else can tell. */
+        JS_SetPrototype(ctx, ev, g_protos[kind]);
+    } else {
+        ev = event_alloc(ctx, kind, &e);
+        if (JS_IsException(ev)) return ev;
+    }
+    e->type = JS_DupAtom(ctx, type);
+    e->bubbles = bubbles;
+    e->cancelable = cancelable;
+    e->trusted = true;
+    e->time_ms = time_ms;
+    *out = e;
+    return ev;
+}
+
+bool minirend_dom_event_add_sample(MinirendDomEvent *e, const MinirendPointerSample *sample) {
+    if (e->sample_count == e->sample_cap) {
+        int new_cap = e->sample_cap ? (e->sample_cap * 2) : 8;
+        MinirendPointerSample *ns = (MinirendPointerSample *)realloc(e->samples, (size_t)new_cap * sizeof(MinirendPointerSample));
+        if (!ns) return false;
+        e->samples = ns;
+        e->sample_cap = new_cap;
+    }
+    e->samples[e->sample_count++] = *sample;
+    return true;
+}
+
+/* Nothing but the caller references ev and script left nothing on it,
+ * so handing it out again is unobservable. */
+static bool recyclable(JSContext *ctx, JSValueConst ev) {
+    if (((JSRefCountHeader *)JS_VALUE_GET_PTR(ev))->ref_count != 1) return false;
+    if (JS_IsExtensible(ctx, ev) <= 0) return false;
+
+    JSPropertyEnum *props = NULL;
+    uint32_t len = 0;
+    if (JS_GetOwnPropertyNames(ctx, &props, &len, ev, JS_GPN_STRING_MASK | JS_GPN_SYMBOL_MASK) < 0) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        return false;
+    }
+    JS_FreePropertyEnum(ctx, props, len);
+    return len == 0;
+}
+
+void minirend_dom_event_release(JSContext *ctx, JSValue ev) {
+    MinirendDomEvent *e = minirend_dom_event_get(ev);
+    if (e && e->trusted && g_ready && g_pool_len[e->kind] < EVENT_POOL_CAP && recyclable(ctx, ev)) {
+        MinirendEventKind kind = e->kind;
+        event_reset(JS_GetRuntime(ctx), e);
+        g_pool[kind][g_pool_len[kind]++] = ev;
+        return;
+    }
+    JS_FreeValue(ctx, ev);
+}
+
+static JSValue js_event_get(JSContext *ctx, JSValueConst this_val, int magic) {
+    MinirendDomEvent *e = minirend_dom_event_get(this_val);
+    if (!e) return JS_ThrowTypeError(ctx, "not an event");
+    switch (magic) {
+        case F_TYPE:              return JS_AtomToString(ctx, e->type);
+        case F_BUBBLES:           return JS_NewBool(ctx, e->bubbles);
+        case F_CANCELABLE:        return JS_NewBool(ctx, e->cancelable);
+        case F_DEFAULT_PREVENTED: return JS_NewBool(ctx, e->default_prevented);
+        case F_EVENT_PHASE:       return JS_NewInt32(ctx, e->phase);
+        case F_TARGET:            return JS_DupValue(ctx, e->target);
+        case F_CURRENT_TARGET:    return JS_DupValue(ctx, e->current_target);
+        case F_TIME_STAMP:        return JS_NewInt32(ctx, (int32_t)e->time_ms);
+        case F_IS_TRUSTED:        return JS_NewBool(ctx, e->trusted);
+        case F_CLIENT_X:          return JS_NewFloat64(ctx, (double)e->client_x);
+        case F_CLIENT_Y:          return JS_NewFloat64(ctx, (double)e->client_y);
+        case F_BUTTON:            return JS_NewInt32(ctx, e->button);
+        case F_BUTTONS:           return JS_NewInt32(ctx, (int32_t)e->buttons);
+        case F_ALT_KEY:           return JS_NewBool(ctx, e->alt_key);
+        case F_CTRL_KEY:          return JS_NewBool(ctx, e->ctrl_key);
+        case F_SHIFT_KEY:         return JS_NewBool(ctx, e->shift_key);
+        case F_META_KEY:          return JS_NewBool(ctx, e->meta_key);
+        case F_POINTER_ID:        return JS_NewInt32(ctx, e->pointer_id);
+        case F_POINTER_TYPE:      return JS_NewString(ctx, "mouse");
+        case F_IS_PRIMARY:        return JS_NewBool(ctx, e->is_primary);
+        case F_DELTA_X:           return JS_NewFloat64(ctx, (double)e->delta_x);
+        case F_DELTA_Y:           return JS_NewFloat64(ctx, (double)e->delta_y);
+        case F_DELTA_MODE:        return JS_NewInt32(ctx, 0); /* pixels */
+        case F_KEY_CODE:          return JS_NewInt32(ctx, (int32_t)e->key_code);
+        case F_DATA:              return JS_DupValue(ctx, e->data);
+        default:                  return JS_UNDEFINED;
+    }
+}
+
+static JSValue js_event_preventDefault(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    MinirendDomEvent *e = minirend_dom_event_get(this_val);
+    if (e && e->cancelable) e->default_prevented = true;
+    return JS_UNDEFINED;
+}
+
+static JSValue js_event_stopPropagation(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    MinirendDomEvent *e = minirend_dom_event_get(this_val);
+    if (e) e->stop = true;
+    return JS_UNDEFINED;
+}
+
+static JSValue js_event_stopImmediatePropagation(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    MinirendDomEvent *e = minirend_dom_event_get(this_val);
+    if (e) {
+        e->stop = true;
+        e->stop_immediate = true;
+    }
+    return JS_UNDEFINED;
+}
+
+/* The coalesced events share the parent's type and target; each takes
+ * its position, buttons and modifiers from one sample. */
+static JSValue build_coalesced(JSContext *ctx, MinirendDomEvent *e) {
+    JSValue list = JS_NewArray(ctx);
+    if (JS_IsException(list)) return list;
+    for (int i = 0; i < e->sample_count; i++) {
+        const MinirendPointerSample *sample = &e->samples[i];
+        MinirendDomEvent *c;
+        JSValue ev = event_alloc(ctx, MINIREND_EVENT_POINTER, &c);
+        if (JS_IsException(ev)) {
+            JS_FreeValue(ctx, list);
+            return ev;
+        }
+        c->type = JS_DupAtom(ctx, e->type);
+        c->trusted = e->trusted;
+        c->time_ms = sample->time_ms;
+        c->target = JS_DupValue(ctx, e->target);
+        c->client_x = sample->client_x;
+        c->client_y = sample->client_y;
+        c->button = e->button;
+        c->buttons = sample->buttons;
+        c->pointer_id = e->pointer_id;
+        c->is_primary = e->is_primary;
+        c->alt_key = sample->alt_key;
+        c->ctrl_key = sample->ctrl_key;
+        c->shift_key = sample->shift_key;
+        c->meta_key = sample->meta_key;
+        JS_SetPropertyUint32(ctx, list, (uint32_t)i, ev);
+    }
+    return list;
+}
+
+static JSValue js_event_getCoalescedEvents(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    MinirendDomEvent *e = minirend_dom_event_get(this_val);
+    if (!e) return JS_ThrowTypeError(ctx, "not an event");
+    if (JS_IsUndefined(e->coalesced)) {
+        JSValue list = build_coalesced(ctx, e);
+        if (JS_IsException(list)) return list;
+        e->coalesced = list;
+    }
+
+    /* A fresh array each call, over the same events. */
+    JSValue out = JS_NewArray(ctx);
+    if (JS_IsException(out)) return out;
+    for (int i = 0; i < e->sample_count; i++) {
+        JS_SetPropertyUint32(ctx, out, (uint32_t)i, JS_GetPropertyUint32(ctx, e->coalesced, (uint32_t)i));
+    }
+    return out;
+}
+
+static bool init_bool(JSContext *ctx, JSValueConst init, const char *name) {
+    JSValue v = JS_GetPropertyStr(ctx, init, name);
+    int b = JS_ToBool(ctx, v);
+    JS_FreeValue(ctx, v);
+    return b > 0;
+}
+
+/* Non-numbers (undefined included) leave the default. */
+static double init_number(JSContext *ctx, JSValueConst init, const char *name, double def) {
+    JSValue v = JS_GetPropertyStr(ctx, init, name);
+    double d = def;
+    if (JS_IsNumber(v)) JS_ToFloat64(ctx, &d, v);
+    JS_FreeValue(ctx, v);
+    return d;
+}
+
+static void apply_init(JSContext *ctx, MinirendDomEvent *e, JSValueConst init) {
+    e->bubbles = init_bool(ctx, init, "bubbles");
+    e->cancelable = init_bool(ctx, init, "cancelable");
+    e->time_ms = (uint32_t)init_number(ctx, init, "timeStamp", 0);
+
+    switch (e->kind) {
+        case MINIREND_EVENT_MOUSE:
+        case MINIREND_EVENT_POINTER:
+        case MINIREND_EVENT_WHEEL:
+            e->client_x = (float)init_number(ctx, init, "clientX", 0);
+            e->client_y = (float)init_number(ctx, init, "clientY", 0);
+            e->button = (int)init_number(ctx, init, "button", 0);
+            e->buttons = (uint32_t)init_number(ctx, init, "buttons", 0);
+            e->pointer_id = (int32_t)init_number(ctx, init, "pointerId", 0);
+            e->is_primary = init_bool(ctx, init, "isPrimary");
+            e->delta_x = (float)init_number(ctx, init, "deltaX", 0);
+            e->delta_y = (float)init_number(ctx, init, "deltaY", 0);
+            break;
+        case MINIREND_EVENT_KEYBOARD:
+            e->key_code = (uint32_t)init_number(ctx, init, "keyCode", 0);
+            break;
+        case MINIREND_EVENT_TEXT: {
+            JSValue data = JS_GetPropertyStr(ctx, init, "data");
+            if (JS_IsString(data)) {
+                e->data = data;
+            } else {
+                JS_FreeValue(ctx, data);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    e->alt_key = init_bool(ctx, init, "altKey");
+    e->ctrl_key = init_bool(ctx, init, "ctrlKey");
+    e->shift_key = init_bool(ctx, init, "shiftKey");
+    e->meta_key = init_bool(ctx, init, "metaKey");
+}
+
+/* new MouseEvent(type, init) and friends: untrusted, never pooled. */
+static JSValue js_event_ctor(JSContext *ctx, JSValueConst new_target, int argc, JSValueConst *argv, int magic) {
+    if (argc < 1) return JS_ThrowTypeError(ctx, "event type required");
+    JSValue type_str = JS_ToString(ctx, argv[0]);
+    if (JS_IsException(type_str)) return type_str;
+    JSAtom type = JS_ValueToAtom(ctx, type_str);
+    JS_FreeValue(ctx, type_str);
+    if (type == JS_ATOM_NULL) return JS_EXCEPTION;
+
+    MinirendDomEvent *e;
+    JSValue ev = event_alloc(ctx, (MinirendEventKind)magic, &e);
+    if (JS_IsException(ev)) {
+        JS_FreeAtom(ctx, type);
+        return ev;
+    }
+    e->type = type;
+    if (argc >= 2 && JS_IsObject(argv[1])) apply_init(ctx, e, argv[1]);
+    return ev;
+}
+
+static JSValue event_base_proto(JSContext *ctx) {
+    JSValue global = JS_GetGlobalObject(ctx);
+    JSValue ctor = JS_GetPropertyStr(ctx, global, "Event");
+    JSValue proto = JS_IsFunction(ctx, ctor) ? JS_GetPropertyStr(ctx, ctor, "prototype") : JS_UNDEFINED;
+    JS_FreeValue(ctx, ctor);
+    JS_FreeValue(ctx, global);
+    return JS_IsObject(proto) ? JS_NewObjectProto(ctx, proto) : JS_NewObject(ctx);
+}
+
+void minirend_dom_event_types_init(JSContext *ctx) {
+    static int registered = 0;
+    if (!registered) {
+        registered = 1;
+        JS_NewClassID(&js_event_class_id);
+        JS_NewClass(JS_GetRuntime(ctx), js_event_class_id, &js_event_class);
+    }
+
+    JSValue global = JS_GetGlobalObject(ctx);
+    for (int kind = 0; kind < MINIREND_EVENT_KIND_COUNT; kind++) {
+        JSValue proto = (kind == MINIREND_EVENT_BASIC)
+            ? event_base_proto(ctx)
+            : JS_NewObjectProto(ctx, g_protos[k_kinds[kind].parent]);
+        g_protos[kind] = proto;
+
+        for (size_t i = 0; i < sizeof(k_fields) / sizeof(k_fields[0]); i++) {
+            if ((int)k_fields[i].kind != kind) continue;
+            JSAtom atom = JS_NewAtom(ctx, k_fields[i].name);
+            JS_DefinePropertyGetSet(ctx, proto, atom,
+                JS_NewCFunction2(ctx, (JSCFunction *)js_event_get, k_fields[i].name, 0,
+                                 JS_CFUNC_getter_magic, k_fields[i].field),
+                JS_UNDEFINED, JS_PROP_CONFIGURABLE);
+            JS_FreeAtom(ctx, atom);
+        }
+
+        if (kind == MINIREND_EVENT_BASIC) {
+            JS_SetPropertyStr(ctx, proto, "preventDefault",
+                              JS_NewCFunction(ctx, js_event_preventDefault, "preventDefault", 0));
+            JS_SetPropertyStr(ctx, proto, "stopPropagation",
+                              JS_NewCFunction(ctx, js_event_stopPropagation, "stopPropagation", 0));
+            JS_SetPropertyStr(ctx, proto, "stopImmediatePropagation",
+                              JS_NewCFunction(ctx, js_event_stopImmediatePropagation, "stopImmediatePropagation", 0));
+        } else if (kind == MINIREND_EVENT_POINTER) {
+            JS_SetPropertyStr(ctx, proto, "getCoalescedEvents",
+                              JS_NewCFunction(ctx, js_event_getCoalescedEvents, "getCoalescedEvents", 0));
+        }
+
+        if (k_kinds[kind].name) {
+            JSValue ctor = JS_NewCFunctionMagic(ctx, js_event_ctor, k_kinds[kind].name, 2,
+                                                JS_CFUNC_constructor_magic, kind);
+            JS_SetConstructor(ctx, ctor, proto);
+            JS_SetPropertyStr(ctx, global, k_kinds[kind].name, ctor);
+        }
+    }
+    JS_FreeValue(ctx, global);
+    g_ready = true;
+}
+
+void minirend_dom_event_types_shutdown(JSContext *ctx) {
+    for (int kind = 0; kind < MINIREND_EVENT_KIND_COUNT; kind++) {
+        for (int i = 0; i < g_pool_len[kind]; i++) JS_FreeValue(ctx, g_pool[kind][i]);
+        g_pool_len[kind] = 0;
+    }
+    if (g_ready) {
+        for (int kind = 0; kind < MINIREND_EVENT_KIND_COUNT; kind++) {
+            JS_FreeValue(ctx, g_protos[kind]);
+            g_protos[kind] = JS_UNDEFINED;
+        }
+        g_ready = false;
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef MINIREND_DOM_EVENT_TYPES_H
+#define MINIREND_DOM_EVENT_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "quickjs.h"
+
+/* Native UI event objects (MouseEvent, PointerEvent, WheelEvent,
+ * KeyboardEvent, FocusEvent, TextEvent):
+ * - fields live in C and are read through getters on one prototype per
+ *   kind, all inheriting the bootstrap's Event.prototype
+ * - dom_events reads and updates their dispatch state directly
+ * - trusted events nothing references after dispatch go back to a pool
+ */
+
+typedef enum {
+    MINIREND_EVENT_BASIC = 0,
+    MINIREND_EVENT_MOUSE,
+    MINIREND_EVENT_POINTER,
+    MINIREND_EVENT_WHEEL,
+    MINIREND_EVENT_KEYBOARD,
+    MINIREND_EVENT_FOCUS,
+    MINIREND_EVENT_TEXT,
+    MINIREND_EVENT_KIND_COUNT
+} MinirendEventKind;
+
+/* One raw position folded into a coalesced pointermove. */
+typedef struct MinirendPointerSample {
+    float    client_x;
+    float    client_y;
+    uint32_t buttons;
+    uint32_t time_ms;
+    bool     alt_key;
+    bool     ctrl_key;
+    bool     shift_key;
+    bool     meta_key;
+} MinirendPointerSample;
+
+typedef struct MinirendDomEvent {
+    MinirendEventKind kind;
+    JSAtom   type;
+    bool     bubbles;
+    bool     cancelable;
+    bool     trusted; /* created by the host rather than by script */
+    bool     default_prevented;
+    bool     stop;
+    bool     stop_immediate;
+    int      phase;
+    uint32_t time_ms;
+    JSValue  target;         /* owned; JS_NULL until dispatched */
+    JSValue  current_target; /* owned; JS_NULL outside dispatch */
+
+    /* Mouse/pointer/wheel */
+    float    client_x;
+    float    client_y;
+    int      button;
+    uint32_t buttons;
+    int32_t  pointer_id;
+    bool     is_primary;
+    float    delta_x;
+    float    delta_y;
+
+    /* Keyboard */
+    uint32_t key_code;
+
+    /* Mouse, wheel and keyboard */
+    bool     alt_key;
+    bool     ctrl_key;
+    bool     shift_key;
+    bool     meta_key;
+
+    /* Text */
+    JSValue  data; /* owned; JS_UNDEFINED unless set */
+
+    /* Pointer: the samples behind getCoalescedEvents(), oldest first.
+     * The buffer survives pooling. */
+    MinirendPointerSample *samples;
+    int      sample_count;
+    int      sample_cap;
+    JSValue  coalesced; /* owned; the events, built on first call */
+} MinirendDomEvent;
+
+/* Needs the dom_runtime bootstrap (for Event.prototype). Also installs
+ * the event constructors as globals. */
+void minirend_dom_event_types_init(JSContext *ctx);
+void minirend_dom_event_types_shutdown(JSContext *ctx);
+
+/* A trusted event of the given kind, taken from the pool when possible.
+ * Every field past the ones given is zeroed; fill them through *out
+ * before dispatching. JS_EXCEPTION (and *out NULL) on failure. */
+JSValue minirend_dom_event_new(JSContext *ctx, MinirendEventKind kind, JSAtom type,
+                               bool bubbles, bool cancelable, uint32_t time_ms,
+                               MinirendDomEvent **out);
+
+/* Appends a sample for getCoalescedEvents(). */
+bool minirend_dom_event_add_sample(MinirendDomEvent *e, const MinirendPointerSample *sample);
+
+/* The native event behind val, or NULL for script-made events. */
+MinirendDomEvent *minirend_dom_event_get(JSValueConst val);
+
+/* Drops a reference to any event; a trusted one nothing else references
+ * (and script left untouched) is recycled. */
+void minirend_dom_event_release(JSContext *ctx, JSValue ev);
+
+#endif /* MINIREND_DOM_EVENT_TYPES_H */
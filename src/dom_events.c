@@ -0,0 +1,607 @@
+#include "dom_events.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <lexbor/dom/dom.h>
+
+#include "dom_element.h"
+#include "dom_event_types.h"
+
+struct MinirendListener {
+    JSValue callback; /* function, or object with handleEvent */
+    JSAtom  type;
+    bool    capture;
+    bool    once;
+    bool    handler;  /* set through an on<type> property */
+    bool    removed;  /* skipped; compacted once no dispatch walks the list */
+};
+
+enum {
+    PHASE_NONE      = 0,
+    PHASE_CAPTURING = 1,
+    PHASE_AT_TARGET = 2,
+    PHASE_BUBBLING  = 3,
+};
+
+/* Types with a native on<type> accessor. For any other type dispatch
+ * looks the on<type> property up on each node and calls a function. */
+static const char *const k_handler_types[] = {
+    "click", "dblclick", "contextmenu",
+    "mousedown", "mouseup", "mousemove",
+    "pointerdown", "pointerup", "pointermove",
+    "wheel", "keydown", "keyup", "textinput",
+    "focus", "blur", "input", "change", "scroll",
+};
+#define HANDLER_COUNT ((int)(sizeof(k_handler_types) / sizeof(k_handler_types[0])))
+
+static JSAtom g_handler_atoms[HANDLER_COUNT];
+static JSAtom g_atom_type;
+static JSAtom g_atom_bubbles;
+static JSAtom g_atom_target;
+static JSAtom g_atom_current_target;
+static JSAtom g_atom_event_phase;
+static JSAtom g_atom_default_prevented;
+static JSAtom g_atom_stop;
+static JSAtom g_atom_stop_immediate;
+static JSAtom g_atom_handle_event;
+static bool   g_atoms_ready = false;
+
+/* globalThis.Event from the dom_runtime bootstrap, looked up on first use. */
+static JSValue g_event_ctor = JS_UNDEFINED;
+
+/* Wrappers on the paths of running dispatches (owned refs). A dispatch
+ * started from a listener stacks its path above its caller's. */
+static JSValue *g_path = NULL;
+static int      g_path_len = 0;
+static int      g_path_cap = 0;
+
+static void dump_exception(JSContext *ctx) {
+    JSValue ex = JS_GetException(ctx);
+    const char *s = JS_ToCString(ctx, ex);
+    if (s) {
+        fprintf(stderr, "JS exception: %s\n", s);
+        JS_FreeCString(ctx, s);
+    }
+    JS_FreeValue(ctx, ex);
+}
+
+static void init_atoms(JSContext *ctx) {
+    if (g_atoms_ready) return;
+    g_atom_type = JS_NewAtom(ctx, "type");
+    g_atom_bubbles = JS_NewAtom(ctx, "bubbles");
+    g_atom_target = JS_NewAtom(ctx, "target");
+    g_atom_current_target = JS_NewAtom(ctx, "currentTarget");
+    g_atom_event_phase = JS_NewAtom(ctx, "eventPhase");
+    g_atom_default_prevented = JS_NewAtom(ctx, "defaultPrevented");
+    g_atom_stop = JS_NewAtom(ctx, "_stop");
+    g_atom_stop_immediate = JS_NewAtom(ctx, "_stopImmediate");
+    g_atom_handle_event = JS_NewAtom(ctx, "handleEvent");
+    for (int i = 0; i < HANDLER_COUNT; i++) {
+        g_handler_atoms[i] = JS_NewAtom(ctx, k_handler_types[i]);
+    }
+    g_atoms_ready = true;
+}
+
+static void free_listener(JSRuntime *rt, MinirendListener *l) {
+    JS_FreeValueRT(rt, l->callback);
+    JS_FreeAtomRT(rt, l->type);
+}
+
+static void compact(JSRuntime *rt, MinirendEventTarget *t) {
+    int j = 0;
+    for (int i = 0; i < t->len; i++) {
+        if (t->listeners[i].removed) {
+            free_listener(rt, &t->listeners[i]);
+        } else {
+            t->listeners[j++] = t->listeners[i];
+        }
+    }
+    t->len = j;
+    t->has_removed = false;
+}
+
+static void remove_at(JSRuntime *rt, MinirendEventTarget *t, int i) {
+    /* Running dispatches index the list; only mark it for them. */
+    if (t->iterating) {
+        t->listeners[i].removed = true;
+        t->has_removed = true;
+        return;
+    }
+    MinirendListener l = t->listeners[i];
+    memmove(&t->listeners[i], &t->listeners[i + 1], (size_t)(t->len - i - 1) * sizeof(MinirendListener));
+    t->len--;
+    free_listener(rt, &l);
+}
+
+static bool add_listener(JSContext *ctx, MinirendEventTarget *t, JSAtom type, JSValueConst callback,
+                         bool capture, bool once, bool handler) {
+    if (t->len == t->cap) {
+        int new_cap = t->cap ? (t->cap * 2) : 4;
+        MinirendListener *nl = (MinirendListener *)realloc(t->listeners, (size_t)new_cap * sizeof(MinirendListener));
+        if (!nl) return false;
+        t->listeners = nl;
+        t->cap = new_cap;
+    }
+    t->listeners[t->len++] = (MinirendListener){
+        .callback = JS_DupValue(ctx, callback),
+        .type = JS_DupAtom(ctx, type),
+        .capture = capture,
+        .once = once,
+        .handler = handler,
+        .removed = false,
+    };
+    return true;
+}
+
+static bool same_callback(JSValueConst a, JSValueConst b) {
+    return JS_VALUE_GET_TAG(a) == JS_VALUE_GET_TAG(b) && JS_VALUE_GET_PTR(a) == JS_VALUE_GET_PTR(b);
+}
+
+static int find_listener(const MinirendEventTarget *t, JSAtom type, JSValueConst callback, bool capture) {
+    for (int i = 0; i < t->len; i++) {
+        const MinirendListener *l = &t->listeners[i];
+        if (!l->removed && !l->handler && l->type == type && l->capture == capture &&
+            same_callback(l->callback, callback)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int find_handler(const MinirendEventTarget *t, JSAtom type) {
+    for (int i = 0; i < t->len; i++) {
+        const MinirendListener *l = &t->listeners[i];
+        if (!l->removed && l->handler && l->type == type) return i;
+    }
+    return -1;
+}
+
+static bool listens(const MinirendEventTarget *t, JSAtom type) {
+    for (int i = 0; i < t->len; i++) {
+        if (!t->listeners[i].removed && t->listeners[i].type == type) return true;
+    }
+    return false;
+}
+
+void minirend_event_target_free(JSRuntime *rt, MinirendEventTarget *t) {
+    for (int i = 0; i < t->len; i++) free_listener(rt, &t->listeners[i]);
+    free(t->listeners);
+    memset(t, 0, sizeof(*t));
+}
+
+void minirend_event_target_mark(JSRuntime *rt, MinirendEventTarget *t, JS_MarkFunc *mark_func) {
+    for (int i = 0; i < t->len; i++) JS_MarkValue(rt, t->listeners[i].callback, mark_func);
+}
+
+static bool event_flag(JSContext *ctx, JSValueConst event, JSAtom atom) {
+    JSValue v = JS_GetProperty(ctx, event, atom);
+    int b = JS_ToBool(ctx, v);
+    JS_FreeValue(ctx, v);
+    return b > 0;
+}
+
+/* The event being dispatched. Native events (dom_event_types) keep their
+ * dispatch state in C; script-made ones keep it in properties. */
+typedef struct EventView {
+    JSValueConst      obj;
+    MinirendDomEvent *native;
+} EventView;
+
+static bool ev_stopped(JSContext *ctx, const EventView *ev) {
+    return ev->native ? ev->native->stop : event_flag(ctx, ev->obj, g_atom_stop);
+}
+
+static bool ev_stopped_immediate(JSContext *ctx, const EventView *ev) {
+    return ev->native ? ev->native->stop_immediate : event_flag(ctx, ev->obj, g_atom_stop_immediate);
+}
+
+static void ev_set_current(JSContext *ctx, const EventView *ev, JSValueConst obj, int phase) {
+    if (ev->native) {
+        JSValue old = ev->native->current_target;
+        ev->native->current_target = JS_DupValue(ctx, obj);
+        ev->native->phase = phase;
+        JS_FreeValue(ctx, old);
+        return;
+    }
+    JS_SetProperty(ctx, ev->obj, g_atom_current_target, JS_DupValue(ctx, obj));
+    JS_SetProperty(ctx, ev->obj, g_atom_event_phase, JS_NewInt32(ctx, phase));
+}
+
+/* "on" + type when type has no native accessor, else JS_ATOM_NULL. */
+static JSAtom handler_prop(JSContext *ctx, JSAtom type) {
+    for (int i = 0; i < HANDLER_COUNT; i++) {
+        if (g_handler_atoms[i] == type) return JS_ATOM_NULL;
+    }
+    const char *name = JS_AtomToCString(ctx, type);
+    if (!name) return JS_ATOM_NULL;
+    size_t len = strlen(name);
+    char *prop = (char *)malloc(len + 3);
+    JSAtom atom = JS_ATOM_NULL;
+    if (prop) {
+        memcpy(prop, "on", 2);
+        memcpy(prop + 2, name, len + 1);
+        atom = JS_NewAtom(ctx, prop);
+        free(prop);
+    }
+    JS_FreeCString(ctx, name);
+    return atom;
+}
+
+/* obj's on<type> property, if it is a function (owned), else JS_UNDEFINED. */
+static JSValue prop_handler(JSContext *ctx, JSValueConst obj, JSAtom prop) {
+    if (prop == JS_ATOM_NULL) return JS_UNDEFINED;
+    JSValue h = JS_GetProperty(ctx, obj, prop);
+    if (JS_IsFunction(ctx, h)) return h;
+    if (JS_IsException(h)) dump_exception(ctx);
+    JS_FreeValue(ctx, h);
+    return JS_UNDEFINED;
+}
+
+static bool has_prop_handler(JSContext *ctx, JSValueConst obj, JSAtom prop) {
+    JSValue h = prop_handler(ctx, obj, prop);
+    bool found = !JS_IsUndefined(h);
+    JS_FreeValue(ctx, h);
+    return found;
+}
+
+/* String(type) as an atom; JS_ATOM_NULL with an exception pending. */
+static JSAtom type_atom(JSContext *ctx, JSValueConst type) {
+    JSValue s = JS_ToString(ctx, type);
+    if (JS_IsException(s)) return JS_ATOM_NULL;
+    JSAtom atom = JS_ValueToAtom(ctx, s);
+    JS_FreeValue(ctx, s);
+    return atom;
+}
+
+/* options: a capture boolean or { capture, once }. */
+static void parse_options(JSContext *ctx, JSValueConst options, bool *capture, bool *once) {
+    *capture = false;
+    *once = false;
+    if (JS_IsObject(options)) {
+        JSValue v = JS_GetPropertyStr(ctx, options, "capture");
+        *capture = JS_ToBool(ctx, v) > 0;
+        JS_FreeValue(ctx, v);
+        v = JS_GetPropertyStr(ctx, options, "once");
+        *once = JS_ToBool(ctx, v) > 0;
+        JS_FreeValue(ctx, v);
+    } else {
+        *capture = JS_ToBool(ctx, options) > 0;
+    }
+}
+
+static void call_listener(JSContext *ctx, JSValueConst callback, JSValueConst this_obj, JSValueConst event) {
+    JSValue ret;
+    if (JS_IsFunction(ctx, callback)) {
+        ret = JS_Call(ctx, callback, this_obj, 1, &event);
+    } else {
+        JSValue fn = JS_GetProperty(ctx, callback, g_atom_handle_event);
+        if (JS_IsFunction(ctx, fn)) {
+            ret = JS_Call(ctx, fn, callback, 1, &event);
+        } else if (JS_IsException(fn)) {
+            ret = JS_EXCEPTION;
+        } else {
+            ret = JS_ThrowTypeError(ctx, "listener is not callable");
+        }
+        JS_FreeValue(ctx, fn);
+    }
+    if (JS_IsException(ret)) dump_exception(ctx);
+    JS_FreeValue(ctx, ret);
+}
+
+/* Runs obj's listeners for type that match `capture`; when not
+ * capturing, an on<type> property (handler_prop) runs first. */
+static void invoke(JSContext *ctx, JSValueConst obj, const EventView *ev, JSAtom type,
+                   JSAtom on_prop, int phase, bool capture) {
+    DomElement *e = minirend_dom_get_element(obj);
+    if (!e) return;
+    MinirendEventTarget *t = &e->events;
+    int n = t->len; /* listeners added from here on wait for the next event */
+    bool entered = false;
+
+    if (!capture) {
+        JSValue h = prop_handler(ctx, obj, on_prop);
+        if (!JS_IsUndefined(h)) {
+            ev_set_current(ctx, ev, obj, phase);
+            entered = true;
+            call_listener(ctx, h, obj, ev->obj);
+            JS_FreeValue(ctx, h);
+            if (ev_stopped_immediate(ctx, ev)) return;
+        }
+    }
+
+    t->iterating++;
+    for (int i = 0; i < n; i++) {
+        MinirendListener *l = &t->listeners[i];
+        if (l->removed || l->type != type || l->capture != capture) continue;
+        if (!entered) {
+            ev_set_current(ctx, ev, obj, phase);
+            entered = true;
+        }
+        if (l->once) {
+            l->removed = true;
+            t->has_removed = true;
+        }
+        /* The listener may remove itself (and drop the last reference). */
+        JSValue callback = JS_DupValue(ctx, l->callback);
+        call_listener(ctx, callback, obj, ev->obj);
+        JS_FreeValue(ctx, callback);
+        if (ev_stopped_immediate(ctx, ev)) break;
+    }
+    if (--t->iterating == 0 && t->has_removed) compact(JS_GetRuntime(ctx), t);
+}
+
+static bool push_path(JSContext *ctx, JSValueConst obj) {
+    if (g_path_len == g_path_cap) {
+        int new_cap = g_path_cap ? (g_path_cap * 2) : 32;
+        JSValue *np = (JSValue *)realloc(g_path, (size_t)new_cap * sizeof(JSValue));
+        if (!np) return false;
+        g_path = np;
+        g_path_cap = new_cap;
+    }
+    g_path[g_path_len++] = JS_DupValue(ctx, obj);
+    return true;
+}
+
+/* preventDefault/stopPropagation come from Event.prototype; any other
+ * object is dispatched as a new Event carrying a copy of its enumerable
+ * properties (the caller's object is left alone). Returns an owned value:
+ * the event itself, the copy, or JS_EXCEPTION. */
+static JSValue as_event(JSContext *ctx, JSValueConst event) {
+    if (JS_IsUndefined(g_event_ctor)) {
+        JSValue global = JS_GetGlobalObject(ctx);
+        JSValue ctor = JS_GetPropertyStr(ctx, global, "Event");
+        JS_FreeValue(ctx, global);
+        if (!JS_IsFunction(ctx, ctor)) {
+            JS_FreeValue(ctx, ctor);
+            return JS_DupValue(ctx, event);
+        }
+        g_event_ctor = ctor;
+    }
+    int is_event = JS_IsInstanceOf(ctx, event, g_event_ctor);
+    if (is_event < 0) return JS_EXCEPTION;
+    if (is_event) return JS_DupValue(ctx, event);
+
+    JSValue args[2] = { JS_GetProperty(ctx, event, g_atom_type), JS_DupValue(ctx, event) };
+    JSValue copy = JS_CallConstructor(ctx, g_event_ctor, 2, (JSValueConst *)args);
+    JS_FreeValue(ctx, args[0]);
+    JS_FreeValue(ctx, args[1]);
+    if (JS_IsException(copy)) return copy;
+
+    JSPropertyEnum *props = NULL;
+    uint32_t count = 0;
+    if (JS_GetOwnPropertyNames(ctx, &props, &count, event, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0) {
+        JS_FreeValue(ctx, copy);
+        return JS_EXCEPTION;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        JSValue v = JS_GetProperty(ctx, event, props[i].atom);
+        if (JS_IsException(v) || JS_SetProperty(ctx, copy, props[i].atom, v) < 0) {
+            JS_FreePropertyEnum(ctx, props, count);
+            JS_FreeValue(ctx, copy);
+            return JS_EXCEPTION;
+        }
+    }
+    JS_FreePropertyEnum(ctx, props, count);
+    return copy;
+}
+
+/* Returns !defaultPrevented, or -1 with an exception pending. */
+static int dispatch(JSContext *ctx, JSValueConst target, JSValueConst event) {
+    DomElement *te = minirend_dom_get_element(target);
+    EventView ev = { event, minirend_dom_event_get(event) };
+    JSAtom type = JS_ATOM_NULL;
+    bool bubbles;
+    if (ev.native) {
+        type = JS_DupAtom(ctx, ev.native->type);
+        bubbles = ev.native->bubbles;
+    } else {
+        JSValue type_val = JS_GetProperty(ctx, event, g_atom_type);
+        if (JS_IsString(type_val)) type = JS_ValueToAtom(ctx, type_val);
+        JS_FreeValue(ctx, type_val);
+        bubbles = event_flag(ctx, event, g_atom_bubbles);
+    }
+    if (!te || type == JS_ATOM_NULL) {
+        JS_FreeAtom(ctx, type);
+        JS_ThrowTypeError(ctx, "event required");
+        return -1;
+    }
+    JSValue owned = ev.native ? JS_DupValue(ctx, event) : as_event(ctx, event);
+    if (JS_IsException(owned)) {
+        JS_FreeAtom(ctx, type);
+        return -1;
+    }
+    ev.obj = owned;
+    JSAtom on_prop = handler_prop(ctx, type);
+
+    /* The target, then the wrapped ancestors listening for type (nodes
+     * without a wrapper have no listeners). */
+    int base = g_path_len;
+    push_path(ctx, target);
+    lxb_dom_node_t *p = te->node ? lxb_dom_node_parent(te->node) : NULL;
+    for (; p; p = lxb_dom_node_parent(p)) {
+        DomElement *pe = (DomElement *)p->user;
+        if (pe && (listens(&pe->events, type) || has_prop_handler(ctx, pe->obj, on_prop))) {
+            push_path(ctx, pe->obj);
+        }
+    }
+    int len = g_path_len - base;
+
+    if (ev.native) {
+        JSValue old = ev.native->target;
+        ev.native->target = JS_DupValue(ctx, target);
+        JS_FreeValue(ctx, old);
+    } else {
+        JS_SetProperty(ctx, ev.obj, g_atom_target, JS_DupValue(ctx, target));
+    }
+
+    for (int i = len - 1; i >= 1 && !ev_stopped(ctx, &ev); i--) {
+        invoke(ctx, g_path[base + i], &ev, type, on_prop, PHASE_CAPTURING, true);
+    }
+    if (len > 0 && !ev_stopped(ctx, &ev)) {
+        invoke(ctx, g_path[base], &ev, type, on_prop, PHASE_AT_TARGET, true);
+        if (!ev_stopped_immediate(ctx, &ev)) {
+            invoke(ctx, g_path[base], &ev, type, on_prop, PHASE_AT_TARGET, false);
+        }
+    }
+    if (bubbles) {
+        for (int i = 1; i < len && !ev_stopped(ctx, &ev); i++) {
+            invoke(ctx, g_path[base + i], &ev, type, on_prop, PHASE_BUBBLING, false);
+        }
+    }
+    ev_set_current(ctx, &ev, JS_NULL, PHASE_NONE);
+
+    for (int i = 0; i < len; i++) JS_FreeValue(ctx, g_path[base + i]);
+    g_path_len = base;
+    JS_FreeAtom(ctx, on_prop);
+    JS_FreeAtom(ctx, type);
+
+    bool prevented = ev.native ? ev.native->default_prevented
+                               : event_flag(ctx, ev.obj, g_atom_default_prevented);
+    JS_FreeValue(ctx, owned);
+    return prevented ? 0 : 1;
+}
+
+bool minirend_dom_events_dispatch(JSContext *ctx, JSValueConst target, JSValueConst event) {
+    if (!g_atoms_ready || !JS_IsObject(event) || !minirend_dom_get_element(target)) return true;
+    int r = dispatch(ctx, target, event);
+    if (r < 0) {
+        dump_exception(ctx);
+        return true;
+    }
+    return r != 0;
+}
+
+bool minirend_dom_events_wanted(JSContext *ctx, JSValueConst target, const char *type) {
+    DomElement *te = minirend_dom_get_element(target);
+    if (!te || !g_atoms_ready) return false;
+
+    JSAtom atom = JS_NewAtom(ctx, type);
+    JSAtom on_prop = handler_prop(ctx, atom);
+    bool wanted = listens(&te->events, atom) || has_prop_handler(ctx, te->obj, on_prop);
+    lxb_dom_node_t *p = te->node ? lxb_dom_node_parent(te->node) : NULL;
+    for (; p && !wanted; p = lxb_dom_node_parent(p)) {
+        DomElement *pe = (DomElement *)p->user;
+        wanted = pe && (listens(&pe->events, atom) || has_prop_handler(ctx, pe->obj, on_prop));
+    }
+    JS_FreeAtom(ctx, on_prop);
+    JS_FreeAtom(ctx, atom);
+    return wanted;
+}
+
+static JSValue js_addEventListener(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DomElement *e = minirend_dom_get_element(this_val);
+    if (!e) return JS_ThrowTypeError(ctx, "not an EventTarget");
+    if (argc < 2 || !JS_IsObject(argv[1])) return JS_UNDEFINED; /* null listener: no-op */
+
+    bool capture, once;
+    parse_options(ctx, argc >= 3 ? argv[2] : JS_UNDEFINED, &capture, &once);
+    JSAtom type = type_atom(ctx, argv[0]);
+    if (type == JS_ATOM_NULL) return JS_EXCEPTION;
+
+    bool ok = find_listener(&e->events, type, argv[1], capture) >= 0 ||
+              add_listener(ctx, &e->events, type, argv[1], capture, once, false);
+    JS_FreeAtom(ctx, type);
+    return ok ? JS_UNDEFINED : JS_ThrowOutOfMemory(ctx);
+}
+
+static JSValue js_removeEventListener(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DomElement *e = minirend_dom_get_element(this_val);
+    if (!e) return JS_ThrowTypeError(ctx, "not an EventTarget");
+    if (argc < 2 || !JS_IsObject(argv[1])) return JS_UNDEFINED;
+
+    bool capture, once;
+    parse_options(ctx, argc >= 3 ? argv[2] : JS_UNDEFINED, &capture, &once);
+    JSAtom type = type_atom(ctx, argv[0]);
+    if (type == JS_ATOM_NULL) return JS_EXCEPTION;
+
+    int i = find_listener(&e->events, type, argv[1], capture);
+    if (i >= 0) remove_at(JS_GetRuntime(ctx), &e->events, i);
+    JS_FreeAtom(ctx, type);
+    return JS_UNDEFINED;
+}
+
+static JSValue js_dispatchEvent(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    if (!minirend_dom_get_element(this_val)) return JS_ThrowTypeError(ctx, "not an EventTarget");
+    if (argc < 1 || !JS_IsObject(argv[0])) return JS_ThrowTypeError(ctx, "event required");
+    int r = dispatch(ctx, this_val, argv[0]);
+    if (r < 0) return JS_EXCEPTION;
+    return JS_NewBool(ctx, r);
+}
+
+static JSValue js_get_handler(JSContext *ctx, JSValueConst this_val, int magic) {
+    DomElement *e = minirend_dom_get_element(this_val);
+    if (!e) return JS_UNDEFINED;
+    int i = find_handler(&e->events, g_handler_atoms[magic]);
+    return i >= 0 ? JS_DupValue(ctx, e->events.listeners[i].callback) : JS_NULL;
+}
+
+static JSValue js_set_handler(JSContext *ctx, JSValueConst this_val, JSValueConst val, int magic) {
+    DomElement *e = minirend_dom_get_element(this_val);
+    if (!e) return JS_UNDEFINED;
+    MinirendEventTarget *t = &e->events;
+    JSAtom type = g_handler_atoms[magic];
+    int i = find_handler(t, type);
+
+    /* Anything but a function clears the handler. */
+    if (!JS_IsFunction(ctx, val)) {
+        if (i >= 0) remove_at(JS_GetRuntime(ctx), t, i);
+        return JS_UNDEFINED;
+    }
+    /* A replaced handler keeps its place among the listeners. */
+    if (i >= 0) {
+        JSValue old = t->listeners[i].callback;
+        t->listeners[i].callback = JS_DupValue(ctx, val);
+        JS_FreeValue(ctx, old);
+    } else if (!add_listener(ctx, t, type, val, false, false, true)) {
+        return JS_ThrowOutOfMemory(ctx);
+    }
+    return JS_UNDEFINED;
+}
+
+void minirend_dom_events_install(JSContext *ctx, JSValueConst proto) {
+    init_atoms(ctx);
+
+    JS_SetPropertyStr(ctx, proto, "addEventListener",
+                      JS_NewCFunction(ctx, js_addEventListener, "addEventListener", 2));
+    JS_SetPropertyStr(ctx, proto, "removeEventListener",
+                      JS_NewCFunction(ctx, js_removeEventListener, "removeEventListener", 2));
+    JS_SetPropertyStr(ctx, proto, "dispatchEvent",
+                      JS_NewCFunction(ctx, js_dispatchEvent, "dispatchEvent", 1));
+
+    for (int i = 0; i < HANDLER_COUNT; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "on%s", k_handler_types[i]);
+        JSAtom atom = JS_NewAtom(ctx, name);
+        JS_DefinePropertyGetSet(ctx, proto, atom,
+            JS_NewCFunction2(ctx, (JSCFunction *)js_get_handler, name, 0, JS_CFUNC_getter_magic, i),
+            JS_NewCFunction2(ctx, (JSCFunction *)js_set_handler, name, 1, JS_CFUNC_setter_magic, i),
+            JS_PROP_CONFIGURABLE);
+        JS_FreeAtom(ctx, atom);
+    }
+}
+
+void minirend_dom_events_shutdown(JSContext *ctx) {
+    JS_FreeValue(ctx, g_event_ctor);
+    g_event_ctor = JS_UNDEFINED;
+
+    free(g_path);
+    g_path = NULL;
+    g_path_len = 0;
+    g_path_cap = 0;
+
+    if (g_atoms_ready) {
+        JS_FreeAtom(ctx, g_atom_type);
+        JS_FreeAtom(ctx, g_atom_bubbles);
+        JS_FreeAtom(ctx, g_atom_target);
+        JS_FreeAtom(ctx, g_atom_current_target);
+        JS_FreeAtom(ctx, g_atom_event_phase);
+        JS_FreeAtom(ctx, g_atom_default_prevented);
+        JS_FreeAtom(ctx, g_atom_stop);
+        JS_FreeAtom(ctx, g_atom_stop_immediate);
+        JS_FreeAtom(ctx, g_atom_handle_event);
+        for (int i = 0; i < HANDLER_COUNT; i++) JS_FreeAtom(ctx, g_handler_atoms[i]);
+        g_atoms_ready = false;
+    }
+}
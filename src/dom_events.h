@@ -0,0 +1,45 @@
+#ifndef MINIREND_DOM_EVENTS_H
+#define MINIREND_DOM_EVENTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "quickjs.h"
+
+/* Native EventTarget:
+ * - listener lists live on each element wrapper (MinirendEventTarget),
+ *   including the handlers set through the native on<type> accessors of
+ *   the common UI types; for other types a plain on<type> property
+ *   holding a function is honoured
+ * - dispatch runs capture/target/bubble in C over the wrapped ancestors
+ *   that listen for the event's type, entering JS only to call listeners
+ * - minirend_dom_events_wanted() lets callers skip building an event
+ *   nobody on the path listens for
+ */
+
+typedef struct MinirendListener MinirendListener;
+
+typedef struct MinirendEventTarget {
+    MinirendListener *listeners;
+    int               len;
+    int               cap;
+    int               iterating;   /* dispatches walking the list */
+    bool              has_removed; /* entries to compact afterwards */
+} MinirendEventTarget;
+
+void minirend_event_target_free(JSRuntime *rt, MinirendEventTarget *t);
+void minirend_event_target_mark(JSRuntime *rt, MinirendEventTarget *t, JS_MarkFunc *mark_func);
+
+/* addEventListener, removeEventListener, dispatchEvent and the on<type>
+ * properties, on the element prototype. */
+void minirend_dom_events_install(JSContext *ctx, JSValueConst proto);
+void minirend_dom_events_shutdown(JSContext *ctx);
+
+/* Dispatch event (not consumed) at an element wrapper. Returns true if
+ * the default was not prevented. */
+bool minirend_dom_events_dispatch(JSContext *ctx, JSValueConst target, JSValueConst event);
+
+/* Whether dispatching `type` at target would reach any listener. */
+bool minirend_dom_events_wanted(JSContext *ctx, JSValueConst target, const char *type);
+
+#endif /* MINIREND_DOM_EVENTS_H */
@@ -0,0 +1,179 @@
+#include "dom_mutations.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "minirend.h"
+
+typedef enum {
+    MUTATION_CHILD_LIST,
+    MUTATION_ATTRIBUTES,
+} MutationType;
+
+typedef struct MutationRecord {
+    MutationType type;
+    JSValue      target;  /* owned refs */
+    JSValue      added;
+    JSValue      removed;
+    JSAtom       attr;    /* JS_ATOM_NULL for childList */
+} MutationRecord;
+
+static MutationRecord *g_log = NULL;
+static int             g_log_len = 0;
+static int             g_log_cap = 0;
+
+static unsigned g_invalidate = 0;  /* MINIREND_INVALIDATE_* since last flush */
+static uint32_t g_generation = 0;
+static int      g_observer_count = 0;
+
+static void dump_exception(JSContext *ctx) {
+    JSValue ex = JS_GetException(ctx);
+    const char *s = JS_ToCString(ctx, ex);
+    if (s) {
+        fprintf(stderr, "JS exception: %s\n", s);
+        JS_FreeCString(ctx, s);
+    }
+    JS_FreeValue(ctx, ex);
+}
+
+static MutationRecord *push_record(void) {
+    if (g_log_len == g_log_cap) {
+        int new_cap = g_log_cap ? (g_log_cap * 2) : 64;
+        MutationRecord *nl = (MutationRecord *)realloc(g_log, (size_t)new_cap * sizeof(MutationRecord));
+        if (!nl) return NULL;
+        g_log = nl;
+        g_log_cap = new_cap;
+    }
+    return &g_log[g_log_len++];
+}
+
+static void free_records(JSContext *ctx, MutationRecord *records, int count) {
+    for (int i = 0; i < count; i++) {
+        JS_FreeValue(ctx, records[i].target);
+        JS_FreeValue(ctx, records[i].added);
+        JS_FreeValue(ctx, records[i].removed);
+        if (records[i].attr != JS_ATOM_NULL) JS_FreeAtom(ctx, records[i].attr);
+    }
+}
+
+/* MutationObserver.observe/disconnect report how many observers are live. */
+static JSValue js_native_set_observer_count(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    (void)this_val;
+    int32_t n = 0;
+    if (argc >= 1 && JS_ToInt32(ctx, &n, argv[0]) != 0) return JS_EXCEPTION;
+    g_observer_count = n > 0 ? n : 0;
+    return JS_UNDEFINED;
+}
+
+void minirend_dom_mutations_init(JSContext *ctx) {
+    g_invalidate = 0;
+    g_observer_count = 0;
+
+    JSValue global = JS_GetGlobalObject(ctx);
+    JS_SetPropertyStr(ctx, global, "__minirendNativeSetObserverCount",
+                      JS_NewCFunction(ctx, js_native_set_observer_count, "__minirendNativeSetObserverCount", 1));
+    JS_FreeValue(ctx, global);
+}
+
+void minirend_dom_mutations_shutdown(JSContext *ctx) {
+    if (ctx) free_records(ctx, g_log, g_log_len);
+    free(g_log);
+    g_log = NULL;
+    g_log_len = 0;
+    g_log_cap = 0;
+    g_observer_count = 0;
+}
+
+void minirend_dom_record_child_list(JSContext *ctx, JSValueConst target,
+                                    JSValueConst added, JSValueConst removed,
+                                    unsigned invalidate) {
+    g_generation++;
+    g_invalidate |= invalidate;
+    if (g_observer_count == 0) return;
+
+    MutationRecord *r = push_record();
+    if (!r) return;
+    r->type = MUTATION_CHILD_LIST;
+    r->target = JS_DupValue(ctx, target);
+    r->added = JS_DupValue(ctx, added);
+    r->removed = JS_DupValue(ctx, removed);
+    r->attr = JS_ATOM_NULL;
+}
+
+void minirend_dom_record_attribute(JSContext *ctx, JSValueConst target,
+                                   const char *name, unsigned invalidate) {
+    g_generation++;
+    g_invalidate |= invalidate;
+    if (g_observer_count == 0) return;
+
+    MutationRecord *r = push_record();
+    if (!r) return;
+    r->type = MUTATION_ATTRIBUTES;
+    r->target = JS_DupValue(ctx, target);
+    r->added = JS_NULL;
+    r->removed = JS_NULL;
+    r->attr = JS_NewAtom(ctx, name);
+}
+
+void minirend_dom_mutations_invalidate(unsigned invalidate) {
+    g_generation++;
+    g_invalidate |= invalidate;
+}
+
+uint32_t minirend_dom_generation(void) {
+    return g_generation;
+}
+
+static JSValue node_list(JSContext *ctx, JSValueConst node) {
+    JSValue arr = JS_NewArray(ctx);
+    if (!JS_IsNull(node)) JS_SetPropertyUint32(ctx, arr, 0, JS_DupValue(ctx, node));
+    return arr;
+}
+
+static JSValue make_record(JSContext *ctx, const MutationRecord *r) {
+    JSValue obj = JS_NewObject(ctx);
+    bool child_list = r->type == MUTATION_CHILD_LIST;
+    JS_SetPropertyStr(ctx, obj, "type", JS_NewString(ctx, child_list ? "childList" : "attributes"));
+    JS_SetPropertyStr(ctx, obj, "target", JS_DupValue(ctx, r->target));
+    JS_SetPropertyStr(ctx, obj, "addedNodes", node_list(ctx, r->added));
+    JS_SetPropertyStr(ctx, obj, "removedNodes", node_list(ctx, r->removed));
+    JS_SetPropertyStr(ctx, obj, "attributeName",
+                      child_list ? JS_NULL : JS_AtomToString(ctx, r->attr));
+    return obj;
+}
+
+void minirend_dom_mutations_flush(JSContext *ctx) {
+    /* One invalidation for everything script did this frame. */
+    if (g_invalidate) {
+        minirend_renderer_invalidate(g_invalidate);
+        g_invalidate = 0;
+    }
+    if (g_log_len == 0) return;
+
+    /* Take the batch: mutations made by observer callbacks land in the
+     * next frame's log. */
+    MutationRecord *batch = g_log;
+    int count = g_log_len;
+    g_log = NULL;
+    g_log_len = 0;
+    g_log_cap = 0;
+
+    JSValue records = JS_NewArray(ctx);
+    for (int i = 0; i < count; i++) {
+        JS_SetPropertyUint32(ctx, records, (uint32_t)i, make_record(ctx, &batch[i]));
+    }
+    free_records(ctx, batch, count);
+    free(batch);
+
+    JSValue global = JS_GetGlobalObject(ctx);
+    JSValue deliver = JS_GetPropertyStr(ctx, global, "__minirendDeliverMutations");
+    if (JS_IsFunction(ctx, deliver)) {
+        JSValue ret = JS_Call(ctx, deliver, JS_UNDEFINED, 1, (JSValueConst *)&records);
+        if (JS_IsException(ret)) dump_exception(ctx);
+        JS_FreeValue(ctx, ret);
+    }
+    JS_FreeValue(ctx, deliver);
+    JS_FreeValue(ctx, global);
+    JS_FreeValue(ctx, records);
+}
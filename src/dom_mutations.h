@@ -0,0 +1,40 @@
+#ifndef MINIREND_DOM_MUTATIONS_H
+#define MINIREND_DOM_MUTATIONS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "quickjs.h"
+
+/* DOM mutation log:
+ * - script mutations are recorded here instead of invalidating the
+ *   renderer directly; their invalidation bits (MINIREND_INVALIDATE_*)
+ *   accumulate until the frame's flush
+ * - minirend_dom_mutations_flush() applies them as one
+ *   minirend_renderer_invalidate() and hands the records to
+ *   MutationObservers in a single batch
+ * - records are only kept while an observer exists
+ */
+
+void     minirend_dom_mutations_init(JSContext *ctx);
+void     minirend_dom_mutations_shutdown(JSContext *ctx);
+
+/* childList mutation of target; added/removed may be JS_NULL. */
+void     minirend_dom_record_child_list(JSContext *ctx, JSValueConst target,
+                                        JSValueConst added, JSValueConst removed,
+                                        unsigned invalidate);
+
+/* attributes mutation of target's `name`. */
+void     minirend_dom_record_attribute(JSContext *ctx, JSValueConst target,
+                                       const char *name, unsigned invalidate);
+
+/* A change without a record (e.g. styles applied at flush); still bumps
+ * the generation. */
+void     minirend_dom_mutations_invalidate(unsigned invalidate);
+
+/* Bumped by every mutation; lets caches detect a changed tree. */
+uint32_t minirend_dom_generation(void);
+
+void     minirend_dom_mutations_flush(JSContext *ctx);
+
+#endif /* MINIREND_DOM_MUTATIONS_H */
@@ -0,0 +1,508 @@
+#include "dom_query.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <lexbor/dom/dom.h>
+
+#include "dom_mutations.h"
+
+#define QUERY_CACHE_SIZE 256 /* power of two, direct mapped */
+
+/* Elements sharing one id or class, in no particular order. */
+typedef struct NodeSet {
+    char            *key;  /* NULL marks an empty bucket */
+    uint32_t         hash;
+    lxb_dom_node_t **nodes;
+    int              len;
+    int              cap;
+} NodeSet;
+
+/* Open addressing with linear probing; emptied sets are erased. */
+typedef struct NodeIndex {
+    NodeSet *sets;
+    uint32_t mask;
+    int      used;
+} NodeIndex;
+
+typedef enum {
+    QUERY_FIRST,
+    QUERY_ALL,
+    QUERY_CLASS_NAMES,
+} QueryKind;
+
+typedef struct QueryEntry {
+    char            *text; /* selector or class list; NULL if unused */
+    lxb_dom_node_t  *root;
+    QueryKind        kind;
+    uint32_t         hash;
+    uint32_t         generation;
+    lxb_dom_node_t **nodes;
+    int              count;
+    int              cap;
+} QueryEntry;
+
+static NodeIndex  g_ids;
+static NodeIndex  g_classes;
+static QueryEntry g_cache[QUERY_CACHE_SIZE];
+
+static LexborDocument *g_doc = NULL;
+static lxb_dom_node_t *g_doc_node = NULL;
+
+static uint32_t hash_str(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static bool is_element(lxb_dom_node_t *node) {
+    return node && lxb_dom_node_type(node) == LXB_DOM_NODE_TYPE_ELEMENT;
+}
+
+static bool is_descendant(lxb_dom_node_t *node, lxb_dom_node_t *root) {
+    for (lxb_dom_node_t *p = lxb_dom_node_parent(node); p; p = lxb_dom_node_parent(p)) {
+        if (p == root) return true;
+    }
+    return false;
+}
+
+static bool is_connected(lxb_dom_node_t *node) {
+    return node == g_doc_node || is_descendant(node, g_doc_node);
+}
+
+static bool push_node(lxb_dom_node_t ***nodes, int *len, int *cap, lxb_dom_node_t *node) {
+    if (*len == *cap) {
+        int new_cap = *cap ? (*cap * 2) : 16;
+        lxb_dom_node_t **nn = (lxb_dom_node_t **)realloc(*nodes, (size_t)new_cap * sizeof(*nn));
+        if (!nn) return false;
+        *nodes = nn;
+        *cap = new_cap;
+    }
+    (*nodes)[(*len)++] = node;
+    return true;
+}
+
+/* Whitespace-separated tokens of a class list. */
+static const char *next_token(const char **p, size_t *len) {
+    const char *s = *p;
+    while (*s && is_space(*s)) s++;
+    if (!*s) return NULL;
+    const char *start = s;
+    while (*s && !is_space(*s)) s++;
+    *len = (size_t)(s - start);
+    *p = s;
+    return start;
+}
+
+static bool has_token(const char *list, const char *tok, size_t len) {
+    const char *p = list, *t;
+    size_t l;
+    while ((t = next_token(&p, &l))) {
+        if (l == len && memcmp(t, tok, len) == 0) return true;
+    }
+    return false;
+}
+
+/* "a b a" lists a once. */
+static bool seen_before(const char *list, const char *tok, size_t len) {
+    const char *p = list, *t;
+    size_t l;
+    while ((t = next_token(&p, &l)) && t < tok) {
+        if (l == len && memcmp(t, tok, len) == 0) return true;
+    }
+    return false;
+}
+
+static int node_depth(lxb_dom_node_t *node) {
+    int depth = 0;
+    while ((node = lxb_dom_node_parent(node))) depth++;
+    return depth;
+}
+
+/* qsort comparator: document (pre-)order. */
+static int compare_order(const void *pa, const void *pb) {
+    lxb_dom_node_t *a = *(lxb_dom_node_t *const *)pa;
+    lxb_dom_node_t *b = *(lxb_dom_node_t *const *)pb;
+    if (a == b) return 0;
+
+    int da = node_depth(a), db = node_depth(b);
+    for (; da > db; da--) {
+        a = lxb_dom_node_parent(a);
+        if (a == b) return 1; /* b is an ancestor */
+    }
+    for (; db > da; db--) {
+        b = lxb_dom_node_parent(b);
+        if (b == a) return -1;
+    }
+    while (lxb_dom_node_parent(a) != lxb_dom_node_parent(b)) {
+        a = lxb_dom_node_parent(a);
+        b = lxb_dom_node_parent(b);
+    }
+    for (lxb_dom_node_t *n = lxb_dom_node_next(a); n; n = lxb_dom_node_next(n)) {
+        if (n == b) return -1;
+    }
+    return 1;
+}
+
+static bool index_grow(NodeIndex *ix) {
+    uint32_t new_size = (ix->mask + 1) * 2;
+    NodeSet *sets = (NodeSet *)calloc(new_size, sizeof(NodeSet));
+    if (!sets) return false;
+
+    for (uint32_t i = 0; i <= ix->mask; i++) {
+        if (!ix->sets[i].key) continue;
+        uint32_t j = ix->sets[i].hash & (new_size - 1);
+        while (sets[j].key) j = (j + 1) & (new_size - 1);
+        sets[j] = ix->sets[i];
+    }
+    free(ix->sets);
+    ix->sets = sets;
+    ix->mask = new_size - 1;
+    return true;
+}
+
+static NodeSet *index_find(NodeIndex *ix, const char *key, size_t len, bool create) {
+    if (!ix->sets) {
+        if (!create) return NULL;
+        ix->sets = (NodeSet *)calloc(64, sizeof(NodeSet));
+        if (!ix->sets) return NULL;
+        ix->mask = 63;
+    }
+
+    uint32_t h = hash_str(key, len);
+    uint32_t i = h & ix->mask;
+    while (ix->sets[i].key) {
+        NodeSet *s = &ix->sets[i];
+        if (s->hash == h && strncmp(s->key, key, len) == 0 && s->key[len] == '\0') return s;
+        i = (i + 1) & ix->mask;
+    }
+    if (!create) return NULL;
+
+    /* Keep the load under 3/4. */
+    if ((uint32_t)(ix->used + 1) * 4 > (ix->mask + 1) * 3) {
+        if (!index_grow(ix)) return NULL;
+        return index_find(ix, key, len, true);
+    }
+
+    char *copy = (char *)malloc(len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, key, len);
+    copy[len] = '\0';
+
+    NodeSet *s = &ix->sets[i];
+    s->key = copy;
+    s->hash = h;
+    ix->used++;
+    return s;
+}
+
+/* Drops an empty set, so ids and classes that come and go don't pile up. */
+static void index_erase(NodeIndex *ix, NodeSet *s) {
+    free(s->key);
+    free(s->nodes);
+
+    /* Pull later entries of the probe run back into the hole, unless
+     * their home bucket lies after it. */
+    uint32_t hole = (uint32_t)(s - ix->sets);
+    uint32_t i = hole;
+    for (;;) {
+        i = (i + 1) & ix->mask;
+        if (!ix->sets[i].key) break;
+        uint32_t home = ix->sets[i].hash & ix->mask;
+        if (((i - home) & ix->mask) >= ((i - hole) & ix->mask)) {
+            ix->sets[hole] = ix->sets[i];
+            hole = i;
+        }
+    }
+    memset(&ix->sets[hole], 0, sizeof(NodeSet));
+    ix->used--;
+}
+
+static void index_add(NodeIndex *ix, const char *key, size_t len, lxb_dom_node_t *node) {
+    NodeSet *s = index_find(ix, key, len, true);
+    if (s) push_node(&s->nodes, &s->len, &s->cap, node);
+}
+
+static void index_remove(NodeIndex *ix, const char *key, size_t len, lxb_dom_node_t *node) {
+    NodeSet *s = index_find(ix, key, len, false);
+    if (!s) return;
+
+    /* Recently added elements are the likeliest to go. */
+    for (int i = s->len - 1; i >= 0; i--) {
+        if (s->nodes[i] == node) {
+            s->nodes[i] = s->nodes[--s->len];
+            break;
+        }
+    }
+    if (s->len == 0) index_erase(ix, s);
+}
+
+static void index_free(NodeIndex *ix) {
+    if (ix->sets) {
+        for (uint32_t i = 0; i <= ix->mask; i++) {
+            free(ix->sets[i].key);
+            free(ix->sets[i].nodes);
+        }
+    }
+    free(ix->sets);
+    memset(ix, 0, sizeof(*ix));
+}
+
+static void update_element(lxb_dom_node_t *element, bool add) {
+    const char *id = minirend_lexbor_get_attribute(element, "id");
+    if (id && *id) {
+        if (add) index_add(&g_ids, id, strlen(id), element);
+        else index_remove(&g_ids, id, strlen(id), element);
+    }
+
+    const char *cls = minirend_lexbor_get_attribute(element, "class");
+    if (!cls) return;
+    const char *p = cls, *tok;
+    size_t len;
+    while ((tok = next_token(&p, &len))) {
+        if (seen_before(cls, tok, len)) continue;
+        if (add) index_add(&g_classes, tok, len, element);
+        else index_remove(&g_classes, tok, len, element);
+    }
+}
+
+static void update_subtree(lxb_dom_node_t *root, bool add) {
+    lxb_dom_node_t *n = root;
+    while (n) {
+        if (is_element(n)) update_element(n, add);
+
+        lxb_dom_node_t *child = lxb_dom_node_first_child(n);
+        if (child) {
+            n = child;
+            continue;
+        }
+        while (n != root && !lxb_dom_node_next(n)) n = lxb_dom_node_parent(n);
+        n = (n == root) ? NULL : lxb_dom_node_next(n);
+    }
+}
+
+void minirend_dom_query_init(LexborDocument *doc) {
+    minirend_dom_query_shutdown();
+    g_doc = doc;
+    g_doc_node = minirend_lexbor_get_document_node(doc);
+    if (g_doc_node) update_subtree(g_doc_node, true);
+}
+
+void minirend_dom_query_shutdown(void) {
+    index_free(&g_ids);
+    index_free(&g_classes);
+    for (int i = 0; i < QUERY_CACHE_SIZE; i++) {
+        free(g_cache[i].text);
+        free(g_cache[i].nodes);
+    }
+    memset(g_cache, 0, sizeof(g_cache));
+    g_doc = NULL;
+    g_doc_node = NULL;
+}
+
+void minirend_dom_query_add_subtree(lxb_dom_node_t *root) {
+    if (root) update_subtree(root, true);
+}
+
+void minirend_dom_query_remove_subtree(lxb_dom_node_t *root) {
+    if (root) update_subtree(root, false);
+}
+
+void minirend_dom_query_add_element(lxb_dom_node_t *element) {
+    if (is_element(element)) update_element(element, true);
+}
+
+void minirend_dom_query_remove_element(lxb_dom_node_t *element) {
+    if (is_element(element)) update_element(element, false);
+}
+
+static lxb_dom_node_t *first_in_order(lxb_dom_node_t *const *nodes, int count) {
+    lxb_dom_node_t *first = NULL;
+    for (int i = 0; i < count; i++) {
+        if (!first || compare_order(&nodes[i], &first) < 0) first = nodes[i];
+    }
+    return first;
+}
+
+lxb_dom_node_t *minirend_dom_query_by_id(const char *id) {
+    if (!id || !*id) return NULL;
+    const NodeSet *s = index_find(&g_ids, id, strlen(id), false);
+    if (!s) return NULL;
+    return s->len == 1 ? s->nodes[0] : first_in_order(s->nodes, s->len);
+}
+
+/* The entry for (root, text, kind): a hit if it was filled at the
+ * current generation, otherwise emptied and re-keyed for the caller. */
+static QueryEntry *cache_lookup(lxb_dom_node_t *root, const char *text, QueryKind kind, bool *hit) {
+    size_t len = strlen(text);
+    uint32_t h = hash_str(text, len) ^ ((uint32_t)(uintptr_t)root * 0x9E3779B1u) ^ (uint32_t)kind;
+    uint32_t generation = minirend_dom_generation();
+
+    QueryEntry *e = &g_cache[h & (QUERY_CACHE_SIZE - 1)];
+    if (e->text && e->hash == h && e->root == root && e->kind == kind &&
+        e->generation == generation && strcmp(e->text, text) == 0) {
+        *hit = true;
+        return e;
+    }
+
+    *hit = false;
+    if (!e->text || strcmp(e->text, text) != 0) {
+        free(e->text);
+        e->text = (char *)malloc(len + 1);
+        if (e->text) memcpy(e->text, text, len + 1);
+    }
+    e->root = root;
+    e->kind = kind;
+    e->hash = h;
+    e->generation = generation;
+    e->count = 0;
+    return e;
+}
+
+static void collect_from_set(QueryEntry *e, const NodeSet *s, lxb_dom_node_t *root) {
+    if (!s) return;
+    for (int i = 0; i < s->len; i++) {
+        if (is_descendant(s->nodes[i], root)) push_node(&e->nodes, &e->count, &e->cap, s->nodes[i]);
+    }
+    if (e->kind == QUERY_FIRST && e->count > 1) {
+        e->nodes[0] = first_in_order(e->nodes, e->count);
+        e->count = 1;
+    } else if (e->count > 1) {
+        qsort(e->nodes, (size_t)e->count, sizeof(e->nodes[0]), compare_order);
+    }
+}
+
+/* "#name" or ".name" alone, which the indexes can answer. */
+static bool simple_selector(const char *sel, char *prefix, const char **name, size_t *len) {
+    while (is_space(*sel)) sel++;
+    if (*sel != '#' && *sel != '.') return false;
+    *prefix = *sel++;
+
+    const char *s = sel;
+    while (*s && (isalnum((unsigned char)*s) || *s == '-' || *s == '_' || (unsigned char)*s >= 0x80)) s++;
+    size_t n = (size_t)(s - sel);
+    while (is_space(*s)) s++;
+    if (*s || n == 0 || isdigit((unsigned char)sel[0])) return false;
+
+    *name = sel;
+    *len = n;
+    return true;
+}
+
+static bool collect_cb(lxb_dom_node_t *node, void *ctx) {
+    QueryEntry *e = (QueryEntry *)ctx;
+    return push_node(&e->nodes, &e->count, &e->cap, node);
+}
+
+static QueryEntry *run_query(lxb_dom_node_t *root, const char *selector, QueryKind kind) {
+    bool hit;
+    QueryEntry *e = cache_lookup(root, selector, kind, &hit);
+    if (hit) return e;
+
+    /* The indexes only cover connected elements. */
+    char prefix;
+    const char *name;
+    size_t len;
+    if (is_connected(root) && simple_selector(selector, &prefix, &name, &len)) {
+        NodeIndex *ix = (prefix == '#') ? &g_ids : &g_classes;
+        collect_from_set(e, index_find(ix, name, len, false), root);
+    } else if (kind == QUERY_FIRST) {
+        lxb_dom_node_t *node = minirend_lexbor_query_selector(g_doc, root, selector);
+        if (node) push_node(&e->nodes, &e->count, &e->cap, node);
+    } else {
+        minirend_lexbor_query_selector_all(g_doc, root, selector, collect_cb, e);
+    }
+    return e;
+}
+
+lxb_dom_node_t *minirend_dom_query_first(lxb_dom_node_t *root, const char *selector) {
+    if (!root || !selector) return NULL;
+    QueryEntry *e = run_query(root, selector, QUERY_FIRST);
+    return e->count ? e->nodes[0] : NULL;
+}
+
+lxb_dom_node_t *const *minirend_dom_query_all(lxb_dom_node_t *root, const char *selector,
+                                              int *count) {
+    *count = 0;
+    if (!root || !selector) return NULL;
+    QueryEntry *e = run_query(root, selector, QUERY_ALL);
+    *count = e->count;
+    return e->nodes;
+}
+
+static bool has_all_classes(lxb_dom_node_t *element, const char *names) {
+    const char *cls = minirend_lexbor_get_attribute(element, "class");
+    if (!cls) return false;
+    const char *p = names, *tok;
+    size_t len;
+    while ((tok = next_token(&p, &len))) {
+        if (!has_token(cls, tok, len)) return false;
+    }
+    return true;
+}
+
+lxb_dom_node_t *const *minirend_dom_query_class_names(lxb_dom_node_t *root, const char *names,
+                                                      int *count) {
+    *count = 0;
+    if (!root || !names) return NULL;
+
+    bool hit;
+    QueryEntry *e = cache_lookup(root, names, QUERY_CLASS_NAMES, &hit);
+    if (hit) {
+        *count = e->count;
+        return e->nodes;
+    }
+
+    const char *p = names, *tok;
+    size_t len;
+    if (!next_token(&p, &len)) return NULL; /* no classes match nothing */
+
+    if (is_connected(root)) {
+        /* Walk the smallest class set, checking the other classes. */
+        const NodeSet *best = NULL;
+        p = names;
+        while ((tok = next_token(&p, &len))) {
+            const NodeSet *s = index_find(&g_classes, tok, len, false);
+            if (!s || s->len == 0) {
+                best = NULL;
+                break;
+            }
+            if (!best || s->len < best->len) best = s;
+        }
+        if (best) {
+            for (int i = 0; i < best->len; i++) {
+                lxb_dom_node_t *n = best->nodes[i];
+                if (is_descendant(n, root) && has_all_classes(n, names)) {
+                    push_node(&e->nodes, &e->count, &e->cap, n);
+                }
+            }
+            if (e->count > 1) qsort(e->nodes, (size_t)e->count, sizeof(e->nodes[0]), compare_order);
+        }
+    } else {
+        /* Detached subtree: walk it, already in document order. */
+        lxb_dom_node_t *n = lxb_dom_node_first_child(root);
+        while (n && n != root) {
+            if (is_element(n) && has_all_classes(n, names)) {
+                push_node(&e->nodes, &e->count, &e->cap, n);
+            }
+            lxb_dom_node_t *child = lxb_dom_node_first_child(n);
+            if (child) {
+                n = child;
+                continue;
+            }
+            while (n != root && !lxb_dom_node_next(n)) n = lxb_dom_node_parent(n);
+            n = (n == root) ? NULL : lxb_dom_node_next(n);
+        }
+    }
+
+    *count = e->count;
+    return e->nodes;
+}
@@ -0,0 +1,42 @@
+#ifndef MINIREND_DOM_QUERY_H
+#define MINIREND_DOM_QUERY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lexbor_adapter.h"
+
+/* Element lookup for the DOM bindings:
+ * - id -> elements and class -> elements hash indexes over the elements
+ *   connected to the document, kept current by the bindings as they
+ *   attach/detach subtrees and change id/class attributes
+ * - "#id" and ".class" selectors are answered from the indexes, anything
+ *   else goes to lexbor
+ * - results are cached per (root, selector) until the DOM generation
+ *   (minirend_dom_generation) changes
+ * Node arrays returned here are owned by the cache and are only valid
+ * until the next query. */
+
+void minirend_dom_query_init(LexborDocument *doc);
+void minirend_dom_query_shutdown(void);
+
+/* Index maintenance. An element must be removed under the same id/class
+ * it was added with: drop it before changing those attributes. */
+void minirend_dom_query_add_subtree(lxb_dom_node_t *root);
+void minirend_dom_query_remove_subtree(lxb_dom_node_t *root);
+void minirend_dom_query_add_element(lxb_dom_node_t *element);
+void minirend_dom_query_remove_element(lxb_dom_node_t *element);
+
+/* First connected element with this id, in document order. */
+lxb_dom_node_t *minirend_dom_query_by_id(const char *id);
+
+/* Descendants of root, in document order. */
+lxb_dom_node_t *minirend_dom_query_first(lxb_dom_node_t *root, const char *selector);
+lxb_dom_node_t *const *minirend_dom_query_all(lxb_dom_node_t *root, const char *selector,
+                                              int *count);
+
+/* Elements carrying every class in the space-separated list. */
+lxb_dom_node_t *const *minirend_dom_query_class_names(lxb_dom_node_t *root, const char *names,
+                                                      int *count);
+
+#endif /* MINIREND_DOM_QUERY_H */
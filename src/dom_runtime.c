@@ -1,19 +1,26 @@
 #include "dom_runtime.h"
+#include "dom_events.h"
+#include "dom_event_types.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+/* node_id -> wrapper object. Entries are weak unless retained: a weak
+ * entry holds no reference and is dropped by the wrapper's finalizer
+ * (minirend_dom_unregister_node), a retained one owns a reference.
+ * Open addressing with backward-shift deletion, so wrapper churn leaves
+ * no tombstones behind. */
 typedef struct NodeSlot {
-    int32_t id;
-    JSValue obj; /* owned ref */
+    int32_t id;    /* 0 = empty */
+    bool    owned;
+    JSValue obj;
 } NodeSlot;
 
 static NodeSlot *g_slots = NULL;
-static int       g_slots_len = 0;
-static int       g_slots_cap = 0;
+static uint32_t  g_slots_mask = 0;
+static uint32_t  g_slots_used = 0;
 
-static JSValue g_elem_proto = JS_UNDEFINED; /* owned ref */
 static JSValue g_doc_obj    = JS_UNDEFINED; /* weak-ish (dup) */
 
 static void dump_exception(JSContext *ctx) {
@@ -26,26 +33,71 @@ static void dump_exception(JSContext *ctx) {
     JS_FreeValue(ctx, ex);
 }
 
+static uint32_t id_hash(int32_t id) {
+    uint32_t h = (uint32_t)id * 0x9E3779B1u;
+    return h ^ (h >> 16);
+}
+
 static NodeSlot *find_slot(int32_t id) {
-    for (int i = 0; i < g_slots_len; i++) {
+    if (!g_slots || id <= 0) return NULL;
+    uint32_t i = id_hash(id) & g_slots_mask;
+    while (g_slots[i].id != 0) {
         if (g_slots[i].id == id) return &g_slots[i];
+        i = (i + 1) & g_slots_mask;
     }
     return NULL;
 }
 
+static bool grow_slots(void) {
+    uint32_t old_cap = g_slots ? g_slots_mask + 1 : 0;
+    uint32_t new_cap = old_cap ? old_cap * 2 : 64;
+    NodeSlot *slots = (NodeSlot *)calloc(new_cap, sizeof(NodeSlot));
+    if (!slots) return false;
+
+    for (uint32_t i = 0; i < old_cap; i++) {
+        if (g_slots[i].id == 0) continue;
+        uint32_t j = id_hash(g_slots[i].id) & (new_cap - 1);
+        while (slots[j].id != 0) j = (j + 1) & (new_cap - 1);
+        slots[j] = g_slots[i];
+    }
+    free(g_slots);
+    g_slots = slots;
+    g_slots_mask = new_cap - 1;
+    return true;
+}
+
 static NodeSlot *ensure_slot(int32_t id) {
+    if (id <= 0) return NULL;
     NodeSlot *s = find_slot(id);
     if (s) return s;
 
-    if (g_slots_len == g_slots_cap) {
-        int new_cap = g_slots_cap ? (g_slots_cap * 2) : 32;
-        NodeSlot *nn = (NodeSlot *)realloc(g_slots, (size_t)new_cap * sizeof(NodeSlot));
-        if (!nn) return NULL;
-        g_slots = nn;
-        g_slots_cap = new_cap;
+    /* Keep at most half full. */
+    if (!g_slots || (g_slots_used + 1) * 2 > g_slots_mask + 1) {
+        if (!grow_slots()) return NULL;
     }
-    g_slots[g_slots_len++] = (NodeSlot){ .id = id, .obj = JS_UNDEFINED };
-    return &g_slots[g_slots_len - 1];
+    uint32_t i = id_hash(id) & g_slots_mask;
+    while (g_slots[i].id != 0) i = (i + 1) & g_slots_mask;
+    g_slots[i] = (NodeSlot){ .id = id, .owned = false, .obj = JS_UNDEFINED };
+    g_slots_used++;
+    return &g_slots[i];
+}
+
+static void erase_slot(NodeSlot *s) {
+    /* Pull later entries of the probe run back into the hole, unless
+     * their home bucket lies after it. */
+    uint32_t hole = (uint32_t)(s - g_slots);
+    uint32_t i = hole;
+    for (;;) {
+        i = (i + 1) & g_slots_mask;
+        if (g_slots[i].id == 0) break;
+        uint32_t home = id_hash(g_slots[i].id) & g_slots_mask;
+        if (((i - home) & g_slots_mask) >= ((i - hole) & g_slots_mask)) {
+            g_slots[hole] = g_slots[i];
+            hole = i;
+        }
+    }
+    g_slots[hole] = (NodeSlot){ .id = 0, .owned = false, .obj = JS_UNDEFINED };
+    g_slots_used--;
 }
 
 static const char *k_dom_bootstrap =
@@ -69,103 +121,6 @@ static const char *k_dom_bootstrap =
     "\n"
     "  function makeProto(){\n"
     "    const proto = {};\n"
-    "    proto.addEventListener = function(type, listener, options){\n"
-    "      if (!listener) return;\n"
-    "      type = String(type);\n"
-    "      const capture = (typeof options === 'boolean') ? options : !!(options && options.capture);\n"
-    "      const once = !!(options && options.once);\n"
-    "      const passive = !!(options && options.passive);\n"
-    "      if (!this.__listeners) this.__listeners = Object.create(null);\n"
-    "      const arr = (this.__listeners[type] || (this.__listeners[type] = []));\n"
-    "      arr.push({ listener, capture, once, passive });\n"
-    "    };\n"
-    "    proto.removeEventListener = function(type, listener, options){\n"
-    "      type = String(type);\n"
-    "      const capture = (typeof options === 'boolean') ? options : !!(options && options.capture);\n"
-    "      const map = this.__listeners;\n"
-    "      if (!map) return;\n"
-    "      const arr = map[type];\n"
-    "      if (!arr) return;\n"
-    "      for (let i = arr.length - 1; i >= 0; i--){\n"
-    "        const e = arr[i];\n"
-    "        if (e.listener === listener && e.capture === capture) arr.splice(i, 1);\n"
-    "      }\n"
-    "    };\n"
-    "    function getPath(target){\n"
-    "      const path = [];\n"
-    "      let n = target;\n"
-    "      while (n){ path.push(n); n = n.parentNode || null; }\n"
-    "      return path;\n"
-    "    }\n"
-    "    function invokeHandlers(node, event){\n"
-    "      const prop = 'on' + event.type;\n"
-    "      const h = node[prop];\n"
-    "      if (typeof h === 'function'){\n"
-    "        try { h.call(node, event); } catch (e) { (console && console.error) ? console.error(e) : 0; }\n"
-    "      }\n"
-    "    }\n"
-    "    function invokeListeners(node, event, capture){\n"
-    "      const map = node.__listeners;\n"
-    "      if (!map) return;\n"
-    "      const arr = map[event.type];\n"
-    "      if (!arr) return;\n"
-    "      for (let i = 0; i < arr.length; i++){\n"
-    "        const e = arr[i];\n"
-    "        if (!!e.capture !== !!capture) continue;\n"
-    "        if (event._stopImmediate) break;\n"
-    "        try { e.listener.call(node, event); } catch (err) { (console && console.error) ? console.error(err) : 0; }\n"
-    "        if (e.once){ arr.splice(i, 1); i--; }\n"
-    "      }\n"
-    "    }\n"
-    "    proto.dispatchEvent = function(event){\n"
-    "      if (!event || !event.type) throw new TypeError('event required');\n"
-    "      if (!(event instanceof Event)){\n"
-    "        const wrapped = new Event(event.type, event);\n"
-    "        for (const k in event){ wrapped[k] = event[k]; }\n"
-    "        event = wrapped;\n"
-    "      }\n"
-    "      const target = this;\n"
-    "      const path = getPath(target);\n"
-    "      event.target = target;\n"
-    "\n"
-    "      /* CAPTURE */\n"
-    "      if (event.bubbles){\n"
-    "        for (let i = path.length - 1; i >= 1; i--){\n"
-    "          if (event._stop) break;\n"
-    "          const node = path[i];\n"
-    "          event.eventPhase = 1;\n"
-    "          event.currentTarget = node;\n"
-    "          invokeHandlers(node, event);\n"
-    "          invokeListeners(node, event, true);\n"
-    "        }\n"
-    "      }\n"
-    "\n"
-    "      /* AT_TARGET */\n"
-    "      if (!event._stop){\n"
-    "        event.eventPhase = 2;\n"
-    "        event.currentTarget = target;\n"
-    "        invokeHandlers(target, event);\n"
-    "        invokeListeners(target, event, true);\n"
-    "        invokeListeners(target, event, false);\n"
-    "      }\n"
-    "\n"
-    "      /* BUBBLE */\n"
-    "      if (event.bubbles){\n"
-    "        for (let i = 1; i < path.length; i++){\n"
-    "          if (event._stop) break;\n"
-    "          const node = path[i];\n"
-    "          event.eventPhase = 3;\n"
-    "          event.currentTarget = node;\n"
-    "          invokeHandlers(node, event);\n"
-    "          invokeListeners(node, event, false);\n"
-    "        }\n"
-    "      }\n"
-    "\n"
-    "      event.eventPhase = 0;\n"
-    "      event.currentTarget = null;\n"
-    "      return !event.defaultPrevented;\n"
-    "    };\n"
-    "\n"
     "    proto.focus = function(){ if (typeof __minirendNativeFocus === 'function') __minirendNativeFocus(this.__nodeId|0); };\n"
     "    proto.blur = function(){ if (typeof __minirendNativeBlur === 'function') __minirendNativeBlur(this.__nodeId|0); };\n"
     "    proto.setPointerCapture = function(pointerId){ if (typeof __minirendNativeSetPointerCapture === 'function') __minirendNativeSetPointerCapture(this.__nodeId|0, pointerId|0); };\n"
@@ -173,7 +128,100 @@ static const char *k_dom_bootstrap =
     "    return proto;\n"
     "  }\n"
     "\n"
+    "  const observers = [];\n"
+    "  function setObserverCount(){\n"
+    "    if (typeof __minirendNativeSetObserverCount === 'function') __minirendNativeSetObserverCount(observers.length);\n"
+    "  }\n"
+    "  function MutationObserver(callback){\n"
+    "    if (typeof callback !== 'function') throw new TypeError('callback required');\n"
+    "    this._callback = callback;\n"
+    "    this._targets = [];\n"
+    "    this._records = [];\n"
+    "  }\n"
+    "  MutationObserver.prototype.observe = function(target, options){\n"
+    "    if (!target) throw new TypeError('target required');\n"
+    "    options = options || {};\n"
+    "    const o = {\n"
+    "      target,\n"
+    "      childList: !!options.childList,\n"
+    "      attributes: !!(options.attributes || options.attributeFilter),\n"
+    "      attributeFilter: options.attributeFilter ? Array.from(options.attributeFilter, String) : null,\n"
+    "      subtree: !!options.subtree\n"
+    "    };\n"
+    "    const i = this._targets.findIndex(t => t.target === target);\n"
+    "    if (i >= 0) this._targets[i] = o; else this._targets.push(o);\n"
+    "    if (observers.indexOf(this) < 0){ observers.push(this); setObserverCount(); }\n"
+    "  };\n"
+    "  MutationObserver.prototype.disconnect = function(){\n"
+    "    this._targets = [];\n"
+    "    this._records = [];\n"
+    "    const i = observers.indexOf(this);\n"
+    "    if (i >= 0){ observers.splice(i, 1); setObserverCount(); }\n"
+    "  };\n"
+    "  MutationObserver.prototype.takeRecords = function(){\n"
+    "    const r = this._records;\n"
+    "    this._records = [];\n"
+    "    return r;\n"
+    "  };\n"
+    "  MutationObserver.prototype._matches = function(record){\n"
+    "    for (const o of this._targets){\n"
+    "      if (record.type === 'childList' ? !o.childList : !o.attributes) continue;\n"
+    "      if (o.attributeFilter && record.type === 'attributes' && o.attributeFilter.indexOf(record.attributeName) < 0) continue;\n"
+    "      let n = record.target;\n"
+    "      if (n === o.target) return true;\n"
+    "      if (!o.subtree) continue;\n"
+    "      while (n && (n = n.parentNode || null)){ if (n === o.target) return true; }\n"
+    "    }\n"
+    "    return false;\n"
+    "  };\n"
+    "\n"
+    "  /* Called once per frame with every record logged since the last flush. */\n"
+    "  globalThis.__minirendDeliverMutations = function(records){\n"
+    "    for (const mo of observers.slice()){\n"
+    "      for (const r of records){ if (mo._matches(r)) mo._records.push(r); }\n"
+    "      if (!mo._records.length) continue;\n"
+    "      const batch = mo.takeRecords();\n"
+    "      try { mo._callback.call(mo, batch, mo); } catch (e) { (console && console.error) ? console.error(e) : 0; }\n"
+    "    }\n"
+    "  };\n"
+    "\n"
+    "  /* element.style: writes are kept here and reach the document as one\n"
+    "     style attribute update when the frame flushes. */\n"
+    "  function toKebab(k){ return k.replace(/[A-Z]/g, c => '-' + c.toLowerCase()); }\n"
+    "  function toCamel(k){ return k.trim().toLowerCase().replace(/-([a-z])/g, (_, c) => c.toUpperCase()); }\n"
+    "  globalThis.__minirendMakeStyle = function(elem){\n"
+    "    const decls = Object.create(null);\n"
+    "    function changed(){ if (typeof __minirendNativeStyleChanged === 'function') __minirendNativeStyleChanged(elem); }\n"
+    "    function getCssText(){\n"
+    "      let s = '';\n"
+    "      for (const k in decls){ if (decls[k] !== '') s += toKebab(k) + ': ' + decls[k] + '; '; }\n"
+    "      return s.trim();\n"
+    "    }\n"
+    "    function setCssText(text){\n"
+    "      for (const k in decls) delete decls[k];\n"
+    "      for (const part of String(text).split(';')){\n"
+    "        const c = part.indexOf(':');\n"
+    "        if (c > 0) decls[toCamel(part.slice(0, c))] = part.slice(c + 1).trim();\n"
+    "      }\n"
+    "    }\n"
+    "    return new Proxy(decls, {\n"
+    "      get(t, k){\n"
+    "        if (k === 'cssText') return getCssText();\n"
+    "        if (typeof k !== 'string') return undefined;\n"
+    "        return k in t ? t[k] : '';\n"
+    "      },\n"
+    "      set(t, k, v){\n"
+    "        if (typeof k !== 'string') return false;\n"
+    "        if (k === 'cssText') setCssText(v); else t[k] = (v == null) ? '' : String(v);\n"
+    "        changed();\n"
+    "        return true;\n"
+    "      },\n"
+    "      deleteProperty(t, k){ delete t[k]; changed(); return true; }\n"
+    "    });\n"
+    "  };\n"
+    "\n"
     "  globalThis.Event = Event;\n"
+    "  globalThis.MutationObserver = MutationObserver;\n"
     "  globalThis.__MinirendElementProto = makeProto();\n"
     "})();\n";
 
@@ -194,56 +242,61 @@ void minirend_dom_runtime_init(JSContext *ctx) {
     }
     JS_FreeValue(ctx, val);
 
-    /* Grab prototype object created by bootstrap. */
-    JSValue proto = JS_GetPropertyStr(ctx, global, "__MinirendElementProto");
-    if (!JS_IsUndefined(g_elem_proto)) {
-        JS_FreeValue(ctx, g_elem_proto);
-        g_elem_proto = JS_UNDEFINED;
-    }
-    g_elem_proto = JS_DupValue(ctx, proto);
-
-    JS_FreeValue(ctx, proto);
     JS_FreeValue(ctx, doc);
     JS_FreeValue(ctx, global);
 }
 
 void minirend_dom_runtime_shutdown(JSContext *ctx) {
+    /* Detach the table first: releasing a reference runs finalizers,
+     * which unregister their node. */
+    NodeSlot *slots = g_slots;
+    uint32_t cap = g_slots ? g_slots_mask + 1 : 0;
+    g_slots = NULL;
+    g_slots_mask = 0;
+    g_slots_used = 0;
+
     if (ctx) {
-        for (int i = 0; i < g_slots_len; i++) {
-            if (!JS_IsUndefined(g_slots[i].obj)) {
-                JS_FreeValue(ctx, g_slots[i].obj);
-                g_slots[i].obj = JS_UNDEFINED;
-            }
-        }
-        if (!JS_IsUndefined(g_elem_proto)) {
-            JS_FreeValue(ctx, g_elem_proto);
-            g_elem_proto = JS_UNDEFINED;
+        for (uint32_t i = 0; i < cap; i++) {
+            if (slots[i].id != 0 && slots[i].owned) JS_FreeValue(ctx, slots[i].obj);
         }
         if (!JS_IsUndefined(g_doc_obj)) {
             JS_FreeValue(ctx, g_doc_obj);
             g_doc_obj = JS_UNDEFINED;
         }
     }
-    free(g_slots);
-    g_slots = NULL;
-    g_slots_len = 0;
-    g_slots_cap = 0;
+    free(slots);
 }
 
 void minirend_dom_register_node(JSContext *ctx, int32_t node_id, JSValue obj) {
     NodeSlot *s = ensure_slot(node_id);
     if (!s) return;
-    if (!JS_IsUndefined(s->obj)) {
-        JS_FreeValue(ctx, s->obj);
+    if (s->owned) {
+        JSValue old = s->obj;
+        s->obj = JS_DupValue(ctx, obj);
+        JS_FreeValue(ctx, old);
+    } else {
+        s->obj = obj;
     }
-    s->obj = JS_DupValue(ctx, obj);
+}
 
-    /* Apply our event proto if present. */
-    if (!JS_IsUndefined(g_elem_proto)) {
-        JS_SetPrototype(ctx, s->obj, JS_DupValue(ctx, g_elem_proto));
+void minirend_dom_retain_node(JSContext *ctx, int32_t node_id, bool retain) {
+    NodeSlot *s = find_slot(node_id);
+    if (!s || s->owned == retain) return;
+
+    s->owned = retain;
+    if (retain) {
+        JS_DupValue(ctx, s->obj);
+    } else {
+        /* May finalize the wrapper, which erases s. */
+        JS_FreeValue(ctx, s->obj);
     }
 }
 
+void minirend_dom_unregister_node(int32_t node_id) {
+    NodeSlot *s = find_slot(node_id);
+    if (s) erase_slot(s);
+}
+
 JSValue minirend_dom_lookup_node(JSContext *ctx, int32_t node_id) {
     NodeSlot *s = find_slot(node_id);
     if (!s || JS_IsUndefined(s->obj)) return JS_UNDEFINED;
@@ -259,28 +312,21 @@ void minirend_dom_set_active_element(JSContext *ctx, int32_t node_id) {
 }
 
 bool minirend_dom_dispatch_event(JSContext *ctx, int32_t target_node_id, JSValue eventObj) {
-    JSValue target = minirend_dom_lookup_node(ctx, target_node_id);
-    if (JS_IsUndefined(target)) {
-        JS_FreeValue(ctx, eventObj);
-        return true;
+    NodeSlot *s = find_slot(target_node_id);
+    bool result = true;
+    if (s && !JS_IsUndefined(s->obj)) {
+        JSValue target = JS_DupValue(ctx, s->obj);
+        result = minirend_dom_events_dispatch(ctx, target, eventObj);
+        JS_FreeValue(ctx, target);
     }
+    minirend_dom_event_release(ctx, eventObj);
+    return result;
+}
 
-    JSValue args[1] = { eventObj };
-    JSAtom atom = JS_NewAtom(ctx, "dispatchEvent");
-    JSValue ret = JS_Invoke(ctx, target, atom, 1, args);
-    JS_FreeAtom(ctx, atom);
-    JS_FreeValue(ctx, target);
-    /* eventObj consumed by Invoke args; we still own it, so free now */
-    JS_FreeValue(ctx, eventObj);
-
-    if (JS_IsException(ret)) {
-        dump_exception(ctx);
-        JS_FreeValue(ctx, ret);
-        return true;
-    }
-    int b = JS_ToBool(ctx, ret);
-    JS_FreeValue(ctx, ret);
-    return b != 0;
+bool minirend_dom_wants_event(JSContext *ctx, int32_t target_node_id, const char *type) {
+    NodeSlot *s = find_slot(target_node_id);
+    if (!s || JS_IsUndefined(s->obj)) return false;
+    return minirend_dom_events_wanted(ctx, s->obj, type);
 }
 
 
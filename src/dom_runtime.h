@@ -7,25 +7,34 @@
 #include "quickjs.h"
 
 /* DOM runtime helpers:
- * - installs a tiny JS EventTarget/Event runtime
- * - keeps a node_id -> JS object registry
- * - helps C dispatch DOM-ish events into JS
+ * - installs the JS Event/MutationObserver runtime
+ * - keeps a node_id -> JS object registry (weak unless retained)
+ * - helps C dispatch DOM-ish events into JS (see dom_events)
  */
 
 void   minirend_dom_runtime_init(JSContext *ctx);
 void   minirend_dom_runtime_shutdown(JSContext *ctx);
 
+/* obj is expected to inherit __MinirendElementProto already (element
+ * objects do through their class prototype). The registry does not keep
+ * obj alive unless retained; its finalizer must unregister node_id. */
 void   minirend_dom_register_node(JSContext *ctx, int32_t node_id, JSValue obj);
+void   minirend_dom_retain_node(JSContext *ctx, int32_t node_id, bool retain);
+void   minirend_dom_unregister_node(int32_t node_id);
 JSValue minirend_dom_lookup_node(JSContext *ctx, int32_t node_id);
 
 /* Updates document.activeElement (does not itself dispatch focus/blur). */
 void   minirend_dom_set_active_element(JSContext *ctx, int32_t node_id);
 
-/* Dispatch `eventObj` on the target element (bubbling/capture is handled in JS).
+/* Dispatch `eventObj` (consumed) on the target element.
  * Returns true if NOT defaultPrevented.
  */
 bool   minirend_dom_dispatch_event(JSContext *ctx, int32_t target_node_id, JSValue eventObj);
 
+/* Whether any listener on the target's path handles `type`; lets callers
+ * skip building events nobody would see. */
+bool   minirend_dom_wants_event(JSContext *ctx, int32_t target_node_id, const char *type);
+
 #endif /* MINIREND_DOM_RUNTIME_H */
 
 
@@ -0,0 +1,292 @@
+/*
+ * File Map Implementation
+ *
+ * mmap for regular files and stored entries of the executable's ZIP,
+ * heap copy for everything else.
+ */
+
+#include "file_map.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__COSMOPOLITAN__)
+#include <cosmo.h>
+#endif
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define ZIP_EOCD_SIG        0x06054b50u
+#define ZIP_CENTRAL_SIG     0x02014b50u
+#define ZIP_LOCAL_SIG       0x04034b50u
+#define ZIP_EOCD_SIZE       22
+#define ZIP_MAX_COMMENT     65535
+#define ZIP_CENTRAL_SIZE    46
+#define ZIP_LOCAL_SIZE      30
+#define ZIP_METHOD_STORED   0
+#define MAX_CENTRAL_DIR     (64u * 1024u * 1024u)
+
+/* ============================================================================
+ * File Map Structure
+ * ============================================================================ */
+
+struct MinirendFileMap {
+    const uint8_t *data;
+    size_t         size;
+
+    /* Mapping (page aligned, may start before data) or heap copy */
+    void          *base;
+    size_t         base_len;
+    uint8_t       *heap;
+};
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static uint16_t le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool read_at(int fd, void *buf, size_t size, off_t offset) {
+    uint8_t *dst = buf;
+    while (size > 0) {
+        ssize_t n = pread(fd, dst, size, offset);
+        if (n <= 0) return false;
+        dst += n;
+        size -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
+
+/* Map [offset, offset + size) of fd read-only. */
+static bool map_range(MinirendFileMap *map, int fd, off_t offset, size_t size) {
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0) page = 4096;
+
+    off_t start = offset - (offset % page);
+    size_t len = (size_t)(offset - start) + size;
+    void *base = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, start);
+    if (base == MAP_FAILED) return false;
+
+    map->base = base;
+    map->base_len = len;
+    map->data = (const uint8_t *)base + (offset - start);
+    map->size = size;
+    return true;
+}
+
+/* Path of the running executable, which may carry an appended ZIP. */
+static const char *executable_path(void) {
+#if defined(__COSMOPOLITAN__)
+    return GetProgramExecutableName();
+#else
+    return "/proc/self/exe";
+#endif
+}
+
+/* Name of an asset inside the app ZIP (relative to the ZIP root). */
+static const char *zip_entry_name(const char *path) {
+    if (strncmp(path, "/zip/", 5) == 0) return path + 5;
+    if (strncmp(path, "app/", 4) == 0) return path + 4;
+    return path;
+}
+
+/* ============================================================================
+ * Sources
+ * ============================================================================ */
+
+static bool map_regular_file(MinirendFileMap *map, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+              map_range(map, fd, 0, (size_t)st.st_size);
+    close(fd);
+    return ok;
+}
+
+/* Find a stored entry in the ZIP at the end of fd. Offsets are resolved
+ * against where the central directory actually sits, so archives simply
+ * concatenated onto the executable (cat exe app.zip) work as well as
+ * ones whose offsets were adjusted. */
+static bool find_zip_entry(int fd, off_t file_size, const char *name,
+                           off_t *out_offset, size_t *out_size) {
+    size_t tail = ZIP_EOCD_SIZE + ZIP_MAX_COMMENT;
+    if ((off_t)tail > file_size) tail = (size_t)file_size;
+    if (tail < ZIP_EOCD_SIZE) return false;
+
+    uint8_t *buf = malloc(tail);
+    if (!buf) return false;
+    off_t tail_pos = file_size - (off_t)tail;
+    if (!read_at(fd, buf, tail, tail_pos)) {
+        free(buf);
+        return false;
+    }
+
+    /* End of central directory record, scanning back over the comment */
+    long eocd = -1;
+    for (long i = (long)tail - ZIP_EOCD_SIZE; i >= 0; i--) {
+        if (le32(buf + i) == ZIP_EOCD_SIG) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0) {
+        free(buf);
+        return false;
+    }
+
+    uint32_t cd_size = le32(buf + eocd + 12);
+    uint32_t cd_offset = le32(buf + eocd + 16);
+    free(buf);
+
+    off_t cd_pos = tail_pos + eocd - (off_t)cd_size;
+    off_t base = cd_pos - (off_t)cd_offset;
+    if (cd_pos < 0 || base < 0 || cd_size > MAX_CENTRAL_DIR) return false;
+
+    uint8_t *cd = malloc(cd_size ? cd_size : 1);
+    if (!cd) return false;
+    if (!read_at(fd, cd, cd_size, cd_pos)) {
+        free(cd);
+        return false;
+    }
+
+    size_t name_len = strlen(name);
+    bool found = false;
+    uint32_t local_offset = 0, size = 0;
+
+    for (uint32_t p = 0; p + ZIP_CENTRAL_SIZE <= cd_size; ) {
+        const uint8_t *e = cd + p;
+        if (le32(e) != ZIP_CENTRAL_SIG) break;
+
+        uint16_t n = le16(e + 28);
+        uint32_t next = p + ZIP_CENTRAL_SIZE + n + le16(e + 30) + le16(e + 32);
+        if (next > cd_size) break;
+
+        if (n == name_len && memcmp(e + ZIP_CENTRAL_SIZE, name, n) == 0) {
+            /* Deflated entries cannot be mapped */
+            found = le16(e + 10) == ZIP_METHOD_STORED;
+            size = le32(e + 24);
+            local_offset = le32(e + 42);
+            break;
+        }
+        p = next;
+    }
+    free(cd);
+    if (!found || size == 0) return false;
+
+    /* The local header's name/extra lengths may differ from the central one */
+    uint8_t local[ZIP_LOCAL_SIZE];
+    off_t local_pos = base + (off_t)local_offset;
+    if (!read_at(fd, local, sizeof(local), local_pos)) return false;
+    if (le32(local) != ZIP_LOCAL_SIG) return false;
+
+    off_t data_pos = local_pos + ZIP_LOCAL_SIZE + le16(local + 26) + le16(local + 28);
+    if (data_pos + (off_t)size > cd_pos) return false;
+
+    *out_offset = data_pos;
+    *out_size = size;
+    return true;
+}
+
+static bool map_zip_entry(MinirendFileMap *map, const char *path) {
+    const char *exe = executable_path();
+    if (!exe) return false;
+
+    int fd = open(exe, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    off_t offset = 0;
+    size_t size = 0;
+    bool ok = fstat(fd, &st) == 0 &&
+              find_zip_entry(fd, st.st_size, zip_entry_name(path), &offset, &size) &&
+              map_range(map, fd, offset, size);
+    close(fd);
+    return ok;
+}
+
+static bool read_into_heap(MinirendFileMap *map, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f && strcmp(zip_entry_name(path), path) != 0) {
+        f = fopen(zip_entry_name(path), "rb");
+    }
+    if (!f) return false;
+
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size <= 0 || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return false;
+    }
+
+    uint8_t *data = malloc((size_t)size);
+    if (!data || fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+
+    map->heap = data;
+    map->data = data;
+    map->size = (size_t)size;
+    return true;
+}
+
+/* ============================================================================
+ * Open/Close
+ * ============================================================================ */
+
+MinirendFileMap *minirend_file_map_open(const char *path) {
+    if (!path) return NULL;
+
+    MinirendFileMap *map = calloc(1, sizeof(MinirendFileMap));
+    if (!map) return NULL;
+
+    if (map_regular_file(map, path) ||
+        map_zip_entry(map, path) ||
+        read_into_heap(map, path)) {
+        return map;
+    }
+
+    free(map);
+    return NULL;
+}
+
+void minirend_file_map_close(MinirendFileMap *map) {
+    if (!map) return;
+
+    if (map->base) munmap(map->base, map->base_len);
+    free(map->heap);
+    free(map);
+}
+
+const uint8_t *minirend_file_map_data(const MinirendFileMap *map, size_t *out_size) {
+    if (!map) {
+        if (out_size) *out_size = 0;
+        return NULL;
+    }
+
+    if (out_size) *out_size = map->size;
+    return map->data;
+}
+
+bool minirend_file_map_is_mapped(const MinirendFileMap *map) {
+    return map && map->base != NULL;
+}
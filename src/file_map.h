@@ -0,0 +1,43 @@
+#ifndef MINIREND_FILE_MAP_H
+#define MINIREND_FILE_MAP_H
+
+/*
+ * File Map - Read-only, zero-copy access to asset files.
+ *
+ * Files are memory-mapped instead of read into the heap, so large assets
+ * (CJK fonts are 10-20 MB) open instantly and only the pages actually
+ * touched count against RSS. Lookup order:
+ * - A regular file at the given path, mapped directly
+ * - A stored (uncompressed) entry of the ZIP appended to the executable,
+ *   mapped in place inside the executable image
+ * - Anything else readable through fopen() (e.g. deflated ZIP entries via
+ *   Cosmopolitan's /zip/ support), copied into a heap buffer
+ *
+ * As in js_engine.c, a leading "app/" or "/zip/" is dropped when looking
+ * inside the ZIP, whose paths are relative to its root.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ============================================================================
+ * File Map Context
+ * ============================================================================ */
+
+typedef struct MinirendFileMap MinirendFileMap;
+
+/* Open a file for reading. Returns NULL if it cannot be found or read. */
+MinirendFileMap *minirend_file_map_open(const char *path);
+
+/* Unmap (or free) the contents. Pointers from minirend_file_map_data()
+ * become invalid. */
+void minirend_file_map_close(MinirendFileMap *map);
+
+/* Get the file contents and size. Valid until the map is closed. */
+const uint8_t *minirend_file_map_data(const MinirendFileMap *map, size_t *out_size);
+
+/* True if the contents are memory-mapped rather than copied. */
+bool minirend_file_map_is_mapped(const MinirendFileMap *map);
+
+#endif /* MINIREND_FILE_MAP_H */
@@ -8,67 +8,386 @@
 #include <stb_truetype.h>
 
 #include "font_cache.h"
+#include "file_map.h"
 #include "sokol_gfx.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <unistd.h>
+#include <pthread.h>
 
 /* ============================================================================
  * Constants
  * ============================================================================ */
 
 #define MAX_FONTS 16
-#define DEFAULT_ATLAS_SIZE 1024
+#define MAX_FAMILY_NAME 64
+#define DEFAULT_ATLAS_SIZE 512
 #define DEFAULT_MAX_GLYPHS 1024
+#define ATLAS_BUDGET_BYTES (4 * 1024 * 1024)  /* Kept before evicting cold glyphs */
+#define MAX_ATLAS_PAGES 64                    /* Hard cap when everything is in use */
+
+/* Prebaked atlas (see minirend_font_cache_load_atlas) */
+#define BAKED_ATLAS_PATH "app/font_atlas.bin"
+#define BAKED_MAGIC 0x4146524Du   /* "MRFA" */
+#define BAKED_VERSION 1
+
+/* Glyph sizes are cached in half-pixel steps */
+#define SIZE_QUANTUM 0.5f
+
+/* SDF mode: one distance field per glyph, rendered at SDF_BASE_SIZE and
+ * scaled to any size. A distance of SDF_PADDING texels maps to the edge
+ * value, so the field reaches SDF_PADDING texels outside the outline. */
+#define SDF_BASE_SIZE 48.0f
+#define SDF_PADDING 6
+#define SDF_ON_EDGE 128
+#define SDF_DIST_SCALE ((float)SDF_ON_EDGE / (float)SDF_PADDING)
+#define SDF_SIZE_KEY (-1)
+
+/* Per-font advance tables: codepoints below DENSE_CODEPOINTS (Latin-1
+ * and Latin Extended-A/B) are direct array lookups, the rest go through a
+ * hash table filled on first use. Kerning pairs are dense for printable
+ * ASCII, one row per left-hand character. */
+#define DENSE_CODEPOINTS 0x250
+#define KERN_FIRST 0x20
+#define KERN_COUNT 95
+#define SPARSE_INITIAL 256
+
+/* Shaped runs kept before cold ones are dropped */
+#define MAX_SHAPED_RUNS 1024
+#define RUN_INDEX_SIZE (MAX_SHAPED_RUNS * 2)
+
+/* Background rasterization */
+#define MAX_RASTER_THREADS 4
+#define FALLBACK_SIZE_STEPS 16   /* Half-pixel steps searched for a stand-in */
 
 /* ============================================================================
  * Internal Types
  * ============================================================================ */
 
+/* A codepoint outside the dense range (codepoint -1 = empty slot) */
+typedef struct {
+    int32_t codepoint;
+    int32_t glyph;
+    int32_t advance;
+} SparseMetric;
+
+/* Glyph index and advance (font units) by codepoint, built on first use */
+typedef struct {
+    uint16_t     *dense_glyph;      /* DENSE_CODEPOINTS entries */
+    int32_t      *dense_advance;
+    SparseMetric *sparse;
+    uint32_t      sparse_mask;
+    uint32_t      sparse_count;
+    int16_t      *kern;             /* KERN_COUNT^2, NULL without kerning */
+    bool          kern_row[KERN_COUNT];
+} AdvanceTable;
+
 typedef struct {
     stbtt_fontinfo info;
-    unsigned char *data;    /* Font file data (owned if loaded from file) */
-    bool          data_owned;
+    bool          loaded;       /* info is valid */
+    bool          failed;       /* Lazy load was attempted and failed */
+    char         *path;         /* Lazily loaded faces: mapped on first use */
+    char          family[MAX_FAMILY_NAME];  /* Empty for unnamed fonts */
+    int           weight;       /* 100-900 */
+    bool          italic;
+    unsigned char *data;    /* Font file data (mapped if loaded from file) */
+    MinirendFileMap *map;   /* Owned mapping backing data, or NULL */
+    uint64_t      fingerprint;  /* Matches the font in prebaked atlases */
+    AdvanceTable  advances;
     float         scale_for_pixel_height;
 } LoadedFont;
 
 typedef struct {
     int     font_id;
-    int     codepoint;
+    int     glyph;      /* stb_truetype glyph index */
     float   font_size;
+    int     size_key;   /* font_size in SIZE_QUANTUM steps, or SDF_SIZE_KEY */
     
     /* Atlas position */
+    int     page;               /* -1 for empty glyphs (spaces) */
     int     atlas_x, atlas_y;
     int     atlas_w, atlas_h;
     
+    uint32_t last_used;         /* Frame of the most recent lookup */
+    
+    /* Set while a worker rasterizes the bitmap; job identifies the request */
+    bool     pending;
+    uint32_t job;
+    
     /* Glyph metrics */
     float   x_offset, y_offset;
     float   advance;
     
 } CachedGlyph;
 
+/* A glyph bitmap to rasterize off the frame thread. The atlas rect is
+ * reserved up front; pixels holds the result once done. */
+typedef struct {
+    uint32_t id;
+    const stbtt_fontinfo *info;
+    int      font_id;
+    int      glyph;
+    int      size_key;
+    float    scale;
+    int      width, height;
+    unsigned char *pixels;
+} RasterJob;
+
+typedef struct {
+    RasterJob *items;
+    int        head;         /* First queued job */
+    int        count;
+    int        capacity;
+} RasterQueue;
+
+/* Shaped text, keyed by its bytes, font and exact size */
+typedef struct {
+    uint64_t  hash;
+    int       font_id;
+    float     font_size;
+    int32_t   len;
+    char     *text;                 /* Copy of the key (same block as glyphs) */
+    MinirendShapedGlyph *glyphs;
+    int       glyph_count;
+    float     width;
+    uint32_t  last_used;
+} ShapedRun;
+
+/* Skyline segment: the packed area's top edge is y over [x, x + width) */
+typedef struct {
+    int x, y, width;
+} SkylineNode;
+
+/* Prebaked atlas file, in host byte order: the header, font_count font
+ * fingerprints (uint64_t), glyph_count BakedGlyph records, then for each
+ * page its skyline count (uint32_t), atlas_size + 1 SkylineNodes and the
+ * R8 pixels. */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t atlas_size;
+    uint32_t page_count;
+    uint32_t font_count;
+    uint32_t glyph_count;
+} BakedHeader;
+
+typedef struct {
+    int32_t font;           /* Index into the fingerprint table */
+    int32_t glyph;
+    int32_t size_key;
+    int32_t page;
+    int32_t x, y, w, h;
+    float   font_size;
+    float   x_offset, y_offset;
+    float   advance;
+} BakedGlyph;
+
+typedef struct {
+    unsigned char *data;
+    sg_image       texture;
+    bool           dirty;
+    uint32_t       uploaded_frame;  /* Texture is immutable for this frame */
+    uint32_t       last_used;   /* Newest last_used of its glyphs */
+    SkylineNode   *skyline;     /* atlas_size + 1 entries (one spare for insert) */
+    int            skyline_count;
+} AtlasPage;
+
 struct MinirendFontCache {
     /* Loaded fonts */
     LoadedFont  fonts[MAX_FONTS];
     int         font_count;
     int         default_font;
     
+    /* Faces tried in order for codepoints the requested font lacks, and
+     * the face each such codepoint resolved to (-1 = none has it) */
+    int         fallbacks_chain[MAX_FONTS];
+    int         fallback_count;
+    SparseMetric *fallback_faces;   /* glyph field holds the face id */
+    uint32_t     fallback_mask;
+    uint32_t     fallback_used;
+    
     /* Glyph cache */
     CachedGlyph *glyphs;
     int          glyph_count;
     int          max_glyphs;
     
-    /* Atlas */
-    unsigned char *atlas_data;
-    int            atlas_size;
-    int            atlas_row_height;
-    int            atlas_x, atlas_y;  /* Current packing position */
-    sg_image       atlas_texture;
-    bool           atlas_dirty;
+    /* Open-addressing index into glyphs (slot = glyph index + 1, 0 = empty) */
+    uint32_t    *index;
+    uint32_t     index_mask;
+    
+    /* Statistics */
+    uint64_t     hits;
+    uint64_t     misses;
+    uint64_t     clears;
+    uint64_t     evictions;   /* Glyphs evicted to make room */
+    
+    /* Atlas pages, each atlas_size x atlas_size R8 */
+    AtlasPage    pages[MAX_ATLAS_PAGES];
+    int          page_count;
+    int          page_budget;
+    int          atlas_size;
+    
+    /* Upload statistics */
+    uint64_t     uploads;
+    uint64_t     upload_bytes;
+    
+    uint32_t     frame;
+    
+    bool         sdf;         /* Glyphs are distance fields */
+    
+    /* Shaped run cache (slot = run index + 1, 0 = empty) */
+    ShapedRun    runs[MAX_SHAPED_RUNS];
+    int          run_count;
+    uint32_t     run_index[RUN_INDEX_SIZE];
+    uint64_t     run_hits;
+    uint64_t     run_misses;
+    
+    /* Worker pool; no threads means glyphs are rasterized inline */
+    pthread_t       threads[MAX_RASTER_THREADS];
+    int             thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+    bool            shutdown;
+    RasterQueue     jobs;         /* Waiting for a worker (guarded by lock) */
+    RasterQueue     done;         /* Waiting for a blit (guarded by lock) */
+    uint32_t        next_job;
+    int             pending_count;
+    uint64_t        async_glyphs;
+    uint64_t        fallbacks;
+    
+    /* Prebaked atlas whose glyphs are adopted as their fonts load. Its
+     * pages were copied in; dropped once any of them is reset. */
+    MinirendFileMap *baked;
+    BakedHeader      baked_header;
+    uint64_t         prebaked_glyphs;
 };
 
+static void adopt_baked_glyphs(MinirendFontCache *cache, int font_id);
+static void evict_runs(MinirendFontCache *cache, bool all);
+static void drop_baked_atlas(MinirendFontCache *cache);
+
+/* ============================================================================
+ * Atlas Pages
+ * ============================================================================ */
+
+static void reset_page(MinirendFontCache *cache, AtlasPage *page) {
+    memset(page->data, 0, (size_t)cache->atlas_size * cache->atlas_size);
+    page->skyline[0] = (SkylineNode){ 0, 0, cache->atlas_size };
+    page->skyline_count = 1;
+    page->last_used = 0;
+    page->dirty = true;
+}
+
+/* sokol_gfx allows one sg_update_image per image per frame, so once a
+ * page was uploaded, new glyphs go elsewhere until the frame ends. */
+static bool page_writable(const MinirendFontCache *cache, int page) {
+    return cache->pages[page].uploaded_frame != cache->frame;
+}
+
+static bool add_page(MinirendFontCache *cache, int limit) {
+    if (cache->page_count >= limit) return false;
+    
+    AtlasPage *page = &cache->pages[cache->page_count];
+    page->data = malloc((size_t)cache->atlas_size * cache->atlas_size);
+    page->skyline = malloc((cache->atlas_size + 1) * sizeof(SkylineNode));
+    if (!page->data || !page->skyline) {
+        free(page->data);
+        free(page->skyline);
+        memset(page, 0, sizeof(*page));
+        return false;
+    }
+    reset_page(cache, page);
+    
+    /* Headless caches keep the atlas on the CPU */
+    if (sg_isvalid()) {
+        page->texture = sg_make_image(&(sg_image_desc){
+            .width = cache->atlas_size,
+            .height = cache->atlas_size,
+            .pixel_format = SG_PIXELFORMAT_R8,
+            .usage = SG_USAGE_DYNAMIC,
+        });
+    }
+    
+    cache->page_count++;
+    return true;
+}
+
+/* Lowest y at which a w x h rect fits with its left edge at node i,
+ * or -1 if it runs off the page. */
+static int skyline_fit(const MinirendFontCache *cache, const AtlasPage *page,
+                       int i, int w, int h) {
+    int x = page->skyline[i].x;
+    if (x + w > cache->atlas_size) return -1;
+    
+    int y = 0;
+    int remaining = w;
+    while (remaining > 0) {
+        if (page->skyline[i].y > y) y = page->skyline[i].y;
+        remaining -= page->skyline[i].width;
+        i++;
+    }
+    return y + h <= cache->atlas_size ? y : -1;
+}
+
+/* Bottom-left skyline packing. Returns false if the page has no room. */
+static bool skyline_pack(MinirendFontCache *cache, AtlasPage *page,
+                         int w, int h, int *out_x, int *out_y) {
+    int best = -1, best_y = 0, best_width = 0;
+    
+    for (int i = 0; i < page->skyline_count; i++) {
+        int y = skyline_fit(cache, page, i, w, h);
+        if (y < 0) continue;
+        if (best < 0 || y < best_y ||
+            (y == best_y && page->skyline[i].width < best_width)) {
+            best = i;
+            best_y = y;
+            best_width = page->skyline[i].width;
+        }
+    }
+    if (best < 0) return false;
+    
+    int x = page->skyline[best].x;
+    
+    /* Insert the new segment, then trim the ones it shadows */
+    memmove(&page->skyline[best + 1], &page->skyline[best],
+            (page->skyline_count - best) * sizeof(SkylineNode));
+    page->skyline[best] = (SkylineNode){ x, best_y + h, w };
+    page->skyline_count++;
+    
+    int i = best + 1;
+    while (i < page->skyline_count) {
+        SkylineNode *n = &page->skyline[i];
+        int shadow = x + w - n->x;
+        if (shadow <= 0) break;
+        if (shadow < n->width) {
+            n->x += shadow;
+            n->width -= shadow;
+            break;
+        }
+        memmove(n, n + 1, (page->skyline_count - i - 1) * sizeof(SkylineNode));
+        page->skyline_count--;
+    }
+    
+    /* Merge neighbours at the same height */
+    for (i = 0; i + 1 < page->skyline_count; ) {
+        if (page->skyline[i].y == page->skyline[i + 1].y) {
+            page->skyline[i].width += page->skyline[i + 1].width;
+            memmove(&page->skyline[i + 1], &page->skyline[i + 2],
+                    (page->skyline_count - i - 2) * sizeof(SkylineNode));
+            page->skyline_count--;
+        } else {
+            i++;
+        }
+    }
+    
+    *out_x = x;
+    *out_y = best_y;
+    return true;
+}
+
 /* ============================================================================
  * Create/Destroy
  * ============================================================================ */
@@ -81,6 +400,12 @@ MinirendFontCache *minirend_font_cache_create(int atlas_size, int max_glyphs) {
     cache->max_glyphs = max_glyphs > 0 ? max_glyphs : DEFAULT_MAX_GLYPHS;
     cache->default_font = -1;
     
+    /* Small pages keep each upload cheap; the budget sets how many */
+    size_t page_bytes = (size_t)cache->atlas_size * cache->atlas_size;
+    cache->page_budget = (int)(ATLAS_BUDGET_BYTES / page_bytes);
+    if (cache->page_budget < 1) cache->page_budget = 1;
+    if (cache->page_budget > MAX_ATLAS_PAGES) cache->page_budget = MAX_ATLAS_PAGES;
+    
     /* Allocate glyph cache */
     cache->glyphs = calloc(cache->max_glyphs, sizeof(CachedGlyph));
     if (!cache->glyphs) {
@@ -88,21 +413,28 @@ MinirendFontCache *minirend_font_cache_create(int atlas_size, int max_glyphs) {
         return NULL;
     }
     
-    /* Allocate atlas data */
-    cache->atlas_data = calloc(cache->atlas_size * cache->atlas_size, 1);
-    if (!cache->atlas_data) {
+    /* Allocate glyph index (power of two, load factor <= 0.5) */
+    uint32_t index_cap = 16;
+    while (index_cap < (uint32_t)cache->max_glyphs * 2) index_cap <<= 1;
+    cache->index = calloc(index_cap, sizeof(uint32_t));
+    if (!cache->index) {
+        free(cache->glyphs);
+        free(cache);
+        return NULL;
+    }
+    cache->index_mask = index_cap - 1;
+    
+    /* First atlas page; more are added as glyphs need them */
+    if (!add_page(cache, MAX_ATLAS_PAGES)) {
+        free(cache->index);
         free(cache->glyphs);
         free(cache);
         return NULL;
     }
+    cache->frame = 1;
     
-    /* Create atlas texture */
-    cache->atlas_texture = sg_make_image(&(sg_image_desc){
-        .width = cache->atlas_size,
-        .height = cache->atlas_size,
-        .pixel_format = SG_PIXELFORMAT_R8,
-        .usage = SG_USAGE_DYNAMIC,
-    });
+    /* Glyphs prerasterized at build time, if the app ships them */
+    minirend_font_cache_load_atlas(cache, BAKED_ATLAS_PATH);
     
     return cache;
 }
@@ -110,15 +442,33 @@ MinirendFontCache *minirend_font_cache_create(int atlas_size, int max_glyphs) {
 void minirend_font_cache_destroy(MinirendFontCache *cache) {
     if (!cache) return;
     
+    minirend_font_cache_stop_workers(cache);
+    drop_baked_atlas(cache);
+    
     /* Free font data */
     for (int i = 0; i < cache->font_count; i++) {
-        if (cache->fonts[i].data_owned && cache->fonts[i].data) {
-            free(cache->fonts[i].data);
-        }
+        AdvanceTable *t = &cache->fonts[i].advances;
+        free(t->dense_glyph);
+        free(t->dense_advance);
+        free(t->sparse);
+        free(t->kern);
+        free(cache->fonts[i].path);
+        minirend_file_map_close(cache->fonts[i].map);
     }
+    free(cache->fallback_faces);
     
-    sg_destroy_image(cache->atlas_texture);
-    free(cache->atlas_data);
+    for (int i = 0; i < cache->page_count; i++) {
+        AtlasPage *page = &cache->pages[i];
+        if (page->texture.id != SG_INVALID_ID) {
+            sg_destroy_image(page->texture);
+        }
+        free(page->data);
+        free(page->skyline);
+    }
+    for (int i = 0; i < cache->run_count; i++) {
+        free(cache->runs[i].glyphs);
+    }
+    free(cache->index);
     free(cache->glyphs);
     free(cache);
 }
@@ -127,78 +477,204 @@ void minirend_font_cache_destroy(MinirendFontCache *cache) {
  * Font Loading
  * ============================================================================ */
 
-static unsigned char *load_file(const char *path, size_t *out_size) {
-    FILE *f = fopen(path, "rb");
-    if (!f) return NULL;
-    
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
+/* Identify a font without reading all of it: the sfnt table directory
+ * holds a checksum for every table. */
+static uint64_t font_fingerprint(const unsigned char *data, size_t size) {
+    size_t n = 12;
+    if (size >= 12) n += (size_t)((data[4] << 8) | data[5]) * 16;
+    if (n > size) n = size;
     
-    if (size <= 0) {
-        fclose(f);
-        return NULL;
+    uint64_t h = 0xcbf29ce484222325ULL ^ (uint64_t)size;
+    for (size_t i = 0; i < n; i++) {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
     }
+    return h;
+}
+
+/* Parse a font and make it usable. The data must outlive the font. */
+static bool init_face(MinirendFontCache *cache, int font_id,
+                      const unsigned char *data, size_t size) {
+    LoadedFont *font = &cache->fonts[font_id];
+    if (!stbtt_InitFont(&font->info, data, 0)) return false;
     
-    unsigned char *data = malloc(size);
-    if (!data) {
-        fclose(f);
-        return NULL;
-    }
+    font->data = (unsigned char *)data;
+    font->fingerprint = font_fingerprint(data, size);
+    font->loaded = true;
     
-    if (fread(data, 1, size, f) != (size_t)size) {
-        free(data);
-        fclose(f);
-        return NULL;
+    adopt_baked_glyphs(cache, font_id);
+    return true;
+}
+
+/* Map a lazily registered face the first time it is needed */
+static bool ensure_face(MinirendFontCache *cache, int font_id) {
+    LoadedFont *font = &cache->fonts[font_id];
+    if (font->loaded) return true;
+    if (font->failed || !font->path) return false;
+    
+    MinirendFileMap *map = minirend_file_map_open(font->path);
+    size_t size = 0;
+    const uint8_t *data = minirend_file_map_data(map, &size);
+    if (!map || !init_face(cache, font_id, data, size)) {
+        fprintf(stderr, "[font_cache] Failed to load font face: %s\n", font->path);
+        minirend_file_map_close(map);
+        font->failed = true;
+        return false;
     }
+    font->map = map;
+    return true;
+}
+
+/* Resolve -1 to the default font and load the face if needed. Returns
+ * the font id, or -1 if there is no usable font. */
+static int resolve_font(MinirendFontCache *cache, int font_id) {
+    if (font_id < 0) font_id = cache->default_font;
+    if (font_id < 0 || font_id >= cache->font_count) return -1;
+    return ensure_face(cache, font_id) ? font_id : -1;
+}
+
+static LoadedFont *new_font_slot(MinirendFontCache *cache) {
+    if (cache->font_count >= MAX_FONTS) return NULL;
     
-    fclose(f);
+    LoadedFont *font = &cache->fonts[cache->font_count];
+    memset(font, 0, sizeof(*font));
+    font->weight = 400;
+    return font;
+}
+
+static void add_font_slot(MinirendFontCache *cache) {
+    int font_id = cache->font_count++;
     
-    if (out_size) *out_size = size;
-    return data;
+    /* Set as default if first font */
+    if (cache->default_font < 0) {
+        cache->default_font = font_id;
+    }
 }
 
 int minirend_font_cache_load_font(MinirendFontCache *cache, const char *path) {
     if (!cache || !path) return -1;
     if (cache->font_count >= MAX_FONTS) return -1;
     
+    /* Map the file (or its entry in the app zip) instead of copying it;
+     * stb_truetype reads tables straight out of the mapping. */
+    MinirendFileMap *map = minirend_file_map_open(path);
+    if (!map) return -1;
+    
     size_t size = 0;
-    unsigned char *data = load_file(path, &size);
-    if (!data) return -1;
+    const uint8_t *data = minirend_file_map_data(map, &size);
     
     int font_id = minirend_font_cache_load_font_memory(cache, data, size);
     if (font_id < 0) {
-        free(data);
+        minirend_file_map_close(map);
         return -1;
     }
     
-    cache->fonts[font_id].data_owned = true;
+    cache->fonts[font_id].map = map;
     return font_id;
 }
 
 int minirend_font_cache_load_font_memory(MinirendFontCache *cache,
                                          const unsigned char *data, size_t size) {
     if (!cache || !data || size == 0) return -1;
-    if (cache->font_count >= MAX_FONTS) return -1;
+    if (!new_font_slot(cache)) return -1;
     
     int font_id = cache->font_count;
-    LoadedFont *font = &cache->fonts[font_id];
+    if (!init_face(cache, font_id, data, size)) return -1;
     
-    font->data = (unsigned char *)data;
-    font->data_owned = false;
+    add_font_slot(cache);
+    return font_id;
+}
+
+int minirend_font_cache_register_face(MinirendFontCache *cache,
+                                      const char *family, const char *path,
+                                      int weight, bool italic) {
+    if (!cache || !path) return -1;
     
-    if (!stbtt_InitFont(&font->info, data, 0)) {
-        return -1;
+    LoadedFont *font = new_font_slot(cache);
+    if (!font) return -1;
+    
+    size_t path_len = strlen(path);
+    font->path = malloc(path_len + 1);
+    if (!font->path) return -1;
+    memcpy(font->path, path, path_len + 1);
+    if (family) {
+        snprintf(font->family, sizeof(font->family), "%s", family);
+    }
+    font->weight = weight > 0 ? weight : 400;
+    font->italic = italic;
+    
+    int font_id = cache->font_count;
+    add_font_slot(cache);
+    return font_id;
+}
+
+static bool is_fallback(const MinirendFontCache *cache, int font_id) {
+    for (int i = 0; i < cache->fallback_count; i++) {
+        if (cache->fallbacks_chain[i] == font_id) return true;
+    }
+    return false;
+}
+
+/* Distance from the requested weight, following the CSS font matching
+ * order: for 400-500 try up to 500, then lighter, then heavier; below
+ * 400 lighter first; above 500 heavier first. Lower is better. */
+static int weight_distance(int wanted, int weight) {
+    if (wanted >= 400 && wanted <= 500) {
+        if (weight >= wanted && weight <= 500) return weight - wanted;
+        if (weight < wanted) return 1000 + (wanted - weight);
+        return 2000 + (weight - wanted);
     }
+    if (wanted < 400) {
+        return weight <= wanted ? wanted - weight : 1000 + (weight - wanted);
+    }
+    return weight >= wanted ? weight - wanted : 1000 + (wanted - weight);
+}
+
+int minirend_font_cache_match_face(MinirendFontCache *cache, const char *family,
+                                   int weight, bool italic) {
+    if (!cache) return -1;
     
-    cache->font_count++;
+    /* Unnamed lookups use the default font's family. A default loaded
+     * with load_font has none: its family is then every unnamed face
+     * except the fallbacks. */
+    if (!family && cache->default_font >= 0) {
+        family = cache->fonts[cache->default_font].family;
+    }
+    if (!family) return cache->default_font;
+    if (weight <= 0) weight = 400;
     
-    /* Set as default if first font */
-    if (cache->default_font < 0) {
-        cache->default_font = font_id;
+    int best = -1, best_score = 0;
+    for (int i = 0; i < cache->font_count; i++) {
+        const LoadedFont *font = &cache->fonts[i];
+        if (font->failed || strcmp(font->family, family) != 0) continue;
+        if (!family[0] && i != cache->default_font && is_fallback(cache, i)) continue;
+        
+        /* Style mismatches rank below every weight within the style */
+        int score = weight_distance(weight, font->weight);
+        if (font->italic != italic) score += 10000;
+        if (best < 0 || score < best_score) {
+            best = i;
+            best_score = score;
+        }
     }
+    return best >= 0 ? best : cache->default_font;
+}
+
+bool minirend_font_cache_add_fallback(MinirendFontCache *cache, int font_id) {
+    if (!cache || font_id < 0 || font_id >= cache->font_count) return false;
+    if (cache->fallback_count >= MAX_FONTS) return false;
     
-    return font_id;
+    cache->fallbacks_chain[cache->fallback_count++] = font_id;
+    
+    /* Earlier resolutions may now pick another face */
+    cache->fallback_used = 0;
+    if (cache->fallback_faces) {
+        for (uint32_t i = 0; i <= cache->fallback_mask; i++) {
+            cache->fallback_faces[i].codepoint = -1;
+        }
+    }
+    evict_runs(cache, true);
+    return true;
 }
 
 void minirend_font_cache_set_default_font(MinirendFontCache *cache, int font_id) {
@@ -208,93 +684,549 @@ void minirend_font_cache_set_default_font(MinirendFontCache *cache, int font_id)
     }
 }
 
+/* ============================================================================
+ * Raster Job Queues
+ * ============================================================================ */
+
+static bool queue_push(RasterQueue *q, const RasterJob *job) {
+    if (q->count == q->capacity) {
+        int new_cap = q->capacity ? q->capacity * 2 : 64;
+        RasterJob *items = malloc(new_cap * sizeof(RasterJob));
+        if (!items) return false;
+        for (int i = 0; i < q->count; i++) {
+            items[i] = q->items[(q->head + i) % q->capacity];
+        }
+        free(q->items);
+        q->items = items;
+        q->head = 0;
+        q->capacity = new_cap;
+    }
+    q->items[(q->head + q->count) % q->capacity] = *job;
+    q->count++;
+    return true;
+}
+
+static bool queue_pop(RasterQueue *q, RasterJob *out_job) {
+    if (q->count == 0) return false;
+    *out_job = q->items[q->head];
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    return true;
+}
+
 /* ============================================================================
  * Glyph Caching
  * ============================================================================ */
 
+static int quantize_size(float font_size) {
+    return (int)lroundf(font_size / SIZE_QUANTUM);
+}
+
+static uint32_t glyph_hash(int font_id, int glyph, int size_key) {
+    uint32_t h = (uint32_t)glyph * 0x9E3779B1u;
+    h ^= ((uint32_t)size_key * 0x85EBCA77u) + ((uint32_t)font_id << 24);
+    h ^= h >> 15;
+    h *= 0xC2B2AE3Du;
+    h ^= h >> 13;
+    return h;
+}
+
 static CachedGlyph *find_cached_glyph(MinirendFontCache *cache,
-                                      int font_id, int codepoint, float font_size) {
-    /* Simple linear search - could be optimized with hash table */
-    for (int i = 0; i < cache->glyph_count; i++) {
-        CachedGlyph *g = &cache->glyphs[i];
-        if (g->font_id == font_id && g->codepoint == codepoint &&
-            fabsf(g->font_size - font_size) < 0.5f) {
+                                      int font_id, int glyph, int size_key) {
+    uint32_t i = glyph_hash(font_id, glyph, size_key) & cache->index_mask;
+    
+    /* Linear probing; the index is never more than half full */
+    for (;;) {
+        uint32_t slot = cache->index[i];
+        if (slot == 0) return NULL;
+        
+        CachedGlyph *g = &cache->glyphs[slot - 1];
+        if (g->glyph == glyph && g->size_key == size_key &&
+            g->font_id == font_id) {
             return g;
         }
+        i = (i + 1) & cache->index_mask;
     }
-    return NULL;
+}
+
+static void index_glyph(MinirendFontCache *cache, int glyph_index) {
+    CachedGlyph *g = &cache->glyphs[glyph_index];
+    uint32_t i = glyph_hash(g->font_id, g->glyph, g->size_key) & cache->index_mask;
+    while (cache->index[i] != 0) {
+        i = (i + 1) & cache->index_mask;
+    }
+    cache->index[i] = (uint32_t)glyph_index + 1;
+}
+
+/* The index entry pointing at glyph_index (which must be indexed) */
+static uint32_t *glyph_index_slot(MinirendFontCache *cache, int glyph_index) {
+    const CachedGlyph *g = &cache->glyphs[glyph_index];
+    uint32_t i = glyph_hash(g->font_id, g->glyph, g->size_key) & cache->index_mask;
+    while (cache->index[i] != (uint32_t)glyph_index + 1) {
+        i = (i + 1) & cache->index_mask;
+    }
+    return &cache->index[i];
+}
+
+/* Delete one entry, pulling later entries of its probe run back into the
+ * hole unless their home slot lies after it */
+static void unindex_glyph(MinirendFontCache *cache, int glyph_index) {
+    uint32_t hole = (uint32_t)(glyph_index_slot(cache, glyph_index) - cache->index);
+    uint32_t i = hole;
+    for (;;) {
+        i = (i + 1) & cache->index_mask;
+        uint32_t slot = cache->index[i];
+        if (slot == 0) break;
+        const CachedGlyph *g = &cache->glyphs[slot - 1];
+        uint32_t home = glyph_hash(g->font_id, g->glyph, g->size_key) & cache->index_mask;
+        if (((i - home) & cache->index_mask) >= ((i - hole) & cache->index_mask)) {
+            cache->index[hole] = slot;
+            hole = i;
+        }
+    }
+    cache->index[hole] = 0;
+}
+
+/* Rebuild the index after glyphs were removed from the table */
+static void reindex_glyphs(MinirendFontCache *cache) {
+    memset(cache->index, 0, ((size_t)cache->index_mask + 1) * sizeof(uint32_t));
+    for (int i = 0; i < cache->glyph_count; i++) {
+        index_glyph(cache, i);
+    }
+}
+
+/* Least recently used glyph not referenced this frame (nor waiting for
+ * its bitmap). With w >= 0, only
+ * glyphs whose atlas rect can hold a w x h bitmap qualify (the smallest
+ * such rect wins ties). Returns the glyph index or -1. */
+static int find_cold_glyph(const MinirendFontCache *cache, int w, int h) {
+    int best = -1;
+    for (int i = 0; i < cache->glyph_count; i++) {
+        const CachedGlyph *g = &cache->glyphs[i];
+        if (g->last_used >= cache->frame || g->pending) continue;
+        if (w >= 0 && (g->page < 0 || g->atlas_w < w || g->atlas_h < h ||
+                       !page_writable(cache, g->page))) continue;
+        
+        if (best < 0) {
+            best = i;
+            continue;
+        }
+        const CachedGlyph *b = &cache->glyphs[best];
+        if (g->last_used < b->last_used ||
+            (g->last_used == b->last_used &&
+             g->atlas_w * g->atlas_h < b->atlas_w * b->atlas_h)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/* Remove a glyph from the table. Its atlas rect is not reused by the
+ * skyline; it is reclaimed when the page is evicted. */
+static void evict_glyph(MinirendFontCache *cache, int glyph_index) {
+    if (cache->glyphs[glyph_index].pending) cache->pending_count--;
+    unindex_glyph(cache, glyph_index);
+    
+    /* The last glyph fills the gap; only its index entry changes */
+    int last = --cache->glyph_count;
+    if (glyph_index != last) {
+        *glyph_index_slot(cache, last) = (uint32_t)glyph_index + 1;
+        cache->glyphs[glyph_index] = cache->glyphs[last];
+    }
+    cache->evictions++;
+}
+
+/* Evict every glyph on the page whose glyphs were used least recently.
+ * Pages used in the current frame are never evicted: their UVs may
+ * already be batched. Returns the page index, or -1 if none qualifies. */
+static int evict_coldest_page(MinirendFontCache *cache) {
+    /* Rects awaiting a worker's bitmap stay reserved */
+    bool busy[MAX_ATLAS_PAGES] = { false };
+    for (int i = 0; i < cache->glyph_count && cache->pending_count > 0; i++) {
+        if (cache->glyphs[i].pending) busy[cache->glyphs[i].page] = true;
+    }
+    
+    int coldest = -1;
+    for (int i = 0; i < cache->page_count; i++) {
+        if (cache->pages[i].last_used >= cache->frame) continue;
+        if (!page_writable(cache, i) || busy[i]) continue;
+        if (coldest < 0 || cache->pages[i].last_used < cache->pages[coldest].last_used) {
+            coldest = i;
+        }
+    }
+    if (coldest < 0) return -1;
+    
+    /* Drop its glyphs, keeping the table dense */
+    int kept = 0;
+    for (int i = 0; i < cache->glyph_count; i++) {
+        if (cache->glyphs[i].page == coldest) continue;
+        if (kept != i) cache->glyphs[kept] = cache->glyphs[i];
+        kept++;
+    }
+    cache->evictions += cache->glyph_count - kept;
+    cache->glyph_count = kept;
+    reindex_glyphs(cache);
+    
+    /* Baked glyphs of fonts not loaded yet lived on it too */
+    drop_baked_atlas(cache);
+    reset_page(cache, &cache->pages[coldest]);
+    return coldest;
+}
+
+static bool pack_new_page(MinirendFontCache *cache, int pw, int ph,
+                          int *out_page, int *out_x, int *out_y) {
+    int page = cache->page_count - 1;
+    if (!skyline_pack(cache, &cache->pages[page], pw, ph, out_x, out_y)) {
+        return false;
+    }
+    *out_page = page;
+    return true;
+}
+
+/* Find room for a w x h glyph, in order: free space on an existing page,
+ * a new page within the budget, the rect of a cold glyph, a whole cold
+ * page, and finally a page over the budget (glyphs in use are never
+ * evicted, so a frame that needs more space gets it). */
+static bool allocate_glyph(MinirendFontCache *cache, int w, int h,
+                           int *out_page, int *out_x, int *out_y) {
+    /* Keep a 1 pixel gutter so bilinear sampling never bleeds */
+    int pw = w + 1, ph = h + 1;
+    if (pw > cache->atlas_size || ph > cache->atlas_size) return false;
+    
+    for (int i = cache->page_count - 1; i >= 0; i--) {
+        if (!page_writable(cache, i)) continue;
+        if (skyline_pack(cache, &cache->pages[i], pw, ph, out_x, out_y)) {
+            *out_page = i;
+            return true;
+        }
+    }
+    
+    if (add_page(cache, cache->page_budget)) {
+        return pack_new_page(cache, pw, ph, out_page, out_x, out_y);
+    }
+    
+    /* Reuse a cold glyph's rect; once over budget, recycle whole pages
+     * instead so leaked rects do not keep the atlas growing */
+    int victim = -1;
+    if (cache->page_count <= cache->page_budget) {
+        victim = find_cold_glyph(cache, w, h);
+    }
+    if (victim >= 0) {
+        CachedGlyph *g = &cache->glyphs[victim];
+        AtlasPage *p = &cache->pages[g->page];
+        for (int y = 0; y < g->atlas_h; y++) {
+            memset(p->data + (g->atlas_y + y) * cache->atlas_size + g->atlas_x,
+                   0, g->atlas_w);
+        }
+        *out_page = g->page;
+        *out_x = g->atlas_x;
+        *out_y = g->atlas_y;
+        evict_glyph(cache, victim);
+        return true;
+    }
+    
+    int page = evict_coldest_page(cache);
+    if (page >= 0) {
+        if (!skyline_pack(cache, &cache->pages[page], pw, ph, out_x, out_y)) {
+            return false;
+        }
+        *out_page = page;
+        return true;
+    }
+    
+    if (add_page(cache, MAX_ATLAS_PAGES)) {
+        return pack_new_page(cache, pw, ph, out_page, out_x, out_y);
+    }
+    return false;
+}
+
+/* Bitmap box of a glyph; distance fields extend it by the SDF spread,
+ * matching what stbtt_GetGlyphSDF produces. */
+static void glyph_box(const stbtt_fontinfo *info, int glyph, float scale, bool sdf,
+                      int *out_x0, int *out_y0, int *out_w, int *out_h) {
+    int x0, y0, x1, y1;
+    stbtt_GetGlyphBitmapBox(info, glyph, scale, scale, &x0, &y0, &x1, &y1);
+    
+    if (x1 <= x0 || y1 <= y0) {
+        *out_x0 = *out_y0 = *out_w = *out_h = 0;
+        return;
+    }
+    if (sdf) {
+        x0 -= SDF_PADDING;
+        y0 -= SDF_PADDING;
+        x1 += SDF_PADDING;
+        y1 += SDF_PADDING;
+    }
+    *out_x0 = x0;
+    *out_y0 = y0;
+    *out_w = x1 - x0;
+    *out_h = y1 - y0;
+}
+
+/* Rasterize a w x h glyph bitmap into dest. Safe to call from workers:
+ * stb_truetype only reads the font data. */
+static void rasterize_glyph(const stbtt_fontinfo *info, int glyph, float scale,
+                            bool sdf, int w, int h,
+                            unsigned char *dest, int stride) {
+    if (!sdf) {
+        stbtt_MakeGlyphBitmap(info, dest, w, h, stride, scale, scale, glyph);
+        return;
+    }
+    
+    int sw = 0, sh = 0, xoff, yoff;
+    unsigned char *field = stbtt_GetGlyphSDF(info, scale, glyph,
+                                             SDF_PADDING, SDF_ON_EDGE, SDF_DIST_SCALE,
+                                             &sw, &sh, &xoff, &yoff);
+    if (!field) return;
+    
+    int cw = sw < w ? sw : w;
+    int ch = sh < h ? sh : h;
+    for (int y = 0; y < ch; y++) {
+        memcpy(dest + y * stride, field + y * sw, cw);
+    }
+    stbtt_FreeSDF(field, NULL);
 }
 
 static CachedGlyph *cache_glyph(MinirendFontCache *cache,
-                                int font_id, int codepoint, float font_size) {
+                                int font_id, int glyph, int size_key) {
     if (font_id < 0 || font_id >= cache->font_count) return NULL;
+    if (!ensure_face(cache, font_id)) return NULL;
     
+    /* Rasterize at the quantized size so every lookup in the bucket matches;
+     * distance fields are always built at the base size */
+    bool sdf = size_key == SDF_SIZE_KEY;
+    float font_size = sdf ? SDF_BASE_SIZE : (float)size_key * SIZE_QUANTUM;
     LoadedFont *font = &cache->fonts[font_id];
     float scale = stbtt_ScaleForPixelHeight(&font->info, font_size);
     
     /* Get glyph metrics */
     int advance, lsb;
-    stbtt_GetCodepointHMetrics(&font->info, codepoint, &advance, &lsb);
-    
-    int x0, y0, x1, y1;
-    stbtt_GetCodepointBitmapBox(&font->info, codepoint, scale, scale,
-                                &x0, &y0, &x1, &y1);
+    stbtt_GetGlyphHMetrics(&font->info, glyph, &advance, &lsb);
     
-    int glyph_w = x1 - x0;
-    int glyph_h = y1 - y0;
+    int x0, y0, glyph_w, glyph_h;
+    glyph_box(&font->info, glyph, scale, sdf, &x0, &y0, &glyph_w, &glyph_h);
     
-    /* Check if glyph fits in current row */
-    if (cache->atlas_x + glyph_w + 1 > cache->atlas_size) {
-        /* Move to next row */
-        cache->atlas_x = 0;
-        cache->atlas_y += cache->atlas_row_height + 1;
-        cache->atlas_row_height = 0;
-    }
-    
-    /* Check if atlas is full */
-    if (cache->atlas_y + glyph_h > cache->atlas_size) {
-        /* Atlas full - clear and restart */
-        minirend_font_cache_clear(cache);
-    }
-    
-    /* Ensure glyph cache has space */
+    /* Ensure glyph table has space, before an atlas rect is reserved
+     * (a rect for a glyph that cannot be cached would be lost) */
     if (cache->glyph_count >= cache->max_glyphs) {
-        minirend_font_cache_clear(cache);
+        int victim = find_cold_glyph(cache, -1, -1);
+        if (victim < 0) return NULL;
+        evict_glyph(cache, victim);
     }
     
-    /* Rasterize glyph */
+    /* Place glyph in the atlas (empty glyphs take no space) */
+    int page = -1, atlas_x = 0, atlas_y = 0;
     if (glyph_w > 0 && glyph_h > 0) {
-        unsigned char *dest = cache->atlas_data +
-                              cache->atlas_y * cache->atlas_size + cache->atlas_x;
-        stbtt_MakeCodepointBitmap(&font->info, dest,
-                                  glyph_w, glyph_h, cache->atlas_size,
-                                  scale, scale, codepoint);
+        if (!allocate_glyph(cache, glyph_w, glyph_h, &page, &atlas_x, &atlas_y)) {
+            return NULL;
+        }
+        cache->pages[page].last_used = cache->frame;
     }
     
     /* Add to cache */
-    CachedGlyph *g = &cache->glyphs[cache->glyph_count++];
+    int glyph_index = cache->glyph_count++;
+    CachedGlyph *g = &cache->glyphs[glyph_index];
     g->font_id = font_id;
-    g->codepoint = codepoint;
+    g->glyph = glyph;
     g->font_size = font_size;
-    g->atlas_x = cache->atlas_x;
-    g->atlas_y = cache->atlas_y;
+    g->size_key = size_key;
+    g->page = page;
+    g->atlas_x = atlas_x;
+    g->atlas_y = atlas_y;
     g->atlas_w = glyph_w;
     g->atlas_h = glyph_h;
     g->x_offset = (float)x0;
     g->y_offset = (float)y0;
     g->advance = (float)advance * scale;
+    g->last_used = cache->frame;
+    g->pending = false;
+    g->job = 0;
     
-    /* Update packing position */
-    cache->atlas_x += glyph_w + 1;
-    if (glyph_h > cache->atlas_row_height) {
-        cache->atlas_row_height = glyph_h;
-    }
+    index_glyph(cache, glyph_index);
     
-    cache->atlas_dirty = true;
+    if (page < 0) return g;
     
+    /* Hand the bitmap to a worker; it lands in the atlas next frame */
+    if (cache->thread_count > 0) {
+        RasterJob job = {
+            .id = ++cache->next_job,
+            .info = &font->info,
+            .font_id = font_id,
+            .glyph = glyph,
+            .size_key = size_key,
+            .scale = scale,
+            .width = glyph_w,
+            .height = glyph_h,
+        };
+        pthread_mutex_lock(&cache->lock);
+        bool queued = queue_push(&cache->jobs, &job);
+        if (queued) pthread_cond_signal(&cache->wake);
+        pthread_mutex_unlock(&cache->lock);
+        
+        if (queued) {
+            g->pending = true;
+            g->job = job.id;
+            cache->pending_count++;
+            cache->async_glyphs++;
+            return g;
+        }
+    }
+    
+    /* No workers (or out of memory): rasterize inline */
+    AtlasPage *p = &cache->pages[page];
+    rasterize_glyph(&font->info, glyph, scale, sdf, glyph_w, glyph_h,
+                    p->data + atlas_y * cache->atlas_size + atlas_x,
+                    cache->atlas_size);
+    p->dirty = true;
     return g;
 }
 
+/* A rasterized glyph of the same font at a nearby size, to stand in for
+ * one whose bitmap is still being produced. */
+static CachedGlyph *find_fallback_glyph(MinirendFontCache *cache,
+                                        int font_id, int glyph, int size_key) {
+    if (size_key == SDF_SIZE_KEY) return NULL;
+    
+    for (int d = 1; d <= FALLBACK_SIZE_STEPS; d++) {
+        for (int sign = -1; sign <= 1; sign += 2) {
+            int key = size_key + sign * d;
+            if (key <= 0) continue;
+            
+            CachedGlyph *g = find_cached_glyph(cache, font_id, glyph, key);
+            if (g && !g->pending && g->page >= 0) return g;
+        }
+    }
+    return NULL;
+}
+
+/* ============================================================================
+ * Background Rasterization
+ * ============================================================================ */
+
+static void *raster_worker(void *arg) {
+    MinirendFontCache *cache = arg;
+    
+    pthread_mutex_lock(&cache->lock);
+    for (;;) {
+        RasterJob job;
+        while (!cache->shutdown && !queue_pop(&cache->jobs, &job)) {
+            pthread_cond_wait(&cache->wake, &cache->lock);
+        }
+        if (cache->shutdown) break;
+        pthread_mutex_unlock(&cache->lock);
+        
+        job.pixels = calloc((size_t)job.width * job.height, 1);
+        if (job.pixels) {
+            rasterize_glyph(job.info, job.glyph, job.scale,
+                            job.size_key == SDF_SIZE_KEY,
+                            job.width, job.height, job.pixels, job.width);
+        }
+        
+        pthread_mutex_lock(&cache->lock);
+        if (!queue_push(&cache->done, &job)) free(job.pixels);
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return NULL;
+}
+
+/* Drop a pending glyph whose bitmap will never arrive; the next lookup
+ * requests it again. */
+static void drop_pending(MinirendFontCache *cache, CachedGlyph *g) {
+    evict_glyph(cache, (int)(g - cache->glyphs));
+}
+
+/* Copy finished bitmaps into their reserved atlas rects. Results for
+ * glyphs evicted or cleared in the meantime are discarded. */
+static void blit_completed(MinirendFontCache *cache) {
+    pthread_mutex_lock(&cache->lock);
+    RasterQueue done = cache->done;
+    memset(&cache->done, 0, sizeof(cache->done));
+    pthread_mutex_unlock(&cache->lock);
+    
+    RasterJob job;
+    while (queue_pop(&done, &job)) {
+        CachedGlyph *g = find_cached_glyph(cache, job.font_id, job.glyph, job.size_key);
+        if (!g || !g->pending || g->job != job.id) {
+            free(job.pixels);
+            continue;
+        }
+        if (!job.pixels) {
+            drop_pending(cache, g);
+            continue;
+        }
+        
+        AtlasPage *p = &cache->pages[g->page];
+        for (int y = 0; y < job.height; y++) {
+            memcpy(p->data + (g->atlas_y + y) * cache->atlas_size + g->atlas_x,
+                   job.pixels + y * job.width, job.width);
+        }
+        p->dirty = true;
+        g->pending = false;
+        cache->pending_count--;
+        free(job.pixels);
+    }
+    free(done.items);
+}
+
+bool minirend_font_cache_start_workers(MinirendFontCache *cache, int thread_count) {
+    if (!cache || cache->thread_count > 0) return false;
+    
+    if (thread_count <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpus > 1 ? (int)cpus - 1 : 1;
+    }
+    if (thread_count > MAX_RASTER_THREADS) thread_count = MAX_RASTER_THREADS;
+    
+    if (pthread_mutex_init(&cache->lock, NULL) != 0) return false;
+    if (pthread_cond_init(&cache->wake, NULL) != 0) {
+        pthread_mutex_destroy(&cache->lock);
+        return false;
+    }
+    cache->shutdown = false;
+    
+    for (int i = 0; i < thread_count; i++) {
+        if (pthread_create(&cache->threads[i], NULL, raster_worker, cache) != 0) break;
+        cache->thread_count++;
+    }
+    if (cache->thread_count == 0) {
+        pthread_cond_destroy(&cache->wake);
+        pthread_mutex_destroy(&cache->lock);
+        return false;
+    }
+    return true;
+}
+
+void minirend_font_cache_stop_workers(MinirendFontCache *cache) {
+    if (!cache || cache->thread_count == 0) return;
+    
+    pthread_mutex_lock(&cache->lock);
+    cache->shutdown = true;
+    pthread_cond_broadcast(&cache->wake);
+    pthread_mutex_unlock(&cache->lock);
+    
+    for (int i = 0; i < cache->thread_count; i++) {
+        pthread_join(cache->threads[i], NULL);
+    }
+    cache->thread_count = 0;
+    
+    /* Land what finished; glyphs still queued are rasterized on next use */
+    blit_completed(cache);
+    RasterJob job;
+    while (queue_pop(&cache->jobs, &job)) {
+        CachedGlyph *g = find_cached_glyph(cache, job.font_id, job.glyph, job.size_key);
+        if (g && g->pending && g->job == job.id) drop_pending(cache, g);
+    }
+    free(cache->jobs.items);
+    memset(&cache->jobs, 0, sizeof(cache->jobs));
+    
+    pthread_cond_destroy(&cache->wake);
+    pthread_mutex_destroy(&cache->lock);
+}
+
+/* ============================================================================
+ * Glyph Lookup
+ * ============================================================================ */
+
 bool minirend_font_cache_get_glyph(MinirendFontCache *cache,
                                    int font_id, int codepoint,
                                    float font_size,
@@ -302,47 +1234,525 @@ bool minirend_font_cache_get_glyph(MinirendFontCache *cache,
     if (!cache || !out_glyph) return false;
     
     /* Use default font if not specified */
-    if (font_id < 0) font_id = cache->default_font;
-    if (font_id < 0 || font_id >= cache->font_count) return false;
+    font_id = resolve_font(cache, font_id);
+    if (font_id < 0) return false;
+    
+    int glyph = stbtt_FindGlyphIndex(&cache->fonts[font_id].info, codepoint);
+    return minirend_font_cache_get_glyph_by_index(cache, font_id, glyph,
+                                                  font_size, out_glyph);
+}
+
+bool minirend_font_cache_get_glyph_by_index(MinirendFontCache *cache,
+                                            int font_id, int glyph,
+                                            float font_size,
+                                            MinirendGlyph *out_glyph) {
+    if (!cache || !out_glyph) return false;
+    
+    /* Use default font if not specified */
+    font_id = resolve_font(cache, font_id);
+    if (font_id < 0) return false;
     
     /* Find or cache glyph */
-    CachedGlyph *g = find_cached_glyph(cache, font_id, codepoint, font_size);
-    if (!g) {
-        g = cache_glyph(cache, font_id, codepoint, font_size);
+    int size_key = cache->sdf ? SDF_SIZE_KEY : quantize_size(font_size);
+    CachedGlyph *g = find_cached_glyph(cache, font_id, glyph, size_key);
+    if (g) {
+        cache->hits++;
+        g->last_used = cache->frame;
+        if (g->page >= 0) cache->pages[g->page].last_used = cache->frame;
+    } else {
+        cache->misses++;
+        g = cache_glyph(cache, font_id, glyph, size_key);
         if (!g) return false;
     }
     
+    /* Still rasterizing: draw a nearby size scaled to fit, or nothing.
+     * The advance is the real one either way, so text never shifts. */
+    float advance = g->advance;
+    float k = 1.0f;
+    out_glyph->placeholder = g->pending;
+    if (g->pending) {
+        CachedGlyph *fallback = find_fallback_glyph(cache, font_id, glyph, size_key);
+        if (fallback) {
+            cache->fallbacks++;
+            fallback->last_used = cache->frame;
+            cache->pages[fallback->page].last_used = cache->frame;
+            k = g->font_size / fallback->font_size;
+            g = fallback;
+        }
+    }
+    
+    /* Distance fields are scaled from the base size to the requested one */
+    out_glyph->sdf_edge = 0.0f;
+    if (g->size_key == SDF_SIZE_KEY) {
+        k = font_size / g->font_size;
+        advance = g->advance * k;
+        /* Half a screen pixel, in normalized distance units */
+        out_glyph->sdf_edge = 0.5f * (SDF_DIST_SCALE / 255.0f) / k;
+    }
+    
     /* Fill output */
     float inv_size = 1.0f / (float)cache->atlas_size;
     out_glyph->u0 = (float)g->atlas_x * inv_size;
     out_glyph->v0 = (float)g->atlas_y * inv_size;
     out_glyph->u1 = (float)(g->atlas_x + g->atlas_w) * inv_size;
     out_glyph->v1 = (float)(g->atlas_y + g->atlas_h) * inv_size;
-    out_glyph->x_offset = g->x_offset;
-    out_glyph->y_offset = g->y_offset;
-    out_glyph->width = (float)g->atlas_w;
-    out_glyph->height = (float)g->atlas_h;
-    out_glyph->advance = g->advance;
+    out_glyph->x_offset = g->x_offset * k;
+    out_glyph->y_offset = g->y_offset * k;
+    out_glyph->width = (float)g->atlas_w * k;
+    out_glyph->height = (float)g->atlas_h * k;
+    out_glyph->advance = advance;
     out_glyph->font_size = font_size;
+    out_glyph->page = g->pending ? -1 : g->page;
     
     return true;
 }
 
-uint32_t minirend_font_cache_get_texture(MinirendFontCache *cache) {
-    if (!cache) return 0;
+void minirend_font_cache_set_sdf(MinirendFontCache *cache, bool enabled) {
+    if (!cache || cache->sdf == enabled) return;
+    
+    cache->sdf = enabled;
+    minirend_font_cache_clear(cache);
+}
+
+bool minirend_font_cache_is_sdf(const MinirendFontCache *cache) {
+    return cache && cache->sdf;
+}
+
+void minirend_font_cache_end_frame(MinirendFontCache *cache) {
+    if (!cache) return;
+    cache->frame++;
     
-    /* Upload atlas if dirty */
-    if (cache->atlas_dirty) {
-        sg_update_image(cache->atlas_texture, &(sg_image_data){
-            .subimage[0][0] = {
-                .ptr = cache->atlas_data,
-                .size = cache->atlas_size * cache->atlas_size,
-            },
+    /* Start of the next frame: bring in what the workers finished */
+    if (cache->thread_count > 0) blit_completed(cache);
+}
+
+uint32_t minirend_font_cache_get_texture(MinirendFontCache *cache, int page) {
+    if (!cache || page < 0 || page >= cache->page_count) return 0;
+    
+    /* Upload page if dirty, at most once per frame. Only pages that
+     * gained glyphs are re-sent. */
+    AtlasPage *p = &cache->pages[page];
+    if (p->dirty && p->texture.id != SG_INVALID_ID &&
+        p->uploaded_frame != cache->frame) {
+        size_t size = (size_t)cache->atlas_size * cache->atlas_size;
+        sg_update_image(p->texture, &(sg_image_data){
+            .subimage[0][0] = { .ptr = p->data, .size = size },
         });
-        cache->atlas_dirty = false;
+        p->dirty = false;
+        p->uploaded_frame = cache->frame;
+        cache->uploads++;
+        cache->upload_bytes += size;
+    }
+    
+    return p->texture.id;
+}
+
+const uint8_t *minirend_font_cache_get_atlas_data(MinirendFontCache *cache,
+                                                 int page, int *out_size) {
+    if (!cache || page < 0 || page >= cache->page_count) {
+        if (out_size) *out_size = 0;
+        return NULL;
+    }
+    
+    if (out_size) *out_size = cache->atlas_size;
+    return cache->pages[page].data;
+}
+
+/* ============================================================================
+ * Text Shaping
+ * ============================================================================ */
+
+/* Decode one UTF-8 sequence at text[*i], advancing *i. Malformed input
+ * yields U+FFFD and consumes one byte. */
+static int decode_utf8(const char *text, int32_t len, int32_t *i) {
+    const unsigned char *s = (const unsigned char *)text + *i;
+    int32_t left = len - *i;
+    
+    if (s[0] < 0x80) {
+        *i += 1;
+        return s[0];
+    }
+    
+    int need, cp;
+    if ((s[0] & 0xE0) == 0xC0)      { need = 1; cp = s[0] & 0x1F; }
+    else if ((s[0] & 0xF0) == 0xE0) { need = 2; cp = s[0] & 0x0F; }
+    else if ((s[0] & 0xF8) == 0xF0) { need = 3; cp = s[0] & 0x07; }
+    else { *i += 1; return 0xFFFD; }
+    
+    if (left <= need) { *i += 1; return 0xFFFD; }
+    for (int k = 1; k <= need; k++) {
+        if ((s[k] & 0xC0) != 0x80) { *i += 1; return 0xFFFD; }
+        cp = (cp << 6) | (s[k] & 0x3F);
+    }
+    
+    /* Reject overlong forms, surrogates and out-of-range values */
+    static const int min_cp[4] = { 0, 0x80, 0x800, 0x10000 };
+    if (cp < min_cp[need] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        *i += 1;
+        return 0xFFFD;
+    }
+    
+    *i += need + 1;
+    return cp;
+}
+
+/* Fill the dense tables. Returns false if out of memory. */
+static bool build_advance_table(LoadedFont *font) {
+    AdvanceTable *t = &font->advances;
+    t->dense_glyph = malloc(DENSE_CODEPOINTS * sizeof(uint16_t));
+    t->dense_advance = malloc(DENSE_CODEPOINTS * sizeof(int32_t));
+    t->sparse = malloc(SPARSE_INITIAL * sizeof(SparseMetric));
+    if (!t->dense_glyph || !t->dense_advance || !t->sparse) {
+        free(t->dense_glyph);
+        free(t->dense_advance);
+        free(t->sparse);
+        memset(t, 0, sizeof(*t));
+        return false;
+    }
+    
+    for (int cp = 0; cp < DENSE_CODEPOINTS; cp++) {
+        int glyph = stbtt_FindGlyphIndex(&font->info, cp);
+        int advance, lsb;
+        stbtt_GetGlyphHMetrics(&font->info, glyph, &advance, &lsb);
+        t->dense_glyph[cp] = (uint16_t)glyph;
+        t->dense_advance[cp] = advance;
+    }
+    
+    for (int i = 0; i < SPARSE_INITIAL; i++) t->sparse[i].codepoint = -1;
+    t->sparse_mask = SPARSE_INITIAL - 1;
+    t->sparse_count = 0;
+    
+    /* Fonts without kern/GPOS tables skip pair lookups entirely */
+    if (font->info.kern || font->info.gpos) {
+        t->kern = malloc(KERN_COUNT * KERN_COUNT * sizeof(int16_t));
+    }
+    return true;
+}
+
+static uint32_t codepoint_hash(int codepoint) {
+    uint32_t h = (uint32_t)codepoint * 0x9E3779B1u;
+    return h ^ (h >> 16);
+}
+
+static void sparse_insert(AdvanceTable *t, const SparseMetric *m) {
+    uint32_t i = codepoint_hash(m->codepoint) & t->sparse_mask;
+    while (t->sparse[i].codepoint >= 0) i = (i + 1) & t->sparse_mask;
+    t->sparse[i] = *m;
+    t->sparse_count++;
+}
+
+/* Glyph index and advance (font units) of a codepoint */
+static void lookup_advance(LoadedFont *font, int codepoint,
+                           int *out_glyph, int *out_advance) {
+    AdvanceTable *t = &font->advances;
+    if (codepoint >= 0 && codepoint < DENSE_CODEPOINTS) {
+        *out_glyph = t->dense_glyph[codepoint];
+        *out_advance = t->dense_advance[codepoint];
+        return;
+    }
+    
+    uint32_t i = codepoint_hash(codepoint) & t->sparse_mask;
+    while (t->sparse[i].codepoint >= 0) {
+        if (t->sparse[i].codepoint == codepoint) {
+            *out_glyph = t->sparse[i].glyph;
+            *out_advance = t->sparse[i].advance;
+            return;
+        }
+        i = (i + 1) & t->sparse_mask;
+    }
+    
+    int glyph = stbtt_FindGlyphIndex(&font->info, codepoint);
+    int advance, lsb;
+    stbtt_GetGlyphHMetrics(&font->info, glyph, &advance, &lsb);
+    *out_glyph = glyph;
+    *out_advance = advance;
+    
+    /* Keep the table at most half full; without memory, just don't cache */
+    if ((t->sparse_count + 1) * 2 > t->sparse_mask + 1) {
+        uint32_t new_cap = (t->sparse_mask + 1) * 2;
+        SparseMetric *entries = malloc(new_cap * sizeof(SparseMetric));
+        if (!entries) return;
+        
+        SparseMetric *old = t->sparse;
+        uint32_t old_cap = t->sparse_mask + 1;
+        for (uint32_t k = 0; k < new_cap; k++) entries[k].codepoint = -1;
+        t->sparse = entries;
+        t->sparse_mask = new_cap - 1;
+        t->sparse_count = 0;
+        for (uint32_t k = 0; k < old_cap; k++) {
+            if (old[k].codepoint >= 0) sparse_insert(t, &old[k]);
+        }
+        free(old);
+    }
+    sparse_insert(t, &(SparseMetric){ codepoint, glyph, advance });
+}
+
+/* Kerning between two neighbouring glyphs, in font units */
+static int lookup_kern(LoadedFont *font, int left_cp, int left_glyph,
+                       int right_cp, int right_glyph) {
+    AdvanceTable *t = &font->advances;
+    if (!t->kern) {
+        if (!font->info.kern && !font->info.gpos) return 0;
+        return stbtt_GetGlyphKernAdvance(&font->info, left_glyph, right_glyph);
+    }
+    
+    int l = left_cp - KERN_FIRST, r = right_cp - KERN_FIRST;
+    if (l < 0 || l >= KERN_COUNT || r < 0 || r >= KERN_COUNT) {
+        return stbtt_GetGlyphKernAdvance(&font->info, left_glyph, right_glyph);
+    }
+    
+    int16_t *row = t->kern + l * KERN_COUNT;
+    if (!t->kern_row[l]) {
+        for (int k = 0; k < KERN_COUNT; k++) {
+            row[k] = (int16_t)stbtt_GetGlyphKernAdvance(&font->info, left_glyph,
+                                                         t->dense_glyph[KERN_FIRST + k]);
+        }
+        t->kern_row[l] = true;
+    }
+    return row[r];
+}
+
+/* A face ready for shaping: loaded, with its advance tables built */
+static LoadedFont *shaping_face(MinirendFontCache *cache, int font_id) {
+    if (!ensure_face(cache, font_id)) return NULL;
+    
+    LoadedFont *font = &cache->fonts[font_id];
+    if (!font->advances.dense_glyph && !build_advance_table(font)) return NULL;
+    return font;
+}
+
+/* First face in the fallback chain that has the codepoint, or -1. The
+ * answer is cached, so faces are only consulted once per codepoint. */
+static int resolve_fallback(MinirendFontCache *cache, int codepoint) {
+    uint32_t i = 0;
+    if (cache->fallback_faces) {
+        i = codepoint_hash(codepoint) & cache->fallback_mask;
+        while (cache->fallback_faces[i].codepoint >= 0) {
+            if (cache->fallback_faces[i].codepoint == codepoint) {
+                return cache->fallback_faces[i].glyph;
+            }
+            i = (i + 1) & cache->fallback_mask;
+        }
+    }
+    
+    int face = -1;
+    for (int k = 0; k < cache->fallback_count && face < 0; k++) {
+        int id = cache->fallbacks_chain[k];
+        if (ensure_face(cache, id) &&
+            stbtt_FindGlyphIndex(&cache->fonts[id].info, codepoint) != 0) {
+            face = id;
+        }
+    }
+    
+    /* Remember it, growing the table at half load (or rebuilding it
+     * empty: entries are cheap to resolve again) */
+    if (!cache->fallback_faces || (cache->fallback_used + 1) * 2 > cache->fallback_mask + 1) {
+        uint32_t new_cap = cache->fallback_faces ? (cache->fallback_mask + 1) * 2 : SPARSE_INITIAL;
+        SparseMetric *entries = malloc(new_cap * sizeof(SparseMetric));
+        if (!entries) return face;
+        for (uint32_t k = 0; k < new_cap; k++) entries[k].codepoint = -1;
+        
+        SparseMetric *old = cache->fallback_faces;
+        uint32_t old_cap = old ? cache->fallback_mask + 1 : 0;
+        cache->fallback_faces = entries;
+        cache->fallback_mask = new_cap - 1;
+        cache->fallback_used = 0;
+        for (uint32_t k = 0; k < old_cap; k++) {
+            if (old[k].codepoint < 0) continue;
+            uint32_t j = codepoint_hash(old[k].codepoint) & cache->fallback_mask;
+            while (entries[j].codepoint >= 0) j = (j + 1) & cache->fallback_mask;
+            entries[j] = old[k];
+            cache->fallback_used++;
+        }
+        free(old);
+    }
+    
+    i = codepoint_hash(codepoint) & cache->fallback_mask;
+    while (cache->fallback_faces[i].codepoint >= 0) i = (i + 1) & cache->fallback_mask;
+    cache->fallback_faces[i] = (SparseMetric){ codepoint, face, 0 };
+    cache->fallback_used++;
+    return face;
+}
+
+static uint64_t hash_text(const char *text, int32_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int32_t i = 0; i < len; i++) {
+        h ^= (unsigned char)text[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static uint32_t run_hash(uint64_t text_hash, int font_id, float font_size) {
+    uint32_t size_bits;
+    memcpy(&size_bits, &font_size, sizeof(size_bits));
+    uint32_t h = (uint32_t)(text_hash ^ (text_hash >> 32));
+    h ^= size_bits * 0x9E3779B1u + (uint32_t)font_id;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return h;
+}
+
+static void index_run(MinirendFontCache *cache, int run_index) {
+    const ShapedRun *run = &cache->runs[run_index];
+    uint32_t i = run_hash(run->hash, run->font_id, run->font_size) & (RUN_INDEX_SIZE - 1);
+    while (cache->run_index[i] != 0) {
+        i = (i + 1) & (RUN_INDEX_SIZE - 1);
+    }
+    cache->run_index[i] = (uint32_t)run_index + 1;
+}
+
+static ShapedRun *find_run(MinirendFontCache *cache, uint64_t hash, int font_id,
+                           float font_size, const char *text, int32_t len) {
+    uint32_t i = run_hash(hash, font_id, font_size) & (RUN_INDEX_SIZE - 1);
+    for (;;) {
+        uint32_t slot = cache->run_index[i];
+        if (slot == 0) return NULL;
+        
+        ShapedRun *run = &cache->runs[slot - 1];
+        if (run->hash == hash && run->len == len && run->font_id == font_id &&
+            run->font_size == font_size && memcmp(run->text, text, len) == 0) {
+            return run;
+        }
+        i = (i + 1) & (RUN_INDEX_SIZE - 1);
+    }
+}
+
+/* Drop runs not used this frame; if all of them were, drop everything */
+static void evict_runs(MinirendFontCache *cache, bool all) {
+    int kept = 0;
+    for (int i = 0; i < cache->run_count; i++) {
+        ShapedRun *run = &cache->runs[i];
+        if (all || run->last_used < cache->frame) {
+            free(run->glyphs);
+            continue;
+        }
+        if (kept != i) cache->runs[kept] = *run;
+        kept++;
+    }
+    cache->run_count = kept;
+    
+    memset(cache->run_index, 0, sizeof(cache->run_index));
+    for (int i = 0; i < cache->run_count; i++) {
+        index_run(cache, i);
+    }
+}
+
+static ShapedRun *shape_run(MinirendFontCache *cache, uint64_t hash, int font_id,
+                            const char *text, int32_t len, float font_size) {
+    if (cache->run_count >= MAX_SHAPED_RUNS) {
+        evict_runs(cache, false);
+        if (cache->run_count >= MAX_SHAPED_RUNS) evict_runs(cache, true);
+    }
+    
+    /* One block: glyphs (at most one per byte), then the key text */
+    size_t glyph_bytes = (size_t)len * sizeof(MinirendShapedGlyph);
+    MinirendShapedGlyph *glyphs = malloc(glyph_bytes + (size_t)len + 1);
+    if (!glyphs) return NULL;
+    
+    char *copy = (char *)glyphs + glyph_bytes;
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    
+    LoadedFont *font = shaping_face(cache, font_id);
+    if (!font) {
+        free(glyphs);
+        return NULL;
+    }
+    
+    /* Scale per face, computed when a face first appears in the run */
+    float scales[MAX_FONTS] = { 0 };
+    scales[font_id] = stbtt_ScaleForPixelHeight(&font->info, font_size);
+    
+    /* Pen positions from the advance tables, with pair kerning between
+     * neighbouring glyphs of the same face. Codepoints the font lacks
+     * come from the first fallback face that has them. */
+    int count = 0;
+    int prev = 0, prev_cp = 0, prev_face = -1;
+    float pen = 0;
+    for (int32_t i = 0; i < len; ) {
+        int codepoint = (unsigned char)text[i] < 0x80
+            ? (unsigned char)text[i++] : decode_utf8(text, len, &i);
+        int face_id = font_id;
+        LoadedFont *face = font;
+        int glyph, advance;
+        lookup_advance(face, codepoint, &glyph, &advance);
+        
+        if (glyph == 0 && codepoint >= 0x20 && cache->fallback_count > 0) {
+            int fallback = resolve_fallback(cache, codepoint);
+            LoadedFont *f = fallback >= 0 ? shaping_face(cache, fallback) : NULL;
+            if (f) {
+                face_id = fallback;
+                face = f;
+                lookup_advance(face, codepoint, &glyph, &advance);
+                if (scales[face_id] == 0) {
+                    scales[face_id] = stbtt_ScaleForPixelHeight(&face->info, font_size);
+                }
+            }
+        }
+        float scale = scales[face_id];
+        
+        if (prev && prev_face == face_id) {
+            pen += (float)lookup_kern(face, prev_cp, prev, codepoint, glyph) * scale;
+        }
+        
+        glyphs[count].glyph = glyph;
+        glyphs[count].font_id = face_id;
+        glyphs[count].x = pen;
+        count++;
+        
+        pen += (float)advance * scale;
+        prev = glyph;
+        prev_cp = codepoint;
+        prev_face = face_id;
+    }
+    
+    int run_index = cache->run_count++;
+    ShapedRun *run = &cache->runs[run_index];
+    run->hash = hash;
+    run->font_id = font_id;
+    run->font_size = font_size;
+    run->len = len;
+    run->text = copy;
+    run->glyphs = glyphs;
+    run->glyph_count = count;
+    run->width = pen;
+    run->last_used = cache->frame;
+    
+    index_run(cache, run_index);
+    return run;
+}
+
+bool minirend_font_cache_shape(MinirendFontCache *cache,
+                               int font_id,
+                               const char *text, int32_t len,
+                               float font_size,
+                               MinirendShapedRun *out_run) {
+    if (!cache || !text || !out_run) return false;
+    
+    font_id = resolve_font(cache, font_id);
+    if (font_id < 0) return false;
+    
+    if (len < 0) len = (int32_t)strlen(text);
+    
+    uint64_t hash = hash_text(text, len);
+    ShapedRun *run = find_run(cache, hash, font_id, font_size, text, len);
+    if (run) {
+        cache->run_hits++;
+        run->last_used = cache->frame;
+    } else {
+        cache->run_misses++;
+        run = shape_run(cache, hash, font_id, text, len, font_size);
+        if (!run) return false;
     }
     
-    return cache->atlas_texture.id;
+    out_run->glyphs = run->glyphs;
+    out_run->glyph_count = run->glyph_count;
+    out_run->width = run->width;
+    out_run->font_id = font_id;
+    out_run->font_size = font_size;
+    return true;
 }
 
 void minirend_font_cache_measure_text(MinirendFontCache *cache,
@@ -356,27 +1766,18 @@ void minirend_font_cache_measure_text(MinirendFontCache *cache,
         return;
     }
     
-    if (font_id < 0) font_id = cache->default_font;
-    if (font_id < 0 || font_id >= cache->font_count) {
+    font_id = resolve_font(cache, font_id);
+    if (font_id < 0) {
         if (out_width) *out_width = 0;
         if (out_height) *out_height = font_size;
         return;
     }
     
-    LoadedFont *font = &cache->fonts[font_id];
-    float scale = stbtt_ScaleForPixelHeight(&font->info, font_size);
-    
+    /* Shaped once, then shared with drawing through the run cache */
+    MinirendShapedRun run;
     float width = 0;
-    
-    if (len < 0) len = (int32_t)strlen(text);
-    
-    for (int32_t i = 0; i < len; i++) {
-        int codepoint = (unsigned char)text[i];
-        
-        /* Handle UTF-8 (basic single-byte for now) */
-        int advance, lsb;
-        stbtt_GetCodepointHMetrics(&font->info, codepoint, &advance, &lsb);
-        width += (float)advance * scale;
+    if (minirend_font_cache_shape(cache, font_id, text, len, font_size, &run)) {
+        width = run.width;
     }
     
     if (out_width) *out_width = width;
@@ -389,8 +1790,8 @@ void minirend_font_cache_get_metrics(MinirendFontCache *cache,
                                      float *out_line_gap) {
     if (!cache) return;
     
-    if (font_id < 0) font_id = cache->default_font;
-    if (font_id < 0 || font_id >= cache->font_count) return;
+    font_id = resolve_font(cache, font_id);
+    if (font_id < 0) return;
     
     LoadedFont *font = &cache->fonts[font_id];
     float scale = stbtt_ScaleForPixelHeight(&font->info, font_size);
@@ -406,14 +1807,247 @@ void minirend_font_cache_get_metrics(MinirendFontCache *cache,
 void minirend_font_cache_clear(MinirendFontCache *cache) {
     if (!cache) return;
     
-    /* Clear atlas */
-    memset(cache->atlas_data, 0, cache->atlas_size * cache->atlas_size);
-    cache->atlas_x = 0;
-    cache->atlas_y = 0;
-    cache->atlas_row_height = 0;
-    cache->atlas_dirty = true;
+    /* Clear atlas pages (allocated pages are kept for reuse) */
+    for (int i = 0; i < cache->page_count; i++) {
+        reset_page(cache, &cache->pages[i]);
+    }
     
-    /* Clear glyph cache */
+    /* Clear glyph cache (late worker results are discarded by job id) */
     cache->glyph_count = 0;
+    cache->pending_count = 0;
+    memset(cache->index, 0, ((size_t)cache->index_mask + 1) * sizeof(uint32_t));
+    drop_baked_atlas(cache);
+    cache->clears++;
+}
+
+void minirend_font_cache_get_stats(const MinirendFontCache *cache,
+                                   MinirendFontCacheStats *out_stats) {
+    if (!out_stats) return;
+    memset(out_stats, 0, sizeof(*out_stats));
+    if (!cache) return;
+    
+    out_stats->hits = cache->hits;
+    out_stats->misses = cache->misses;
+    out_stats->clears = cache->clears;
+    out_stats->evictions = cache->evictions;
+    out_stats->glyph_count = cache->glyph_count;
+    out_stats->max_glyphs = cache->max_glyphs;
+    out_stats->page_count = cache->page_count;
+    out_stats->page_size = cache->atlas_size;
+    out_stats->uploads = cache->uploads;
+    out_stats->upload_bytes = cache->upload_bytes;
+    out_stats->run_hits = cache->run_hits;
+    out_stats->run_misses = cache->run_misses;
+    out_stats->run_count = cache->run_count;
+    out_stats->async_glyphs = cache->async_glyphs;
+    out_stats->pending_glyphs = cache->pending_count;
+    out_stats->fallbacks = cache->fallbacks;
+    out_stats->prebaked_glyphs = cache->prebaked_glyphs;
+}
+
+
+/* ============================================================================
+ * Prebaked Atlas
+ * ============================================================================ */
+
+static void drop_baked_atlas(MinirendFontCache *cache) {
+    minirend_file_map_close(cache->baked);
+    cache->baked = NULL;
 }
 
+static size_t baked_page_bytes(const MinirendFontCache *cache) {
+    return sizeof(uint32_t) + ((size_t)cache->atlas_size + 1) * sizeof(SkylineNode) +
+           (size_t)cache->atlas_size * cache->atlas_size;
+}
+
+/* The skyline must cover the page left to right with no gaps, or later
+ * packing would run off its end. */
+static bool baked_skyline_valid(const MinirendFontCache *cache,
+                                const SkylineNode *nodes, uint32_t count) {
+    if (count == 0 || count > (uint32_t)cache->atlas_size) return false;
+    
+    int x = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (nodes[i].x != x || nodes[i].width <= 0) return false;
+        if (nodes[i].y < 0 || nodes[i].y > cache->atlas_size) return false;
+        x += nodes[i].width;
+    }
+    return x == cache->atlas_size;
+}
+
+static bool baked_glyph_valid(const MinirendFontCache *cache, const BakedGlyph *b) {
+    if (b->glyph < 0 || (b->size_key <= 0 && b->size_key != SDF_SIZE_KEY)) return false;
+    if (b->page < 0) return b->page == -1;
+    return b->page < (int32_t)cache->baked_header.page_count &&
+           b->x >= 0 && b->y >= 0 && b->w > 0 && b->h > 0 &&
+           b->x + b->w <= cache->atlas_size && b->y + b->h <= cache->atlas_size;
+}
+
+/* Enter the baked glyphs of a newly loaded font into the table. They
+ * start cold, so they are evicted first if the app never draws them. */
+static void adopt_baked_glyphs(MinirendFontCache *cache, int font_id) {
+    if (!cache->baked) return;
+    
+    const BakedHeader *h = &cache->baked_header;
+    const uint8_t *fonts = minirend_file_map_data(cache->baked, NULL) + sizeof(BakedHeader);
+    const uint8_t *records = fonts + (size_t)h->font_count * sizeof(uint64_t);
+    uint64_t fingerprint = cache->fonts[font_id].fingerprint;
+    
+    for (uint32_t f = 0; f < h->font_count; f++) {
+        uint64_t baked_fingerprint;
+        memcpy(&baked_fingerprint, fonts + f * sizeof(uint64_t), sizeof(uint64_t));
+        if (baked_fingerprint != fingerprint) continue;
+        
+        for (uint32_t i = 0; i < h->glyph_count; i++) {
+            if (cache->glyph_count >= cache->max_glyphs) return;
+            
+            BakedGlyph b;
+            memcpy(&b, records + i * sizeof(BakedGlyph), sizeof(BakedGlyph));
+            if (b.font != (int32_t)f || !baked_glyph_valid(cache, &b)) continue;
+            if (find_cached_glyph(cache, font_id, b.glyph, b.size_key)) continue;
+            
+            int glyph_index = cache->glyph_count++;
+            CachedGlyph *g = &cache->glyphs[glyph_index];
+            memset(g, 0, sizeof(*g));
+            g->font_id = font_id;
+            g->glyph = b.glyph;
+            g->font_size = b.font_size;
+            g->size_key = b.size_key;
+            g->page = b.page;
+            g->atlas_x = b.x;
+            g->atlas_y = b.y;
+            g->atlas_w = b.w;
+            g->atlas_h = b.h;
+            g->x_offset = b.x_offset;
+            g->y_offset = b.y_offset;
+            g->advance = b.advance;
+            
+            index_glyph(cache, glyph_index);
+            cache->prebaked_glyphs++;
+        }
+    }
+}
+
+bool minirend_font_cache_load_atlas(MinirendFontCache *cache, const char *path) {
+    if (!cache || !path) return false;
+    
+    MinirendFileMap *map = minirend_file_map_open(path);
+    if (!map) return false;
+    
+    size_t size = 0;
+    const uint8_t *data = minirend_file_map_data(map, &size);
+    
+    BakedHeader h;
+    if (size < sizeof(h)) {
+        minirend_file_map_close(map);
+        return false;
+    }
+    memcpy(&h, data, sizeof(h));
+    
+    /* Baked for this build and page size, and complete */
+    size_t expected = sizeof(h) + (size_t)h.font_count * sizeof(uint64_t) +
+                      (size_t)h.glyph_count * sizeof(BakedGlyph) +
+                      (size_t)h.page_count * baked_page_bytes(cache);
+    if (h.magic != BAKED_MAGIC || h.version != BAKED_VERSION ||
+        h.atlas_size != (uint32_t)cache->atlas_size ||
+        h.page_count == 0 || h.page_count > MAX_ATLAS_PAGES ||
+        h.font_count > MAX_FONTS || h.glyph_count > (uint32_t)cache->max_glyphs * MAX_FONTS ||
+        size != expected) {
+        fprintf(stderr, "[font_cache] Ignoring incompatible atlas %s\n", path);
+        minirend_file_map_close(map);
+        return false;
+    }
+    
+    /* Replace the cache contents with the baked pages */
+    minirend_font_cache_clear(cache);
+    
+    const uint8_t *p = data + expected - (size_t)h.page_count * baked_page_bytes(cache);
+    size_t skyline_bytes = ((size_t)cache->atlas_size + 1) * sizeof(SkylineNode);
+    size_t pixel_bytes = (size_t)cache->atlas_size * cache->atlas_size;
+    for (uint32_t i = 0; i < h.page_count; i++, p += baked_page_bytes(cache)) {
+        if ((int)i >= cache->page_count && !add_page(cache, MAX_ATLAS_PAGES)) break;
+        
+        uint32_t count;
+        memcpy(&count, p, sizeof(count));
+        AtlasPage *page = &cache->pages[i];
+        memcpy(page->skyline, p + sizeof(count), skyline_bytes);
+        memcpy(page->data, p + sizeof(count) + skyline_bytes, pixel_bytes);
+        page->skyline_count = (int)count;
+        page->dirty = true;
+        
+        if (!baked_skyline_valid(cache, page->skyline, count)) {
+            fprintf(stderr, "[font_cache] Corrupt atlas %s\n", path);
+            minirend_file_map_close(map);
+            minirend_font_cache_clear(cache);
+            return false;
+        }
+    }
+    if (cache->page_count < (int)h.page_count) {
+        minirend_file_map_close(map);
+        minirend_font_cache_clear(cache);
+        return false;
+    }
+    
+    cache->baked = map;
+    cache->baked_header = h;
+    for (int i = 0; i < cache->font_count; i++) {
+        if (cache->fonts[i].loaded) adopt_baked_glyphs(cache, i);
+    }
+    return true;
+}
+
+bool minirend_font_cache_save_atlas(MinirendFontCache *cache, const char *path) {
+    if (!cache || !path) return false;
+    
+    /* Bitmaps still with a worker would be saved blank */
+    if (cache->pending_count > 0) return false;
+    
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    
+    BakedHeader h = {
+        .magic = BAKED_MAGIC,
+        .version = BAKED_VERSION,
+        .atlas_size = (uint32_t)cache->atlas_size,
+        .page_count = (uint32_t)cache->page_count,
+        .font_count = (uint32_t)cache->font_count,
+        .glyph_count = (uint32_t)cache->glyph_count,
+    };
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    
+    for (int i = 0; i < cache->font_count && ok; i++) {
+        ok = fwrite(&cache->fonts[i].fingerprint, sizeof(uint64_t), 1, f) == 1;
+    }
+    
+    for (int i = 0; i < cache->glyph_count && ok; i++) {
+        const CachedGlyph *g = &cache->glyphs[i];
+        BakedGlyph b = {
+            .font = g->font_id,
+            .glyph = g->glyph,
+            .size_key = g->size_key,
+            .page = g->page,
+            .x = g->atlas_x,
+            .y = g->atlas_y,
+            .w = g->atlas_w,
+            .h = g->atlas_h,
+            .font_size = g->font_size,
+            .x_offset = g->x_offset,
+            .y_offset = g->y_offset,
+            .advance = g->advance,
+        };
+        ok = fwrite(&b, sizeof(b), 1, f) == 1;
+    }
+    
+    size_t skyline_count = (size_t)cache->atlas_size + 1;
+    size_t pixel_bytes = (size_t)cache->atlas_size * cache->atlas_size;
+    for (int i = 0; i < cache->page_count && ok; i++) {
+        const AtlasPage *page = &cache->pages[i];
+        uint32_t count = (uint32_t)page->skyline_count;
+        ok = fwrite(&count, sizeof(count), 1, f) == 1 &&
+             fwrite(page->skyline, sizeof(SkylineNode), skyline_count, f) == skyline_count &&
+             fwrite(page->data, 1, pixel_bytes, f) == pixel_bytes;
+    }
+    
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
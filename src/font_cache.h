@@ -5,10 +5,18 @@
  * Font Cache - Glyph atlas management using stb_truetype.
  *
  * This module:
- * - Loads TTF/OTF fonts
- * - Rasterizes glyphs on demand
- * - Manages glyph atlas textures
- * - Provides text measurement
+ * - Loads TTF/OTF fonts, eagerly or as lazily mapped faces of families
+ *   with several weights and styles, plus a fallback chain for
+ *   codepoints a font lacks
+ * - Rasterizes glyphs on demand, as coverage bitmaps per size or as
+ *   signed distance fields shared by all sizes, optionally on worker
+ *   threads
+ * - Packs glyphs into atlas pages (skyline), evicting least recently used
+ *   glyphs once all pages are full
+ * - Shapes UTF-8 text into cached glyph runs (advances + kerning) used
+ *   by both measurement and drawing
+ * - Saves and loads prebaked atlases, so an app's glyphs can be
+ *   rasterized at build time
  */
 
 #include <stddef.h>
@@ -38,20 +46,84 @@ typedef struct {
     /* Font size this glyph was rendered at */
     float font_size;
     
+    /* Atlas page holding the bitmap (-1 if the glyph has no pixels) */
+    int page;
+    
+    /* Bitmap still being rasterized: drawn from another size (scaled) or,
+     * with page -1, not drawn at all. Repaint later to get the real one. */
+    bool placeholder;
+    
+    /* Distance fields: half a pixel of edge in atlas value units (0-1),
+     * used as the smoothing width. 0 for coverage bitmaps. */
+    float sdf_edge;
+    
 } MinirendGlyph;
 
+/* A glyph in a shaped run */
+typedef struct {
+    int   glyph;        /* Font glyph index (see get_glyph_by_index) */
+    int   font_id;      /* Face the glyph is from (a fallback face for
+                         * codepoints the run's font lacks) */
+    float x;            /* Pen position from the run origin, kerning applied */
+} MinirendShapedGlyph;
+
+/* Shaped text. glyphs is owned by the cache. */
+typedef struct {
+    const MinirendShapedGlyph *glyphs;
+    int   glyph_count;
+    float width;        /* Total advance */
+    int   font_id;      /* Resolved primary font (never -1) */
+    float font_size;
+} MinirendShapedRun;
+
+/* Glyph cache statistics */
+typedef struct {
+    uint64_t hits;          /* Lookups served from the cache */
+    uint64_t misses;        /* Lookups that had to rasterize a glyph */
+    uint64_t clears;        /* Explicit minirend_font_cache_clear() calls */
+    uint64_t evictions;     /* Cold glyphs evicted to make room */
+    int      glyph_count;   /* Glyphs currently cached */
+    int      max_glyphs;
+    int      page_count;    /* Atlas pages allocated */
+    int      page_size;     /* Width/height of each page */
+    uint64_t uploads;       /* Page texture uploads */
+    uint64_t upload_bytes;  /* Bytes sent by those uploads */
+    uint64_t run_hits;      /* Shaped runs served from the cache */
+    uint64_t run_misses;    /* Runs that had to be shaped */
+    int      run_count;     /* Runs currently cached */
+    uint64_t async_glyphs;  /* Glyphs handed to worker threads */
+    int      pending_glyphs; /* Waiting for a worker or a blit */
+    uint64_t fallbacks;     /* Lookups drawn with another size meanwhile */
+    uint64_t prebaked_glyphs; /* Glyphs taken from a prebaked atlas */
+} MinirendFontCacheStats;
+
 /* ============================================================================
  * Font Cache API
  * ============================================================================ */
 
-/* Create the font cache. Must be called after sokol_gfx is initialized.
- * atlas_size is the texture atlas dimension (e.g., 512 or 1024).
- * max_glyphs is the maximum number of cached glyphs. */
+/* Create the font cache. Call after sokol_gfx is initialized; without a
+ * graphics context the atlas only lives on the CPU (headless rendering).
+ * atlas_size is the dimension of each atlas page (e.g., 256 or 512); pages
+ * are uploaded independently, so smaller pages mean cheaper uploads.
+ * max_glyphs is the maximum number of cached glyphs.
+ * If the app ships a prebaked atlas (app/font_atlas.bin), it is loaded
+ * here; see minirend_font_cache_load_atlas(). */
 MinirendFontCache *minirend_font_cache_create(int atlas_size, int max_glyphs);
 
 /* Destroy the font cache and free resources. */
 void minirend_font_cache_destroy(MinirendFontCache *cache);
 
+/* Rasterize new glyphs on background threads (thread_count <= 0 picks
+ * one less than the CPU count, at most 4). Until a bitmap arrives, the
+ * glyph is drawn from a nearby cached size, or skipped; its advance is
+ * always exact. Finished bitmaps are copied into the atlas by
+ * minirend_font_cache_end_frame(). Returns false if no thread started. */
+bool minirend_font_cache_start_workers(MinirendFontCache *cache, int thread_count);
+
+/* Stop the worker threads; later glyphs are rasterized inline again.
+ * Called by minirend_font_cache_destroy(). */
+void minirend_font_cache_stop_workers(MinirendFontCache *cache);
+
 /* Load a font from file. Returns font_id or -1 on failure. */
 int minirend_font_cache_load_font(MinirendFontCache *cache, const char *path);
 
@@ -63,19 +135,79 @@ int minirend_font_cache_load_font_memory(MinirendFontCache *cache,
 /* Set the default font to use when no font_id is specified. */
 void minirend_font_cache_set_default_font(MinirendFontCache *cache, int font_id);
 
-/* Get a glyph, rasterizing it if necessary.
+/* Register a face of a font family (weight 100-900) without loading it.
+ * The file is mapped the first time text needs the face. family may be
+ * NULL for fallback faces, or to add a weight or style to a default
+ * font that came from load_font. Returns font_id or -1. */
+int minirend_font_cache_register_face(MinirendFontCache *cache,
+                                      const char *family, const char *path,
+                                      int weight, bool italic);
+
+/* Pick the face of a family closest to weight and style, following CSS
+ * font matching (bold falls back to heavier weights first, light to
+ * lighter ones). family NULL means the default font's family. Returns
+ * the default font if the family has no faces. */
+int minirend_font_cache_match_face(MinirendFontCache *cache, const char *family,
+                                   int weight, bool italic);
+
+/* Append a face to the fallback chain. Codepoints missing from the font
+ * being shaped are taken from the first face in the chain that has them;
+ * the resolved face is cached per codepoint. */
+bool minirend_font_cache_add_fallback(MinirendFontCache *cache, int font_id);
+
+/* Get a glyph, rasterizing it if necessary. Lookups are O(1), keyed by
+ * font, codepoint and font_size rounded to half a pixel.
  * Returns false if glyph could not be retrieved. */
 bool minirend_font_cache_get_glyph(MinirendFontCache *cache,
                                    int font_id, int codepoint,
                                    float font_size,
                                    MinirendGlyph *out_glyph);
 
-/* Get the texture handle for the glyph atlas.
- * Returns a sokol_gfx sg_image handle. */
-uint32_t minirend_font_cache_get_texture(MinirendFontCache *cache);
-
-/* Measure text dimensions without rendering.
- * Returns width in out_width, height in out_height. */
+/* Switch between coverage bitmaps (default) and signed distance fields.
+ * In SDF mode each glyph is rasterized once and scaled to every size;
+ * draw with a shader that thresholds at 0.5 (see MinirendGlyph.sdf_edge).
+ * Changing the mode clears the cache, so call it between frames. */
+void minirend_font_cache_set_sdf(MinirendFontCache *cache, bool enabled);
+
+/* Check whether the cache produces distance fields. */
+bool minirend_font_cache_is_sdf(const MinirendFontCache *cache);
+
+/* Get a glyph by font glyph index (as found in shaped runs). */
+bool minirend_font_cache_get_glyph_by_index(MinirendFontCache *cache,
+                                            int font_id, int glyph,
+                                            float font_size,
+                                            MinirendGlyph *out_glyph);
+
+/* Shape UTF-8 text (len < 0 = NUL-terminated): decode codepoints, map
+ * them to glyphs and position them with advances and kerning. Runs are
+ * cached by (text, font, size), so layout measurement and drawing of the
+ * same string shape it once. out_run->glyphs stays valid until the next
+ * call to this function. */
+bool minirend_font_cache_shape(MinirendFontCache *cache,
+                               int font_id,
+                               const char *text, int32_t len,
+                               float font_size,
+                               MinirendShapedRun *out_run);
+
+/* Mark the end of a frame. Glyphs looked up since the previous call stay
+ * resident until then; older ones become candidates for eviction.
+ * Bitmaps finished by worker threads are copied into the atlas here. */
+void minirend_font_cache_end_frame(MinirendFontCache *cache);
+
+/* Get the texture handle for an atlas page, uploading it if it changed.
+ * A page is uploaded at most once per frame; glyphs added afterwards are
+ * placed on other pages. Returns a sokol_gfx sg_image handle. */
+uint32_t minirend_font_cache_get_texture(MinirendFontCache *cache, int page);
+
+/* Get the CPU copy of an atlas page (R8, size x size), e.g. for the
+ * software rasterizer. Valid until the page is evicted. */
+const uint8_t *minirend_font_cache_get_atlas_data(MinirendFontCache *cache,
+                                                 int page, int *out_size);
+
+/* Measure text dimensions without rendering (shapes through the run
+ * cache; advances and kerning come from per-font tables, so a miss costs
+ * a table lookup per character). Returns width in out_width, height in
+ * out_height. */
 void minirend_font_cache_measure_text(MinirendFontCache *cache,
                                       int font_id,
                                       const char *text, int32_t len,
@@ -88,8 +220,24 @@ void minirend_font_cache_get_metrics(MinirendFontCache *cache,
                                      float *out_ascent, float *out_descent,
                                      float *out_line_gap);
 
-/* Clear all cached glyphs (useful if atlas is full). */
+/* Clear all cached glyphs. Glyphs already batched become invalid. */
 void minirend_font_cache_clear(MinirendFontCache *cache);
 
+/* Write the atlas pages and glyph table to a file, so a later run can
+ * start with these glyphs already rasterized. Fails while worker threads
+ * still have bitmaps pending. */
+bool minirend_font_cache_save_atlas(MinirendFontCache *cache, const char *path);
+
+/* Replace the cache contents with an atlas written by
+ * minirend_font_cache_save_atlas() with the same page size. Glyphs are
+ * matched to fonts by content, not font_id: each font's glyphs become
+ * available when that font is loaded (before or after this call).
+ * Returns false if the file is missing or incompatible. */
+bool minirend_font_cache_load_atlas(MinirendFontCache *cache, const char *path);
+
+/* Get glyph cache statistics. */
+void minirend_font_cache_get_stats(const MinirendFontCache *cache,
+                                   MinirendFontCacheStats *out_stats);
+
 #endif /* MINIREND_FONT_CACHE_H */
 
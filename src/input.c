@@ -1,11 +1,13 @@
 #include "input.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
 #include "ui_tree.h"
 #include "dom_runtime.h"
+#include "dom_event_types.h"
 
 typedef enum {
     INEV_NONE = 0,
@@ -34,10 +36,18 @@ typedef struct {
     uint32_t time_ms;
 } InputEvent;
 
-enum { INPUT_QUEUE_CAP = 256 };
-static InputEvent g_q[INPUT_QUEUE_CAP];
+/* Grows rather than overwrite: only moves may be lost, and only when
+ * memory runs out. */
+enum { INPUT_QUEUE_CAP = 256 }; /* initial capacity */
+static InputEvent *g_q = NULL;
+static int g_q_cap = 0;
 static int g_q_head = 0;
-static int g_q_tail = 0;
+static int g_q_len = 0;
+
+/* Raw moves since the last dispatched pointermove, oldest first. */
+static InputEvent *g_moves = NULL;
+static int g_moves_len = 0;
+static int g_moves_cap = 0;
 
 static int g_viewport_w = 0;
 static int g_viewport_h = 0;
@@ -59,22 +69,51 @@ static uint32_t get_ticks_ms(void) {
     return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 }
 
-static bool q_empty(void) { return g_q_head == g_q_tail; }
-static bool q_full(void) { return ((g_q_tail + 1) % INPUT_QUEUE_CAP) == g_q_head; }
+static bool q_grow(void) {
+    int new_cap = g_q_cap ? (g_q_cap * 2) : INPUT_QUEUE_CAP;
+    InputEvent *nq = (InputEvent *)malloc((size_t)new_cap * sizeof(InputEvent));
+    if (!nq) return false;
+    for (int i = 0; i < g_q_len; i++) {
+        nq[i] = g_q[(g_q_head + i) % g_q_cap];
+    }
+    free(g_q);
+    g_q = nq;
+    g_q_cap = new_cap;
+    g_q_head = 0;
+    return true;
+}
+
+/* Out of memory: give up the oldest queued move (a later sample
+ * supersedes it). False if there is none. */
+static bool q_drop_move(void) {
+    for (int i = 0; i < g_q_len; i++) {
+        if (g_q[(g_q_head + i) % g_q_cap].type != INEV_MOUSE_MOVE) continue;
+        for (int j = i; j > 0; j--) {
+            g_q[(g_q_head + j) % g_q_cap] = g_q[(g_q_head + j - 1) % g_q_cap];
+        }
+        g_q_head = (g_q_head + 1) % g_q_cap;
+        g_q_len--;
+        return true;
+    }
+    return false;
+}
 
 static void q_push(InputEvent ev) {
-    if (q_full()) {
-        /* Drop oldest. */
-        g_q_head = (g_q_head + 1) % INPUT_QUEUE_CAP;
+    if (g_q_len == g_q_cap && !q_grow()) {
+        if (ev.type == INEV_MOUSE_MOVE || !q_drop_move()) {
+            fprintf(stderr, "[input] Out of memory, dropping event %d\n", (int)ev.type);
+            return;
+        }
     }
-    g_q[g_q_tail] = ev;
-    g_q_tail = (g_q_tail + 1) % INPUT_QUEUE_CAP;
+    g_q[(g_q_head + g_q_len) % g_q_cap] = ev;
+    g_q_len++;
 }
 
 static bool q_pop(InputEvent *out) {
-    if (q_empty()) return false;
+    if (g_q_len == 0) return false;
     *out = g_q[g_q_head];
-    g_q_head = (g_q_head + 1) % INPUT_QUEUE_CAP;
+    g_q_head = (g_q_head + 1) % g_q_cap;
+    g_q_len--;
     return true;
 }
 
@@ -101,41 +140,93 @@ static uint32_t dom_buttons_bit_from_sapp(int mouse_button) {
     }
 }
 
-static JSValue make_base_event(JSContext *ctx, const char *type, bool bubbles, bool cancelable, uint32_t time_ms) {
-    JSValue ev = JS_NewObject(ctx);
-    JS_SetPropertyStr(ctx, ev, "type", JS_NewString(ctx, type));
-    JS_SetPropertyStr(ctx, ev, "bubbles", JS_NewBool(ctx, bubbles));
-    JS_SetPropertyStr(ctx, ev, "cancelable", JS_NewBool(ctx, cancelable));
-    JS_SetPropertyStr(ctx, ev, "timeStamp", JS_NewInt32(ctx, (int32_t)time_ms));
+typedef enum {
+    EVT_POINTERDOWN,
+    EVT_POINTERUP,
+    EVT_POINTERMOVE,
+    EVT_MOUSEDOWN,
+    EVT_MOUSEUP,
+    EVT_MOUSEMOVE,
+    EVT_CLICK,
+    EVT_CONTEXTMENU,
+    EVT_WHEEL,
+    EVT_KEYDOWN,
+    EVT_KEYUP,
+    EVT_TEXTINPUT,
+    EVT_FOCUS,
+    EVT_BLUR,
+    EVT_COUNT
+} EventName;
+
+static const struct {
+    const char       *type;
+    MinirendEventKind kind;
+    bool              bubbles; /* and cancelable */
+} k_event_types[EVT_COUNT] = {
+    [EVT_POINTERDOWN] = { "pointerdown", MINIREND_EVENT_POINTER,  true },
+    [EVT_POINTERUP]   = { "pointerup",   MINIREND_EVENT_POINTER,  true },
+    [EVT_POINTERMOVE] = { "pointermove", MINIREND_EVENT_POINTER,  true },
+    [EVT_MOUSEDOWN]   = { "mousedown",   MINIREND_EVENT_MOUSE,    true },
+    [EVT_MOUSEUP]     = { "mouseup",     MINIREND_EVENT_MOUSE,    true },
+    [EVT_MOUSEMOVE]   = { "mousemove",   MINIREND_EVENT_MOUSE,    true },
+    [EVT_CLICK]       = { "click",       MINIREND_EVENT_MOUSE,    true },
+    [EVT_CONTEXTMENU] = { "contextmenu", MINIREND_EVENT_MOUSE,    true },
+    [EVT_WHEEL]       = { "wheel",       MINIREND_EVENT_WHEEL,    true },
+    [EVT_KEYDOWN]     = { "keydown",     MINIREND_EVENT_KEYBOARD, true },
+    [EVT_KEYUP]       = { "keyup",       MINIREND_EVENT_KEYBOARD, true },
+    [EVT_TEXTINPUT]   = { "textinput",   MINIREND_EVENT_TEXT,     true },
+    [EVT_FOCUS]       = { "focus",       MINIREND_EVENT_FOCUS,    false },
+    [EVT_BLUR]        = { "blur",        MINIREND_EVENT_FOCUS,    false },
+};
+
+static JSAtom g_event_atoms[EVT_COUNT];
+
+/* A native event (see dom_event_types); undefined if it can't be made,
+ * which dispatch ignores. */
+static JSValue make_event(JSContext *ctx, EventName name, uint32_t time_ms, MinirendDomEvent **out) {
+    JSValue ev = minirend_dom_event_new(ctx, k_event_types[name].kind, g_event_atoms[name],
+                                        k_event_types[name].bubbles, k_event_types[name].bubbles,
+                                        time_ms, out);
+    if (JS_IsException(ev)) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        return JS_UNDEFINED;
+    }
     return ev;
 }
 
-static JSValue make_pointer_like(JSContext *ctx, const char *type, float x_css, float y_css, int button, uint32_t buttons, uint32_t mods, uint32_t time_ms) {
-    JSValue ev = make_base_event(ctx, type, true, true, time_ms);
-    JS_SetPropertyStr(ctx, ev, "clientX", JS_NewFloat64(ctx, (double)x_css));
-    JS_SetPropertyStr(ctx, ev, "clientY", JS_NewFloat64(ctx, (double)y_css));
-    JS_SetPropertyStr(ctx, ev, "button", JS_NewInt32(ctx, button));
-    JS_SetPropertyStr(ctx, ev, "buttons", JS_NewInt32(ctx, (int32_t)buttons));
-    JS_SetPropertyStr(ctx, ev, "altKey", JS_NewBool(ctx, mod_alt(mods)));
-    JS_SetPropertyStr(ctx, ev, "ctrlKey", JS_NewBool(ctx, mod_ctrl(mods)));
-    JS_SetPropertyStr(ctx, ev, "shiftKey", JS_NewBool(ctx, mod_shift(mods)));
-    JS_SetPropertyStr(ctx, ev, "metaKey", JS_NewBool(ctx, mod_super(mods)));
-    /* PointerEvent-ish */
-    JS_SetPropertyStr(ctx, ev, "pointerId", JS_NewInt32(ctx, 1));
-    JS_SetPropertyStr(ctx, ev, "isPrimary", JS_NewBool(ctx, true));
+static void set_modifiers(MinirendDomEvent *e, uint32_t mods) {
+    e->alt_key = mod_alt(mods);
+    e->ctrl_key = mod_ctrl(mods);
+    e->shift_key = mod_shift(mods);
+    e->meta_key = mod_super(mods);
+}
+
+static JSValue make_pointer_like(JSContext *ctx, EventName name, float x_css, float y_css, int button, uint32_t buttons, uint32_t mods, uint32_t time_ms) {
+    MinirendDomEvent *e;
+    JSValue ev = make_event(ctx, name, time_ms, &e);
+    if (!e) return ev;
+    e->client_x = x_css;
+    e->client_y = y_css;
+    e->button = button;
+    e->buttons = buttons;
+    set_modifiers(e, mods);
+    if (e->kind == MINIREND_EVENT_POINTER) {
+        e->pointer_id = 1;
+        e->is_primary = true;
+    }
     return ev;
 }
 
 static JSValue make_wheel(JSContext *ctx, float x_css, float y_css, float dx, float dy, uint32_t mods, uint32_t time_ms) {
-    JSValue ev = make_base_event(ctx, "wheel", true, true, time_ms);
-    JS_SetPropertyStr(ctx, ev, "clientX", JS_NewFloat64(ctx, (double)x_css));
-    JS_SetPropertyStr(ctx, ev, "clientY", JS_NewFloat64(ctx, (double)y_css));
-    JS_SetPropertyStr(ctx, ev, "deltaX", JS_NewFloat64(ctx, (double)dx));
-    JS_SetPropertyStr(ctx, ev, "deltaY", JS_NewFloat64(ctx, (double)dy));
-    JS_SetPropertyStr(ctx, ev, "altKey", JS_NewBool(ctx, mod_alt(mods)));
-    JS_SetPropertyStr(ctx, ev, "ctrlKey", JS_NewBool(ctx, mod_ctrl(mods)));
-    JS_SetPropertyStr(ctx, ev, "shiftKey", JS_NewBool(ctx, mod_shift(mods)));
-    JS_SetPropertyStr(ctx, ev, "metaKey", JS_NewBool(ctx, mod_super(mods)));
+    MinirendDomEvent *e;
+    JSValue ev = make_event(ctx, EVT_WHEEL, time_ms, &e);
+    if (!e) return ev;
+    e->client_x = x_css;
+    e->client_y = y_css;
+    e->buttons = g_buttons_mask;
+    e->delta_x = dx;
+    e->delta_y = dy;
+    set_modifiers(e, mods);
     return ev;
 }
 
@@ -169,11 +260,13 @@ static void set_focus(JSContext *ctx, int32_t node_id) {
 
     /* blur prev, focus new */
     if (prev > 0) {
-        JSValue blur = make_base_event(ctx, "blur", false, false, get_ticks_ms());
+        MinirendDomEvent *e;
+        JSValue blur = make_event(ctx, EVT_BLUR, get_ticks_ms(), &e);
         minirend_dom_dispatch_event(ctx, prev, blur);
     }
     {
-        JSValue focus = make_base_event(ctx, "focus", false, false, get_ticks_ms());
+        MinirendDomEvent *e;
+        JSValue focus = make_event(ctx, EVT_FOCUS, get_ticks_ms(), &e);
         minirend_dom_dispatch_event(ctx, g_active_node, focus);
     }
 }
@@ -212,7 +305,8 @@ static JSValue js_native_release_pointer_capture(JSContext *ctx, JSValueConst th
 }
 
 void minirend_input_init(JSContext *ctx) {
-    g_q_head = g_q_tail = 0;
+    g_q_head = g_q_len = 0;
+    g_moves_len = 0;
     g_viewport_w = 0;
     g_viewport_h = 0;
     g_dpi_scale = 1.0f;
@@ -223,6 +317,10 @@ void minirend_input_init(JSContext *ctx) {
     g_last_down_time = 0;
     g_last_down_x = g_last_down_y = 0;
 
+    for (int i = 0; i < EVT_COUNT; i++) {
+        g_event_atoms[i] = JS_NewAtom(ctx, k_event_types[i].type);
+    }
+
     /* Install native hooks used by the JS bootstrap prototype. */
     JSValue global = JS_GetGlobalObject(ctx);
     JS_SetPropertyStr(ctx, global, "__minirendNativeFocus",
@@ -240,7 +338,17 @@ void minirend_input_init(JSContext *ctx) {
 }
 
 void minirend_input_shutdown(JSContext *ctx) {
-    (void)ctx;
+    free(g_q);
+    g_q = NULL;
+    g_q_cap = g_q_head = g_q_len = 0;
+    free(g_moves);
+    g_moves = NULL;
+    g_moves_cap = g_moves_len = 0;
+
+    for (int i = 0; i < EVT_COUNT; i++) {
+        JS_FreeAtom(ctx, g_event_atoms[i]);
+        g_event_atoms[i] = JS_ATOM_NULL;
+    }
 }
 
 void minirend_input_push_sapp_event(const sapp_event *ev) {
@@ -308,14 +416,14 @@ static int32_t hit_target(float x_css, float y_css) {
     return minirend_ui_hit_test(x_css, y_css);
 }
 
-static void dispatch_key(JSContext *ctx, const char *type, uint32_t key_code, uint32_t mods) {
+static void dispatch_key(JSContext *ctx, EventName name, uint32_t key_code, uint32_t mods) {
     int32_t target = g_active_node > 0 ? g_active_node : MINIREND_NODE_BODY;
-    JSValue ev = make_base_event(ctx, type, true, true, get_ticks_ms());
-    JS_SetPropertyStr(ctx, ev, "keyCode", JS_NewInt32(ctx, (int32_t)key_code));
-    JS_SetPropertyStr(ctx, ev, "altKey", JS_NewBool(ctx, mod_alt(mods)));
-    JS_SetPropertyStr(ctx, ev, "ctrlKey", JS_NewBool(ctx, mod_ctrl(mods)));
-    JS_SetPropertyStr(ctx, ev, "shiftKey", JS_NewBool(ctx, mod_shift(mods)));
-    JS_SetPropertyStr(ctx, ev, "metaKey", JS_NewBool(ctx, mod_super(mods)));
+    MinirendDomEvent *e;
+    JSValue ev = make_event(ctx, name, get_ticks_ms(), &e);
+    if (e) {
+        e->key_code = key_code;
+        set_modifiers(e, mods);
+    }
     minirend_dom_dispatch_event(ctx, target, ev);
 }
 
@@ -323,16 +431,77 @@ static void dispatch_text(JSContext *ctx, uint32_t codepoint) {
     int32_t target = g_active_node > 0 ? g_active_node : MINIREND_NODE_BODY;
     char buf[8];
     utf8_from_codepoint(codepoint, buf);
-    JSValue ev = make_base_event(ctx, "textinput", true, true, get_ticks_ms());
-    JS_SetPropertyStr(ctx, ev, "data", JS_NewString(ctx, buf));
+    MinirendDomEvent *e;
+    JSValue ev = make_event(ctx, EVT_TEXTINPUT, get_ticks_ms(), &e);
+    if (e) e->data = JS_NewString(ctx, buf);
     minirend_dom_dispatch_event(ctx, target, ev);
 }
 
+static void hold_move(const InputEvent *ev) {
+    if (g_moves_len == g_moves_cap) {
+        int new_cap = g_moves_cap ? (g_moves_cap * 2) : 32;
+        InputEvent *nm = (InputEvent *)realloc(g_moves, (size_t)new_cap * sizeof(InputEvent));
+        if (!nm) {
+            /* Keep the latest position at least. */
+            if (g_moves_len > 0) g_moves[g_moves_len - 1] = *ev;
+            return;
+        }
+        g_moves = nm;
+        g_moves_cap = new_cap;
+    }
+    g_moves[g_moves_len++] = *ev;
+}
+
+/* Delivers the held moves as one pointermove at the latest position,
+ * every sample reachable through getCoalescedEvents(), plus one
+ * mousemove. */
+static void flush_moves(JSContext *ctx) {
+    if (g_moves_len == 0) return;
+    int n = g_moves_len;
+    const InputEvent *last = &g_moves[n - 1];
+    float x_css = last->x / g_dpi_scale;
+    float y_css = last->y / g_dpi_scale;
+    int32_t target = hit_target(x_css, y_css);
+    g_moves_len = 0;
+
+    /* Moves come in storms; only build events someone listens for. */
+    if (minirend_dom_wants_event(ctx, target, "pointermove")) {
+        JSValue pmove = make_pointer_like(ctx, EVT_POINTERMOVE, x_css, y_css, 0, g_buttons_mask, last->modifiers, last->time_ms);
+        MinirendDomEvent *e = minirend_dom_event_get(pmove);
+        for (int i = 0; e && i < n; i++) {
+            const InputEvent *m = &g_moves[i];
+            MinirendPointerSample sample = {
+                .client_x = m->x / g_dpi_scale,
+                .client_y = m->y / g_dpi_scale,
+                .buttons = g_buttons_mask,
+                .time_ms = m->time_ms,
+                .alt_key = mod_alt(m->modifiers),
+                .ctrl_key = mod_ctrl(m->modifiers),
+                .shift_key = mod_shift(m->modifiers),
+                .meta_key = mod_super(m->modifiers),
+            };
+            minirend_dom_event_add_sample(e, &sample);
+        }
+        minirend_dom_dispatch_event(ctx, target, pmove);
+    }
+    if (minirend_dom_wants_event(ctx, target, "mousemove")) {
+        JSValue mmove = make_pointer_like(ctx, EVT_MOUSEMOVE, x_css, y_css, 0, g_buttons_mask, last->modifiers, last->time_ms);
+        minirend_dom_dispatch_event(ctx, target, mmove);
+    }
+}
+
 void minirend_input_tick(JSContext *ctx) {
     update_viewport_from_sokol();
 
     InputEvent ev;
     while (q_pop(&ev)) {
+        if (ev.type == INEV_MOUSE_MOVE) {
+            hold_move(&ev);
+            continue;
+        }
+        /* Anything else is delivered after the moves that preceded it. */
+        flush_moves(ctx);
+
         if (ev.type == INEV_RESIZE) {
             /* Track viewport in CSS pixels (best-effort). */
             g_viewport_w = ev.window_w;
@@ -358,9 +527,9 @@ void minirend_input_tick(JSContext *ctx) {
                 /* Default focus action: focus on pointerdown. */
                 set_focus(ctx, target);
 
-                JSValue pdown = make_pointer_like(ctx, "pointerdown", x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
+                JSValue pdown = make_pointer_like(ctx, EVT_POINTERDOWN, x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
                 minirend_dom_dispatch_event(ctx, target, pdown);
-                JSValue mdown = make_pointer_like(ctx, "mousedown", x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
+                JSValue mdown = make_pointer_like(ctx, EVT_MOUSEDOWN, x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
                 minirend_dom_dispatch_event(ctx, target, mdown);
                 break;
             }
@@ -369,9 +538,9 @@ void minirend_input_tick(JSContext *ctx) {
                 g_buttons_mask &= ~dom_buttons_bit_from_sapp(ev.mouse_button);
 
                 int32_t target = hit_target(x_css, y_css);
-                JSValue pup = make_pointer_like(ctx, "pointerup", x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
+                JSValue pup = make_pointer_like(ctx, EVT_POINTERUP, x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
                 minirend_dom_dispatch_event(ctx, target, pup);
-                JSValue mup = make_pointer_like(ctx, "mouseup", x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
+                JSValue mup = make_pointer_like(ctx, EVT_MOUSEUP, x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
                 minirend_dom_dispatch_event(ctx, target, mup);
 
                 /* Click synthesis: same target, small movement, short time. */
@@ -380,34 +549,28 @@ void minirend_input_tick(JSContext *ctx) {
                 const float dist2 = dx*dx + dy*dy;
                 const uint32_t dt = ev.time_ms - g_last_down_time;
                 if (target == g_last_down_target && dist2 < (5.0f * 5.0f) && dt < 600) {
-                    JSValue click = make_pointer_like(ctx, "click", x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
+                    JSValue click = make_pointer_like(ctx, EVT_CLICK, x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
                     minirend_dom_dispatch_event(ctx, target, click);
                     if (button == 2) {
-                        JSValue ctxm = make_pointer_like(ctx, "contextmenu", x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
+                        JSValue ctxm = make_pointer_like(ctx, EVT_CONTEXTMENU, x_css, y_css, button, g_buttons_mask, ev.modifiers, ev.time_ms);
                         minirend_dom_dispatch_event(ctx, target, ctxm);
                     }
                 }
                 break;
             }
-            case INEV_MOUSE_MOVE: {
-                int32_t target = hit_target(x_css, y_css);
-                JSValue pmove = make_pointer_like(ctx, "pointermove", x_css, y_css, 0, g_buttons_mask, ev.modifiers, ev.time_ms);
-                minirend_dom_dispatch_event(ctx, target, pmove);
-                JSValue mmove = make_pointer_like(ctx, "mousemove", x_css, y_css, 0, g_buttons_mask, ev.modifiers, ev.time_ms);
-                minirend_dom_dispatch_event(ctx, target, mmove);
-                break;
-            }
             case INEV_MOUSE_SCROLL: {
                 int32_t target = hit_target(x_css, y_css);
-                JSValue wheel = make_wheel(ctx, x_css, y_css, ev.scroll_x, ev.scroll_y, ev.modifiers, ev.time_ms);
-                minirend_dom_dispatch_event(ctx, target, wheel);
+                if (minirend_dom_wants_event(ctx, target, "wheel")) {
+                    JSValue wheel = make_wheel(ctx, x_css, y_css, ev.scroll_x, ev.scroll_y, ev.modifiers, ev.time_ms);
+                    minirend_dom_dispatch_event(ctx, target, wheel);
+                }
                 break;
             }
             case INEV_KEY_DOWN:
-                dispatch_key(ctx, "keydown", ev.key_code, ev.modifiers);
+                dispatch_key(ctx, EVT_KEYDOWN, ev.key_code, ev.modifiers);
                 break;
             case INEV_KEY_UP:
-                dispatch_key(ctx, "keyup", ev.key_code, ev.modifiers);
+                dispatch_key(ctx, EVT_KEYUP, ev.key_code, ev.modifiers);
                 break;
             case INEV_CHAR:
                 if (ev.char_code != 0) dispatch_text(ctx, ev.char_code);
@@ -416,6 +579,7 @@ void minirend_input_tick(JSContext *ctx) {
                 break;
         }
     }
+    flush_moves(ctx);
 }
 
 
@@ -293,3 +293,15 @@ minirend_js_tick_frame(JSContext *ctx) {
 }
 
 
+/* Microtask checkpoint: run queued promise jobs before the frame's DOM
+ * flush so their mutations land in the same batch. */
+void
+minirend_js_run_microtasks(JSContext *ctx) {
+    JSRuntime *rt = JS_GetRuntime(ctx);
+    JSContext *job_ctx;
+    int ret;
+    while ((ret = JS_ExecutePendingJob(rt, &job_ctx)) != 0) {
+        if (ret < 0) dump_exception(job_ctx);
+    }
+}
+
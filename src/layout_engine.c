@@ -10,6 +10,7 @@
 #include "layout_engine.h"
 #include "lexbor_adapter.h"
 #include "style_resolver.h"
+#include "compositor.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -24,6 +25,7 @@
  * ============================================================================ */
 
 #define MAX_LAYOUT_NODES 4096
+#define MAX_LAYOUT_LAYERS 64
 #define CLAY_ARENA_SIZE  (1024 * 1024)  /* 1MB arena for clay */
 
 /* ============================================================================
@@ -43,6 +45,11 @@ struct MinirendLayoutEngine {
     int                 node_count;
     int                 node_capacity;
     
+    /* Output compositing layers */
+    MinirendLayoutLayer *layers;
+    int                  layer_count;
+    int                  layer_capacity;
+    
     /* Text measurement callback */
     MinirendMeasureTextFn measure_text_fn;
     void                 *measure_text_user_data;
@@ -51,6 +58,7 @@ struct MinirendLayoutEngine {
     MinirendStyleResolver *current_resolver;
     LexborDocument        *current_doc;
     int32_t                next_node_id;
+    int32_t                current_layer;  /* -1 outside promoted subtrees */
 };
 
 /* ============================================================================
@@ -122,12 +130,23 @@ MinirendLayoutEngine *minirend_layout_engine_create(float viewport_width,
         return NULL;
     }
     
+    /* Allocate output layers */
+    engine->layer_capacity = MAX_LAYOUT_LAYERS;
+    engine->layers = calloc(engine->layer_capacity, sizeof(MinirendLayoutLayer));
+    if (!engine->layers) {
+        free(engine->nodes);
+        free(engine->clay_memory);
+        free(engine);
+        return NULL;
+    }
+    
     return engine;
 }
 
 void minirend_layout_engine_destroy(MinirendLayoutEngine *engine) {
     if (!engine) return;
     
+    free(engine->layers);
     free(engine->nodes);
     free(engine->clay_memory);
     free(engine);
@@ -173,6 +192,69 @@ static MinirendLayoutNode *add_layout_node(MinirendLayoutEngine *engine) {
     return node;
 }
 
+/* ============================================================================
+ * Add Output Layer
+ * ============================================================================ */
+
+static int32_t add_layout_layer(MinirendLayoutEngine *engine,
+                                lxb_dom_node_t *element,
+                                const MinirendComputedStyle *style) {
+    if (engine->layer_count >= engine->layer_capacity) {
+        int new_cap = engine->layer_capacity * 2;
+        MinirendLayoutLayer *new_layers = realloc(engine->layers,
+            new_cap * sizeof(MinirendLayoutLayer));
+        if (!new_layers) return -1;
+        
+        engine->layers = new_layers;
+        engine->layer_capacity = new_cap;
+    }
+    
+    int32_t index = engine->layer_count++;
+    MinirendLayoutLayer *layer = &engine->layers[index];
+    memset(layer, 0, sizeof(*layer));
+    
+    layer->element = element;
+    layer->width = -1.0f;  /* No bounds until the first node is converted */
+    layer->opacity = style->opacity;
+    layer->has_transform = style->has_transform;
+    memcpy(layer->transform, style->transform, sizeof(layer->transform));
+    
+    return index;
+}
+
+static void extend_layer_bounds(MinirendLayoutLayer *layer,
+                                const MinirendLayoutNode *node) {
+    if (layer->width < 0.0f) {
+        layer->x = node->x;
+        layer->y = node->y;
+        layer->width = node->width;
+        layer->height = node->height;
+        return;
+    }
+    
+    float x0 = node->x < layer->x ? node->x : layer->x;
+    float y0 = node->y < layer->y ? node->y : layer->y;
+    float x1 = node->x + node->width;
+    float y1 = node->y + node->height;
+    if (layer->x + layer->width > x1) x1 = layer->x + layer->width;
+    if (layer->y + layer->height > y1) y1 = layer->y + layer->height;
+    
+    layer->x = x0;
+    layer->y = y0;
+    layer->width = x1 - x0;
+    layer->height = y1 - y0;
+}
+
+/* Layer indices travel through clay's userData, offset by one so that
+ * NULL means "no layer". */
+static void *layer_to_user_data(int32_t layer) {
+    return (void *)(intptr_t)(layer + 1);
+}
+
+static int32_t layer_from_user_data(void *user_data) {
+    return (int32_t)(intptr_t)user_data - 1;
+}
+
 /* ============================================================================
  * Convert Clay Commands to Layout Nodes
  * ============================================================================ */
@@ -194,6 +276,11 @@ static void convert_clay_commands(MinirendLayoutEngine *engine,
         node->width = cmd->boundingBox.width;
         node->height = cmd->boundingBox.height;
         node->clay_id = cmd->id;
+        node->opacity = 1.0f;
+        
+        /* Attach to the compositing layer of the owning element */
+        node->layer = layer_from_user_data(cmd->userData);
+        if (node->layer >= engine->layer_count) node->layer = -1;
         
         switch (cmd->commandType) {
             case CLAY_RENDER_COMMAND_TYPE_RECTANGLE: {
@@ -254,6 +341,18 @@ static void convert_clay_commands(MinirendLayoutEngine *engine,
                 node->type = MINIREND_LAYOUT_NONE;
                 break;
         }
+        
+        if (node->layer >= 0 && node->type != MINIREND_LAYOUT_NONE) {
+            extend_layer_bounds(&engine->layers[node->layer], node);
+        }
+    }
+    
+    /* Layers whose subtree produced no output have nothing to composite */
+    for (int i = 0; i < engine->layer_count; i++) {
+        if (engine->layers[i].width < 0.0f) {
+            engine->layers[i].width = 0.0f;
+            engine->layers[i].height = 0.0f;
+        }
     }
 }
 
@@ -369,11 +468,19 @@ static void process_element(MinirendLayoutEngine *engine,
         },
     };
     
+    /* Promote to a compositing layer (nested promotions are flattened
+     * into the enclosing layer) */
+    int32_t saved_layer = engine->current_layer;
+    if (engine->current_layer < 0 && minirend_compositor_needs_layer(&style)) {
+        engine->current_layer = add_layout_layer(engine, element, &style);
+    }
+    
     /* Open clay element */
     Clay__OpenElementWithId((Clay_ElementId){ .id = elem_id });
     Clay__ConfigureOpenElement((Clay_ElementDeclaration){
         .layout = layout_config,
         .backgroundColor = bg_color,
+        .userData = layer_to_user_data(engine->current_layer),
     });
     
     /* Process children */
@@ -385,6 +492,8 @@ static void process_element(MinirendLayoutEngine *engine,
     
     /* Close clay element */
     Clay__CloseElement();
+    
+    engine->current_layer = saved_layer;
 }
 
 static void process_text_node(MinirendLayoutEngine *engine,
@@ -424,6 +533,7 @@ static void process_text_node(MinirendLayoutEngine *engine,
         .fontSize = (uint16_t)parent_style->font_size,
         .fontWeight = (uint16_t)parent_style->font_weight,
         .lineHeight = (uint16_t)parent_style->line_height,
+        .userData = layer_to_user_data(engine->current_layer),
     };
     
     Clay__OpenTextElement(clay_text, Clay__StoreTextElementConfig(text_config));
@@ -468,6 +578,8 @@ int minirend_layout_engine_compute(MinirendLayoutEngine *engine,
     engine->current_resolver = style_resolver;
     engine->current_doc = doc;
     engine->next_node_id = 1;
+    engine->current_layer = -1;
+    engine->layer_count = 0;
     
     /* Set global for text measurement */
     g_current_engine = engine;
@@ -525,6 +637,17 @@ const MinirendLayoutNode *minirend_layout_get_nodes(MinirendLayoutEngine *engine
     return engine->nodes;
 }
 
+const MinirendLayoutLayer *minirend_layout_get_layers(MinirendLayoutEngine *engine,
+                                                      int *out_count) {
+    if (!engine) {
+        if (out_count) *out_count = 0;
+        return NULL;
+    }
+    
+    if (out_count) *out_count = engine->layer_count;
+    return engine->layers;
+}
+
 bool minirend_layout_node_contains(const MinirendLayoutNode *node, float x, float y) {
     if (!node) return false;
     
@@ -41,6 +41,7 @@ typedef struct {
     /* Element identity */
     int32_t  node_id;       /* DOM node id for hit testing */
     uint32_t clay_id;       /* Internal clay element id */
+    int32_t  layer;         /* Compositing layer index, -1 if painted directly */
     
     /* Render type */
     MinirendLayoutType type;
@@ -70,6 +71,27 @@ typedef struct {
     
 } MinirendLayoutNode;
 
+/* ============================================================================
+ * Layout Layer - A subtree promoted to its own compositing layer
+ * ============================================================================ */
+
+/* Elements for which minirend_compositor_needs_layer() is true get a layer.
+ * Every layout node of the subtree carries the layer's index. Promoted
+ * elements nested inside another layer paint into the enclosing layer. */
+typedef struct {
+    /* Promoting element; stable across layouts, used as the cache key */
+    const lxb_dom_node_t *element;
+    
+    /* Union of the layer's node bounds in screen coordinates (pixels) */
+    float x, y, width, height;
+    
+    /* Applied when compositing, not baked into the layer content */
+    float opacity;
+    bool  has_transform;
+    float transform[6];
+    
+} MinirendLayoutLayer;
+
 /* ============================================================================
  * Layout Engine Context
  * ============================================================================ */
@@ -104,6 +126,12 @@ int minirend_layout_engine_compute(MinirendLayoutEngine *engine,
 const MinirendLayoutNode *minirend_layout_get_nodes(MinirendLayoutEngine *engine,
                                                     int *out_count);
 
+/* Get the compositing layers produced by compute().
+ * MinirendLayoutNode.layer indexes into this array.
+ * Returns pointer to internal array (valid until next compute call). */
+const MinirendLayoutLayer *minirend_layout_get_layers(MinirendLayoutEngine *engine,
+                                                      int *out_count);
+
 /* Helper to check if a point is inside a layout node's bounds. */
 bool minirend_layout_node_contains(const MinirendLayoutNode *node, float x, float y);
 
@@ -95,6 +95,41 @@ lxb_dom_node_t *minirend_lexbor_get_body(LexborDocument *doc) {
     return lxb_dom_interface_node(lxb_html_document_body_element(doc->html_doc));
 }
 
+lxb_dom_node_t *minirend_lexbor_get_document_node(LexborDocument *doc) {
+    if (!doc || !doc->html_doc) return NULL;
+    return lxb_dom_interface_node(doc->html_doc);
+}
+
+lxb_dom_node_t *minirend_lexbor_create_element(LexborDocument *doc,
+                                                const char *tag) {
+    if (!doc || !doc->html_doc || !tag) return NULL;
+
+    lxb_dom_document_t *dom_doc = lxb_dom_interface_document(doc->html_doc);
+    lxb_dom_element_t *el = lxb_dom_document_create_element(
+        dom_doc, (const lxb_char_t *)tag, strlen(tag), NULL);
+    return el ? lxb_dom_interface_node(el) : NULL;
+}
+
+void minirend_lexbor_append_child(lxb_dom_node_t *parent, lxb_dom_node_t *child) {
+    if (!parent || !child) return;
+
+    if (lxb_dom_node_parent(child)) {
+        lxb_dom_node_remove(child);
+    }
+    lxb_dom_node_insert_child(parent, child);
+}
+
+void minirend_lexbor_remove_node(lxb_dom_node_t *node) {
+    if (!node || !lxb_dom_node_parent(node)) return;
+    lxb_dom_node_remove(node);
+}
+
+void minirend_lexbor_destroy_node(lxb_dom_node_t *node) {
+    if (!node) return;
+    if (lxb_dom_node_parent(node)) lxb_dom_node_remove(node);
+    lxb_dom_node_destroy_deep(node);
+}
+
 /* Callback context for selector queries */
 typedef struct {
     minirend_lexbor_node_cb user_cb;
@@ -243,3 +278,27 @@ const char *minirend_lexbor_get_attribute(lxb_dom_node_t *element,
 }
 
 
+
+bool minirend_lexbor_set_attribute(lxb_dom_node_t *element,
+                                   const char *name, const char *value) {
+    if (!element || !name || !value) return false;
+
+    lxb_dom_element_t *el = lxb_dom_interface_element(element);
+    if (!el) return false;
+
+    lxb_dom_attr_t *attr = lxb_dom_element_set_attribute(
+        el,
+        (const lxb_char_t *)name, strlen(name),
+        (const lxb_char_t *)value, strlen(value));
+
+    return attr != NULL;
+}
+
+void minirend_lexbor_remove_attribute(lxb_dom_node_t *element, const char *name) {
+    if (!element || !name) return;
+
+    lxb_dom_element_t *el = lxb_dom_interface_element(element);
+    if (!el) return;
+
+    lxb_dom_element_remove_attribute(el, (const lxb_char_t *)name, strlen(name));
+}
@@ -51,6 +51,23 @@ lxb_selectors_t  *minirend_lexbor_get_selectors(LexborDocument *doc);
 /* Get the document's body element, or NULL if not present. */
 lxb_dom_node_t *minirend_lexbor_get_body(LexborDocument *doc);
 
+/* Get the document node itself (root of the tree, parent of <html>). */
+lxb_dom_node_t *minirend_lexbor_get_document_node(LexborDocument *doc);
+
+/* Create a detached element owned by doc. Returns NULL on failure. */
+lxb_dom_node_t *minirend_lexbor_create_element(LexborDocument *doc,
+                                                const char *tag);
+
+/* Move child to the end of parent's children, detaching it first. */
+void minirend_lexbor_append_child(lxb_dom_node_t *parent, lxb_dom_node_t *child);
+
+/* Detach node (and its subtree) from its parent. The node stays owned by
+ * its document and can be inserted again. */
+void minirend_lexbor_remove_node(lxb_dom_node_t *node);
+
+/* Detach node if needed and free it with its whole subtree. */
+void minirend_lexbor_destroy_node(lxb_dom_node_t *node);
+
 /* Query selector: find first matching element.
  * Returns NULL if not found or on error. */
 lxb_dom_node_t *minirend_lexbor_query_selector(LexborDocument *doc,
@@ -80,6 +97,13 @@ const char *minirend_lexbor_get_tag_name(lxb_dom_node_t *element);
 const char *minirend_lexbor_get_attribute(lxb_dom_node_t *element,
                                           const char *name);
 
+/* Set (or replace) an element attribute. Returns false on error. */
+bool minirend_lexbor_set_attribute(lxb_dom_node_t *element,
+                                   const char *name, const char *value);
+
+/* Remove an element attribute if present. */
+void minirend_lexbor_remove_attribute(lxb_dom_node_t *element, const char *name);
+
 #endif /* MINIREND_LEXBOR_ADAPTER_H */
 
 
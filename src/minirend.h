@@ -10,6 +10,7 @@ typedef struct JSContext JSContext;
 
 /* Opaque handles for the runtime subsystems. */
 typedef struct MinirendApp MinirendApp;
+typedef struct LexborDocument LexborDocument;
 
 /* Window mode options */
 typedef enum {
@@ -43,16 +44,44 @@ int        minirend_js_eval_file(JSContext *ctx, const char *path);
 /* DOM / window bindings (dom_bindings.c) */
 void minirend_dom_init(JSContext *ctx, MinirendApp *app);
 void minirend_dom_set_viewport(JSContext *ctx, int width, int height);
+/* Once per frame, after script has run: applies queued style writes,
+ * invalidates the renderer once and delivers MutationObserver records. */
+void minirend_dom_flush(JSContext *ctx);
+void minirend_dom_shutdown(JSContext *ctx);
+/* Whether the bindings wrap doc's nodes (from init until shutdown). */
+bool minirend_dom_uses_document(const LexborDocument *doc);
 
 /* Renderer / HTML (renderer.c) */
 void minirend_renderer_init(MinirendApp *app);
+void minirend_renderer_init_headless(MinirendApp *app, int width, int height);
 void minirend_renderer_shutdown(void);
 void minirend_renderer_load_html(MinirendApp *app, const char *path);
+void minirend_renderer_update_layers(MinirendApp *app);
 void minirend_renderer_draw(MinirendApp *app);
 void minirend_renderer_set_viewport(float width, float height);
+bool minirend_renderer_write_png(const char *path);
 int  minirend_renderer_load_font(const char *path);
+int  minirend_renderer_register_font(const char *family, const char *path,
+                                     int weight, bool italic);
+bool minirend_renderer_add_fallback_font(const char *path);
+void minirend_renderer_set_sdf_text(bool enabled);
 bool minirend_renderer_add_stylesheet(const char *css, size_t len);
 
+/* The document being rendered. set_document takes ownership and replaces
+ * (destroys) the previous one; the DOM bindings wrap its nodes, so it is
+ * shared with JS rather than copied. A document the bindings are using is
+ * never replaced: doc is destroyed instead and false returned, so load
+ * HTML before minirend_dom_init. */
+LexborDocument *minirend_renderer_get_document(void);
+bool minirend_renderer_set_document(LexborDocument *doc);
+
+/* What a DOM mutation invalidates. */
+enum {
+    MINIREND_INVALIDATE_STYLE  = 1 << 0,  /* Selectors/inline styles may match differently */
+    MINIREND_INVALIDATE_LAYOUT = 1 << 1,  /* Boxes may move or resize */
+};
+void minirend_renderer_invalidate(unsigned flags);
+
 /* WebGL / Canvas (webgl_bindings.c, canvas_bindings.c) */
 void minirend_webgl_register(JSContext *ctx, MinirendApp *app);
 void minirend_canvas_register(JSContext *ctx, MinirendApp *app);
@@ -60,6 +89,7 @@ void minirend_canvas_register(JSContext *ctx, MinirendApp *app);
 /* Timing / animation (implemented in js_engine.c) */
 void minirend_register_timers(JSContext *ctx, MinirendApp *app);
 void minirend_js_tick_frame(JSContext *ctx);
+void minirend_js_run_microtasks(JSContext *ctx);
 
 /* Console (js_engine.c) */
 void minirend_register_console(JSContext *ctx);
@@ -9,11 +9,13 @@
  * - Text renderer for text content
  * - Transform support for CSS transforms
  * - Compositing for layered rendering
+ * - A CPU rasterizer backend for headless rendering (screenshots, CI)
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include "minirend.h"
 #include "lexbor_adapter.h"
@@ -23,14 +25,33 @@
 #include "font_cache.h"
 #include "text_renderer.h"
 #include "transform.h"
+#include "compositor.h"
+#include "soft_raster.h"
 #include "ui_tree.h"
 
 #include "sokol_gfx.h"
 
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define MAX_CACHED_LAYERS 64
+
 /* ============================================================================
  * Renderer State
  * ============================================================================ */
 
+/* A compositing layer whose texture is kept across frames. Only changes to
+ * the painted content force a repaint; transform/opacity changes just
+ * re-composite the cached texture. */
+typedef struct {
+    const void    *key;          /* Promoting DOM element */
+    MinirendLayer *layer;        /* Compositor layer holding the texture */
+    uint64_t       content_hash; /* Hash of the layer's nodes, layer-local */
+    uint32_t       last_frame;   /* Last frame the layer was present */
+    bool           valid;        /* Texture holds painted content */
+} CachedLayer;
+
 typedef struct {
     /* Parsed document */
     LexborDocument *doc;
@@ -45,6 +66,23 @@ typedef struct {
     MinirendBoxRenderer  *box_renderer;
     MinirendFontCache    *font_cache;
     MinirendTextRenderer *text_renderer;
+    MinirendCompositor   *compositor;
+    MinirendSoftRaster   *soft_raster;  /* Headless target; NULL with a GPU */
+    
+    /* Layer cache */
+    CachedLayer layer_cache[MAX_CACHED_LAYERS];
+    int         layer_cache_count;
+    uint32_t    frame_index;
+    
+    /* Layout layer index -> cache slot for the current frame (-1 = paint
+     * directly). Valid while layers_ready is set. */
+    int         layer_slot[MAX_CACHED_LAYERS];
+    int         layer_slot_count;
+    bool        layers_ready;
+    
+    /* Per-node scratch for paint classification (see paint_list) */
+    struct PaintItem *paint_items;
+    int               paint_capacity;
     
     /* Viewport */
     float viewport_width;
@@ -52,6 +90,7 @@ typedef struct {
     
     /* State */
     bool initialized;
+    bool style_dirty;
     bool layout_dirty;
     
 } RendererState;
@@ -67,10 +106,11 @@ static void measure_text_callback(const char *text, int32_t len,
                                   float *out_width, float *out_height,
                                   void *user_data) {
     (void)user_data;
-    (void)font_weight;
     
     if (g_renderer.font_cache) {
-        minirend_font_cache_measure_text(g_renderer.font_cache, -1,
+        int font_id = minirend_font_cache_match_face(g_renderer.font_cache, NULL,
+                                                     font_weight, false);
+        minirend_font_cache_measure_text(g_renderer.font_cache, font_id,
                                          text, len, font_size,
                                          out_width, out_height);
     } else {
@@ -94,25 +134,44 @@ void minirend_renderer_init(MinirendApp *app) {
     g_renderer.viewport_height = 720.0f;
     
     /* Create box renderer */
-    g_renderer.box_renderer = minirend_box_renderer_create();
+    g_renderer.box_renderer = g_renderer.soft_raster
+        ? minirend_box_renderer_create_soft(g_renderer.soft_raster)
+        : minirend_box_renderer_create();
     if (!g_renderer.box_renderer) {
         fprintf(stderr, "[renderer] Failed to create box renderer\n");
     }
     
     /* Create font cache */
-    g_renderer.font_cache = minirend_font_cache_create(1024, 2048);
+    g_renderer.font_cache = minirend_font_cache_create(512, 2048);
     if (!g_renderer.font_cache) {
         fprintf(stderr, "[renderer] Failed to create font cache\n");
     }
     
+    /* Rasterize glyphs off the frame thread. Headless output must be
+     * complete in a single frame, so it keeps rasterizing inline. */
+    if (g_renderer.font_cache && !g_renderer.soft_raster) {
+        minirend_font_cache_start_workers(g_renderer.font_cache, 0);
+    }
+    
     /* Create text renderer */
     if (g_renderer.font_cache) {
-        g_renderer.text_renderer = minirend_text_renderer_create(g_renderer.font_cache);
+        g_renderer.text_renderer = g_renderer.soft_raster
+            ? minirend_text_renderer_create_soft(g_renderer.font_cache,
+                                                 g_renderer.soft_raster)
+            : minirend_text_renderer_create(g_renderer.font_cache);
         if (!g_renderer.text_renderer) {
             fprintf(stderr, "[renderer] Failed to create text renderer\n");
         }
     }
     
+    /* Create compositor (GPU only; headless paints layers inline) */
+    if (!g_renderer.soft_raster) {
+        g_renderer.compositor = minirend_compositor_create();
+        if (!g_renderer.compositor) {
+            fprintf(stderr, "[renderer] Failed to create compositor\n");
+        }
+    }
+    
     /* Create layout engine */
     g_renderer.layout_engine = minirend_layout_engine_create(
         g_renderer.viewport_width, g_renderer.viewport_height);
@@ -127,9 +186,34 @@ void minirend_renderer_init(MinirendApp *app) {
     fprintf(stderr, "[renderer] HTML/CSS renderer initialized\n");
 }
 
+void minirend_renderer_init_headless(MinirendApp *app, int width, int height) {
+    if (g_renderer.initialized) return;
+    
+    g_renderer.soft_raster = minirend_soft_raster_create(width, height, 0);
+    if (!g_renderer.soft_raster) {
+        fprintf(stderr, "[renderer] Failed to create software rasterizer\n");
+        return;
+    }
+    
+    minirend_renderer_init(app);
+    minirend_renderer_set_viewport((float)width, (float)height);
+}
+
 void minirend_renderer_shutdown(void) {
     if (!g_renderer.initialized) return;
     
+    if (g_renderer.compositor) {
+        /* Destroys the cached layers' resources as well */
+        minirend_compositor_destroy(g_renderer.compositor);
+        g_renderer.compositor = NULL;
+    }
+    g_renderer.layer_cache_count = 0;
+    g_renderer.layers_ready = false;
+    
+    free(g_renderer.paint_items);
+    g_renderer.paint_items = NULL;
+    g_renderer.paint_capacity = 0;
+    
     if (g_renderer.text_renderer) {
         minirend_text_renderer_destroy(g_renderer.text_renderer);
         g_renderer.text_renderer = NULL;
@@ -150,6 +234,11 @@ void minirend_renderer_shutdown(void) {
         g_renderer.layout_engine = NULL;
     }
     
+    if (g_renderer.soft_raster) {
+        minirend_soft_raster_destroy(g_renderer.soft_raster);
+        g_renderer.soft_raster = NULL;
+    }
+    
     if (g_renderer.style_resolver) {
         minirend_style_resolver_destroy(g_renderer.style_resolver);
         g_renderer.style_resolver = NULL;
@@ -214,42 +303,66 @@ void minirend_renderer_load_html(MinirendApp *app, const char *path) {
         return;
     }
     
-    /* Destroy previous document */
-    if (g_renderer.doc) {
-        minirend_lexbor_document_destroy(g_renderer.doc);
-        g_renderer.doc = NULL;
-    }
-    if (g_renderer.style_resolver) {
-        minirend_style_resolver_destroy(g_renderer.style_resolver);
-        g_renderer.style_resolver = NULL;
-    }
-    
     /* Parse HTML */
-    g_renderer.doc = minirend_lexbor_parse_html(html, html_len);
+    LexborDocument *doc = minirend_lexbor_parse_html(html, html_len);
     free(html);
     
-    if (!g_renderer.doc) {
+    if (!doc) {
         fprintf(stderr, "[renderer] Failed to parse HTML\n");
         return;
     }
     
+    if (!minirend_renderer_set_document(doc)) return;
+    
+    /* TODO: Extract and parse <style> blocks */
+    /* TODO: Load external stylesheets */
+    
+    fprintf(stderr, "[renderer] Loaded HTML: %s\n", path);
+}
+
+LexborDocument *minirend_renderer_get_document(void) {
+    return g_renderer.doc;
+}
+
+bool minirend_renderer_set_document(LexborDocument *doc) {
+    if (doc == g_renderer.doc) return true;
+    
+    /* Wrappers, the query indexes and document/body point into it. */
+    if (g_renderer.doc && minirend_dom_uses_document(g_renderer.doc)) {
+        fprintf(stderr, "[renderer] Document is bound to the DOM; not replacing it\n");
+        if (doc) minirend_lexbor_document_destroy(doc);
+        return false;
+    }
+    
+    /* Destroy previous document */
+    if (g_renderer.style_resolver) {
+        minirend_style_resolver_destroy(g_renderer.style_resolver);
+        g_renderer.style_resolver = NULL;
+    }
+    if (g_renderer.doc) {
+        minirend_lexbor_document_destroy(g_renderer.doc);
+    }
+    g_renderer.doc = doc;
+    
+    g_renderer.style_dirty = true;
+    g_renderer.layout_dirty = true;
+    if (!doc) return true;
+    
     /* Create style resolver */
     g_renderer.style_resolver = minirend_style_resolver_create(
-        g_renderer.doc,
+        doc,
         g_renderer.viewport_width,
         g_renderer.viewport_height);
     
     if (!g_renderer.style_resolver) {
         fprintf(stderr, "[renderer] Failed to create style resolver\n");
-        return;
     }
-    
-    /* TODO: Extract and parse <style> blocks */
-    /* TODO: Load external stylesheets */
-    
-    g_renderer.layout_dirty = true;
-    
-    fprintf(stderr, "[renderer] Loaded HTML: %s\n", path);
+    return true;
+}
+
+void minirend_renderer_invalidate(unsigned flags) {
+    if (flags & MINIREND_INVALIDATE_STYLE) g_renderer.style_dirty = true;
+    if (flags & MINIREND_INVALIDATE_LAYOUT) g_renderer.layout_dirty = true;
 }
 
 /* ============================================================================
@@ -268,6 +381,9 @@ void minirend_renderer_set_viewport(float width, float height) {
         if (g_renderer.layout_engine) {
             minirend_layout_engine_set_viewport(g_renderer.layout_engine, width, height);
         }
+        if (g_renderer.soft_raster) {
+            minirend_soft_raster_resize(g_renderer.soft_raster, (int)width, (int)height);
+        }
     }
 }
 
@@ -275,102 +391,631 @@ void minirend_renderer_set_viewport(float width, float height) {
  * Drawing
  * ============================================================================ */
 
-void minirend_renderer_draw(MinirendApp *app) {
-    (void)app;
-    
-    if (!g_renderer.initialized) return;
-    if (!g_renderer.doc || !g_renderer.style_resolver) return;
-    
-    /* Recompute layout if dirty */
-    if (g_renderer.layout_dirty && g_renderer.layout_engine) {
+static void ensure_layout(void) {
+    /* Styles are resolved while laying out, so a restyle re-runs layout */
+    if ((g_renderer.layout_dirty || g_renderer.style_dirty) && g_renderer.layout_engine) {
         minirend_layout_engine_compute(g_renderer.layout_engine,
                                        g_renderer.doc,
                                        g_renderer.style_resolver);
+        g_renderer.style_dirty = false;
         g_renderer.layout_dirty = false;
+        
+        /* Layer slots refer to the previous layout */
+        g_renderer.layers_ready = false;
     }
+}
+
+/* Draw a single layout node, offset by (-ox, -oy). */
+static void paint_node(const MinirendLayoutNode *node, float ox, float oy) {
+    float x = node->x - ox;
+    float y = node->y - oy;
     
-    /* Get layout nodes */
-    int node_count = 0;
-    const MinirendLayoutNode *nodes = minirend_layout_get_nodes(
-        g_renderer.layout_engine, &node_count);
+    switch (node->type) {
+        case MINIREND_LAYOUT_BOX:
+            if (g_renderer.box_renderer && node->background_color.a > 0) {
+                if (node->corner_radius > 0) {
+                    minirend_box_draw_rounded_rect(g_renderer.box_renderer,
+                        x, y, node->width, node->height,
+                        node->background_color, node->corner_radius);
+                } else {
+                    minirend_box_draw_rect(g_renderer.box_renderer,
+                        x, y, node->width, node->height,
+                        node->background_color);
+                }
+            }
+            break;
+            
+        case MINIREND_LAYOUT_TEXT:
+            if (g_renderer.text_renderer && node->text && node->text_len > 0) {
+                /* Get font ascent for baseline positioning */
+                float ascent = node->font_size * 0.8f;  /* Approximate */
+                minirend_text_draw(g_renderer.text_renderer,
+                    node->text, node->text_len,
+                    x, y + ascent,
+                    node->font_size, node->font_weight,
+                    node->text_color);
+            }
+            break;
+            
+        case MINIREND_LAYOUT_BORDER:
+            if (g_renderer.box_renderer && node->border_color.a > 0) {
+                minirend_box_draw_border(g_renderer.box_renderer,
+                    x, y, node->width, node->height,
+                    node->border_top_width, node->border_right_width,
+                    node->border_bottom_width, node->border_left_width,
+                    node->border_color);
+            }
+            break;
+            
+        case MINIREND_LAYOUT_SCISSOR_START:
+            if (g_renderer.box_renderer) {
+                /* Flushes the current batch before the scissor change */
+                minirend_box_set_scissor(g_renderer.box_renderer,
+                    x, y, node->width, node->height);
+            }
+            break;
+            
+        case MINIREND_LAYOUT_SCISSOR_END:
+            if (g_renderer.box_renderer) {
+                minirend_box_clear_scissor(g_renderer.box_renderer);
+            }
+            break;
+            
+        default:
+            break;
+    }
+}
+
+/* ============================================================================
+ * Paint List
+ *
+ * Nodes are classified before drawing. Opaque rects (alpha 255, no radius,
+ * no transform) are drawn front-to-back without blending and write depth;
+ * translucent content follows back-to-front and is depth tested, so pixels
+ * behind an opaque rect are rejected before shading. Nodes completely
+ * covered by a later opaque rect are culled outright.
+ * ============================================================================ */
+
+#define MAX_OCCLUDERS 16
+
+typedef enum {
+    PAINT_SKIP = 0,         /* Not in this list, empty or fully occluded */
+    PAINT_OPAQUE,           /* Front-to-back, no blending */
+    PAINT_TRANSLUCENT,      /* Back-to-front, blended */
+    PAINT_STATE,            /* Scissor change, replayed in the blended pass */
+    PAINT_COMPOSITE,        /* Cached layer texture */
+} PaintKind;
+
+typedef struct PaintItem {
+    uint8_t kind;
+    bool    clipped;
+    float   clip[4];        /* Active scissor (x, y, w, h), screen pixels */
+} PaintItem;
+
+typedef struct {
+    float x0, y0, x1, y1;
+} PaintRect;
+
+static bool ensure_paint_items(int count) {
+    if (count <= g_renderer.paint_capacity) return true;
     
-    if (!nodes || node_count == 0) return;
+    int new_cap = g_renderer.paint_capacity ? g_renderer.paint_capacity : 256;
+    while (new_cap < count) new_cap *= 2;
     
-    /* Begin rendering */
+    PaintItem *items = realloc(g_renderer.paint_items, new_cap * sizeof(PaintItem));
+    if (!items) return false;
+    
+    g_renderer.paint_items = items;
+    g_renderer.paint_capacity = new_cap;
+    return true;
+}
+
+/* Paint order -> depth: later nodes are nearer. */
+static float node_depth(int index, int count) {
+    return 1.0f - (float)(index + 1) / (float)(count + 1);
+}
+
+static bool is_empty_node(const MinirendLayoutNode *node) {
+    switch (node->type) {
+        case MINIREND_LAYOUT_BOX:
+            return node->background_color.a == 0;
+        case MINIREND_LAYOUT_BORDER:
+            return node->border_color.a == 0;
+        case MINIREND_LAYOUT_TEXT:
+            return !node->text || node->text_len <= 0;
+        default:
+            return true;
+    }
+}
+
+static bool is_opaque_node(const MinirendLayoutNode *node) {
+    if (node->has_transform || node->corner_radius > 0) return false;
+    
+    switch (node->type) {
+        case MINIREND_LAYOUT_BOX:
+            return node->background_color.a == 255;
+        case MINIREND_LAYOUT_BORDER:
+            return node->border_color.a == 255;
+        default:
+            return false;
+    }
+}
+
+/* Node bounds clipped to its scissor. Returns false if nothing is visible. */
+static bool visible_rect(const MinirendLayoutNode *node, const PaintItem *item,
+                         PaintRect *out) {
+    PaintRect r = { node->x, node->y, node->x + node->width, node->y + node->height };
+    
+    if (item->clipped) {
+        float cx1 = item->clip[0] + item->clip[2];
+        float cy1 = item->clip[1] + item->clip[3];
+        if (item->clip[0] > r.x0) r.x0 = item->clip[0];
+        if (item->clip[1] > r.y0) r.y0 = item->clip[1];
+        if (cx1 < r.x1) r.x1 = cx1;
+        if (cy1 < r.y1) r.y1 = cy1;
+    }
+    
+    *out = r;
+    return r.x1 > r.x0 && r.y1 > r.y0;
+}
+
+static bool rect_contains(const PaintRect *outer, const PaintRect *inner) {
+    return inner->x0 >= outer->x0 && inner->y0 >= outer->y0 &&
+           inner->x1 <= outer->x1 && inner->y1 <= outer->y1;
+}
+
+static float rect_area(const PaintRect *r) {
+    return (r->x1 - r->x0) * (r->y1 - r->y0);
+}
+
+/* Keep the largest occluders; small ones rarely cover anything. */
+static void add_occluder(PaintRect *occluders, int *count, const PaintRect *r) {
+    if (*count < MAX_OCCLUDERS) {
+        occluders[(*count)++] = *r;
+        return;
+    }
+    
+    int smallest = 0;
+    for (int i = 1; i < *count; i++) {
+        if (rect_area(&occluders[i]) < rect_area(&occluders[smallest])) {
+            smallest = i;
+        }
+    }
+    if (rect_area(r) > rect_area(&occluders[smallest])) {
+        occluders[smallest] = *r;
+    }
+}
+
+/* Cache slot of the node's layer when it is composited from a texture. */
+static int composite_slot(const MinirendLayoutNode *node, bool use_layers) {
+    if (!use_layers) return -1;
+    if (node->layer < 0 || node->layer >= g_renderer.layer_slot_count) return -1;
+    return g_renderer.layer_slot[node->layer];
+}
+
+static void flush_main_batches(void) {
     if (g_renderer.box_renderer) {
+        minirend_box_renderer_end(g_renderer.box_renderer);
         minirend_box_renderer_begin(g_renderer.box_renderer,
-                                    g_renderer.viewport_width,
-                                    g_renderer.viewport_height);
+            g_renderer.viewport_width, g_renderer.viewport_height);
     }
     if (g_renderer.text_renderer) {
+        minirend_text_renderer_end(g_renderer.text_renderer);
         minirend_text_renderer_begin(g_renderer.text_renderer,
-                                     g_renderer.viewport_width,
-                                     g_renderer.viewport_height);
+            g_renderer.viewport_width, g_renderer.viewport_height);
+    }
+}
+
+/* Draw a promoted subtree's cached texture at the current point of the
+ * main pass. */
+static void composite_node(const MinirendLayoutNode *node, bool use_layers, float depth) {
+    /* Flush pending batches so the layer stacks above them */
+    MinirendLayer *tex = g_renderer.layer_cache[composite_slot(node, use_layers)].layer;
+    flush_main_batches();
+    tex->depth = depth;
+    minirend_compositor_draw_layer(g_renderer.compositor, tex, tex->x, tex->y);
+}
+
+/* Paint the nodes of one target: layout layer `layer` into its texture
+ * (offset by -ox, -oy), or with layer < 0 the main pass, where promoted
+ * subtrees are composited from their cached textures when use_layers is set.
+ * The box/text renderers must already be begun for the target. */
+static void paint_list(const MinirendLayoutNode *nodes, int node_count,
+                       int layer, bool use_layers, float ox, float oy) {
+    if (!ensure_paint_items(node_count)) {
+        /* No scratch memory: plain painter's order */
+        bool composited[MAX_CACHED_LAYERS] = {0};
+        for (int i = 0; i < node_count; i++) {
+            if (layer >= 0) {
+                if (nodes[i].layer == layer) paint_node(&nodes[i], ox, oy);
+            } else if (composite_slot(&nodes[i], use_layers) < 0) {
+                paint_node(&nodes[i], ox, oy);
+            } else if (!composited[nodes[i].layer]) {
+                composited[nodes[i].layer] = true;
+                composite_node(&nodes[i], use_layers, node_depth(i, node_count));
+            }
+        }
+        return;
     }
     
-    /* Draw each layout node */
+    PaintItem *items = g_renderer.paint_items;
+    bool composited[MAX_CACHED_LAYERS] = {0};
+    bool clipped = false;
+    float clip[4] = {0};
+    
+    /* Classify in paint order, tracking the active scissor */
     for (int i = 0; i < node_count; i++) {
         const MinirendLayoutNode *node = &nodes[i];
+        PaintItem *item = &items[i];
+        item->kind = PAINT_SKIP;
         
-        switch (node->type) {
-            case MINIREND_LAYOUT_BOX:
-                if (g_renderer.box_renderer && node->background_color.a > 0) {
-                    if (node->corner_radius > 0) {
-                        minirend_box_draw_rounded_rect(g_renderer.box_renderer,
-                            node->x, node->y, node->width, node->height,
-                            node->background_color, node->corner_radius);
-                    } else {
-                        minirend_box_draw_rect(g_renderer.box_renderer,
-                            node->x, node->y, node->width, node->height,
-                            node->background_color);
-                    }
-                }
-                break;
-                
-            case MINIREND_LAYOUT_TEXT:
-                if (g_renderer.text_renderer && node->text && node->text_len > 0) {
-                    /* Get font ascent for baseline positioning */
-                    float ascent = node->font_size * 0.8f;  /* Approximate */
-                    minirend_text_draw(g_renderer.text_renderer,
-                        node->text, node->text_len,
-                        node->x, node->y + ascent,
-                        node->font_size, node->font_weight,
-                        node->text_color);
-                }
-                break;
-                
-            case MINIREND_LAYOUT_BORDER:
-                if (g_renderer.box_renderer && node->border_color.a > 0) {
-                    minirend_box_draw_border(g_renderer.box_renderer,
-                        node->x, node->y, node->width, node->height,
-                        node->border_top_width, node->border_right_width,
-                        node->border_bottom_width, node->border_left_width,
-                        node->border_color);
+        if (layer >= 0) {
+            if (node->layer != layer) continue;
+        } else if (composite_slot(node, use_layers) >= 0) {
+            if (!composited[node->layer]) {
+                item->kind = PAINT_COMPOSITE;
+                composited[node->layer] = true;
+            }
+            continue;
+        }
+        
+        if (node->type == MINIREND_LAYOUT_SCISSOR_START) {
+            clipped = true;
+            clip[0] = node->x;
+            clip[1] = node->y;
+            clip[2] = node->width;
+            clip[3] = node->height;
+            item->kind = PAINT_STATE;
+            continue;
+        }
+        if (node->type == MINIREND_LAYOUT_SCISSOR_END) {
+            clipped = false;
+            item->kind = PAINT_STATE;
+            continue;
+        }
+        if (is_empty_node(node)) continue;
+        
+        item->kind = is_opaque_node(node) ? PAINT_OPAQUE : PAINT_TRANSLUCENT;
+        item->clipped = clipped;
+        memcpy(item->clip, clip, sizeof(clip));
+    }
+    
+    /* Cull against the largest opaque rects painted later */
+    PaintRect occluders[MAX_OCCLUDERS];
+    int occluder_count = 0;
+    for (int i = node_count - 1; i >= 0; i--) {
+        PaintItem *item = &items[i];
+        if (item->kind != PAINT_OPAQUE && item->kind != PAINT_TRANSLUCENT) continue;
+        
+        PaintRect vis;
+        if (!visible_rect(&nodes[i], item, &vis)) {
+            item->kind = PAINT_SKIP;
+            continue;
+        }
+        
+        bool hidden = false;
+        for (int j = 0; j < occluder_count && !hidden; j++) {
+            hidden = rect_contains(&occluders[j], &vis);
+        }
+        if (hidden) {
+            item->kind = PAINT_SKIP;
+            continue;
+        }
+        
+        /* Borders are frames, not fills: they never occlude */
+        if (item->kind == PAINT_OPAQUE && nodes[i].type == MINIREND_LAYOUT_BOX) {
+            add_occluder(occluders, &occluder_count, &vis);
+        }
+    }
+    
+    /* Opaque pass, front-to-back */
+    MinirendBoxRenderer *box = g_renderer.box_renderer;
+    if (box) {
+        bool scissor_on = false;
+        const float *scissor = NULL;
+        
+        minirend_box_set_opaque(box, true);
+        for (int i = node_count - 1; i >= 0; i--) {
+            const PaintItem *item = &items[i];
+            if (item->kind != PAINT_OPAQUE) continue;
+            
+            if (item->clipped) {
+                if (!scissor_on || memcmp(scissor, item->clip, sizeof(item->clip)) != 0) {
+                    minirend_box_set_scissor(box, item->clip[0] - ox, item->clip[1] - oy,
+                                             item->clip[2], item->clip[3]);
+                    scissor_on = true;
+                    scissor = item->clip;
                 }
+            } else if (scissor_on) {
+                minirend_box_clear_scissor(box);
+                scissor_on = false;
+            }
+            
+            minirend_box_set_depth(box, node_depth(i, node_count));
+            paint_node(&nodes[i], ox, oy);
+        }
+        if (scissor_on) {
+            minirend_box_clear_scissor(box);
+        }
+        minirend_box_set_opaque(box, false);
+    }
+    
+    /* Translucent pass, back-to-front */
+    for (int i = 0; i < node_count; i++) {
+        const MinirendLayoutNode *node = &nodes[i];
+        float depth = node_depth(i, node_count);
+        
+        switch (items[i].kind) {
+            case PAINT_STATE:
+                paint_node(node, ox, oy);
                 break;
                 
-            case MINIREND_LAYOUT_SCISSOR_START:
-                if (g_renderer.box_renderer) {
-                    /* Flush current batch before scissor change */
-                    minirend_box_renderer_end(g_renderer.box_renderer);
-                    minirend_box_renderer_begin(g_renderer.box_renderer,
-                        g_renderer.viewport_width, g_renderer.viewport_height);
-                    minirend_box_set_scissor(g_renderer.box_renderer,
-                        node->x, node->y, node->width, node->height);
+            case PAINT_TRANSLUCENT:
+                if (box) minirend_box_set_depth(box, depth);
+                if (g_renderer.text_renderer) {
+                    minirend_text_set_depth(g_renderer.text_renderer, depth);
                 }
+                paint_node(node, ox, oy);
                 break;
                 
-            case MINIREND_LAYOUT_SCISSOR_END:
-                if (g_renderer.box_renderer) {
-                    minirend_box_clear_scissor(g_renderer.box_renderer);
-                }
+            case PAINT_COMPOSITE:
+                composite_node(node, use_layers, depth);
                 break;
                 
             default:
                 break;
         }
+    }
+}
+
+/* FNV-1a over the node fields that affect painted pixels. Positions are
+ * taken relative to the layer so moving a layer keeps its hash. */
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t hash_node(uint64_t h, const MinirendLayoutNode *node,
+                          float ox, float oy) {
+    float geom[4] = { node->x - ox, node->y - oy, node->width, node->height };
+    h = hash_bytes(h, &node->type, sizeof(node->type));
+    h = hash_bytes(h, geom, sizeof(geom));
+    
+    switch (node->type) {
+        case MINIREND_LAYOUT_BOX:
+            h = hash_bytes(h, &node->background_color, sizeof(MinirendColor));
+            h = hash_bytes(h, &node->corner_radius, sizeof(float));
+            break;
+            
+        case MINIREND_LAYOUT_TEXT:
+            h = hash_bytes(h, &node->text_color, sizeof(MinirendColor));
+            h = hash_bytes(h, &node->font_size, sizeof(float));
+            h = hash_bytes(h, &node->font_weight, sizeof(int));
+            h = hash_bytes(h, &node->text_len, sizeof(int32_t));
+            if (node->text && node->text_len > 0) {
+                h = hash_bytes(h, node->text, (size_t)node->text_len);
+            }
+            break;
+            
+        case MINIREND_LAYOUT_BORDER: {
+            float widths[4] = {
+                node->border_top_width, node->border_right_width,
+                node->border_bottom_width, node->border_left_width,
+            };
+            h = hash_bytes(h, &node->border_color, sizeof(MinirendColor));
+            h = hash_bytes(h, widths, sizeof(widths));
+            break;
+        }
+            
+        default:
+            break;
+    }
+    
+    return h;
+}
+
+static int find_cached_layer(const void *key) {
+    for (int i = 0; i < g_renderer.layer_cache_count; i++) {
+        if (g_renderer.layer_cache[i].key == key) return i;
+    }
+    return -1;
+}
+
+/* Paint all nodes of layout layer `index` into its cached texture. */
+static void repaint_layer(CachedLayer *cached, int index,
+                          const MinirendLayoutLayer *ll,
+                          const MinirendLayoutNode *nodes, int node_count) {
+    MinirendLayer *layer = cached->layer;
+    
+    minirend_compositor_begin_layer(g_renderer.compositor, layer);
+    
+    if (g_renderer.box_renderer) {
+        minirend_box_renderer_begin_layer(g_renderer.box_renderer,
+                                          layer->width, layer->height);
+    }
+    if (g_renderer.text_renderer) {
+        minirend_text_renderer_begin_layer(g_renderer.text_renderer,
+                                           layer->width, layer->height);
+    }
+    
+    paint_list(nodes, node_count, index, false, ll->x, ll->y);
+    
+    if (g_renderer.box_renderer) {
+        minirend_box_renderer_end(g_renderer.box_renderer);
+    }
+    if (g_renderer.text_renderer) {
+        minirend_text_renderer_end(g_renderer.text_renderer);
+    }
+    
+    minirend_compositor_end_layer(g_renderer.compositor);
+    
+    /* Glyphs still rasterizing: repaint once their bitmaps have landed */
+    cached->valid = !(g_renderer.text_renderer &&
+                      minirend_text_renderer_drew_placeholders(g_renderer.text_renderer));
+}
+
+void minirend_renderer_update_layers(MinirendApp *app) {
+    (void)app;
+    
+    g_renderer.layers_ready = false;
+    
+    if (!g_renderer.initialized || !g_renderer.compositor) return;
+    if (!g_renderer.doc || !g_renderer.style_resolver) return;
+    
+    ensure_layout();
+    
+    int node_count = 0;
+    const MinirendLayoutNode *nodes = minirend_layout_get_nodes(
+        g_renderer.layout_engine, &node_count);
+    int layer_count = 0;
+    const MinirendLayoutLayer *layers = minirend_layout_get_layers(
+        g_renderer.layout_engine, &layer_count);
+    
+    uint32_t frame = ++g_renderer.frame_index;
+    
+    /* Mark layers still present, then drop the ones that went away */
+    for (int i = 0; i < layer_count; i++) {
+        int slot = find_cached_layer(layers[i].element);
+        if (slot >= 0) g_renderer.layer_cache[slot].last_frame = frame;
+    }
+    for (int i = 0; i < g_renderer.layer_cache_count; ) {
+        CachedLayer *cached = &g_renderer.layer_cache[i];
+        if (cached->last_frame != frame) {
+            minirend_compositor_destroy_layer(g_renderer.compositor, cached->layer);
+            *cached = g_renderer.layer_cache[--g_renderer.layer_cache_count];
+        } else {
+            i++;
+        }
+    }
+    
+    /* Hash each layer's content in one pass over the nodes */
+    uint64_t hashes[MAX_CACHED_LAYERS];
+    int hashed = layer_count < MAX_CACHED_LAYERS ? layer_count : MAX_CACHED_LAYERS;
+    for (int i = 0; i < hashed; i++) {
+        hashes[i] = 14695981039346656037ULL;
+    }
+    for (int i = 0; i < node_count; i++) {
+        int index = nodes[i].layer;
+        if (index >= 0 && index < hashed) {
+            hashes[index] = hash_node(hashes[index], &nodes[i],
+                                      layers[index].x, layers[index].y);
+        }
+    }
+    
+    g_renderer.layer_slot_count = hashed;
+    
+    for (int i = 0; i < hashed; i++) {
+        const MinirendLayoutLayer *ll = &layers[i];
+        g_renderer.layer_slot[i] = -1;
+        
+        float width = ceilf(ll->width);
+        float height = ceilf(ll->height);
+        if (width < 1.0f || height < 1.0f) continue;
+        
+        int slot = find_cached_layer(ll->element);
+        if (slot < 0) {
+            if (g_renderer.layer_cache_count >= MAX_CACHED_LAYERS) continue;
+            slot = g_renderer.layer_cache_count++;
+            memset(&g_renderer.layer_cache[slot], 0, sizeof(CachedLayer));
+            g_renderer.layer_cache[slot].key = ll->element;
+        }
+        
+        CachedLayer *cached = &g_renderer.layer_cache[slot];
+        cached->last_frame = frame;
         
-        /* Update UI tree bounds for hit testing */
+        /* Render target must match the layer size */
+        if (cached->layer && (cached->layer->width != width ||
+                              cached->layer->height != height)) {
+            minirend_compositor_destroy_layer(g_renderer.compositor, cached->layer);
+            cached->layer = NULL;
+        }
+        if (!cached->layer) {
+            cached->layer = minirend_compositor_create_layer(g_renderer.compositor,
+                                                             width, height);
+            cached->valid = false;
+            if (!cached->layer) {
+                g_renderer.layer_cache[slot] =
+                    g_renderer.layer_cache[--g_renderer.layer_cache_count];
+                continue;
+            }
+        }
+        
+        /* Compositing properties never invalidate the texture */
+        MinirendLayer *layer = cached->layer;
+        layer->x = ll->x;
+        layer->y = ll->y;
+        layer->opacity = ll->opacity;
+        layer->transform = minirend_transform_identity();
+        if (ll->has_transform) {
+            memcpy(layer->transform.m, ll->transform, sizeof(layer->transform.m));
+        }
+        layer->transform_origin_x = ll->width * 0.5f;
+        layer->transform_origin_y = ll->height * 0.5f;
+        
+        if (!cached->valid || cached->content_hash != hashes[i]) {
+            cached->content_hash = hashes[i];
+            repaint_layer(cached, i, ll, nodes, node_count);
+        }
+        
+        g_renderer.layer_slot[i] = slot;
+    }
+    
+    g_renderer.layers_ready = true;
+}
+
+void minirend_renderer_draw(MinirendApp *app) {
+    (void)app;
+    
+    if (!g_renderer.initialized) return;
+    if (!g_renderer.doc || !g_renderer.style_resolver) return;
+    
+    /* Recompute layout if dirty */
+    ensure_layout();
+    
+    /* Get layout nodes */
+    int node_count = 0;
+    const MinirendLayoutNode *nodes = minirend_layout_get_nodes(
+        g_renderer.layout_engine, &node_count);
+    
+    if (!nodes || node_count == 0) return;
+    
+    /* Cached layers are only usable if they were updated for this layout */
+    bool use_layers = g_renderer.layers_ready && g_renderer.compositor;
+    g_renderer.layers_ready = false;
+    
+    /* Headless: start from a cleared target (same color as the window pass) */
+    if (g_renderer.soft_raster) {
+        minirend_soft_raster_clear(g_renderer.soft_raster, 0.1f, 0.1f, 0.12f, 1.0f);
+    }
+    
+    /* Begin rendering */
+    if (g_renderer.box_renderer) {
+        minirend_box_renderer_begin(g_renderer.box_renderer,
+                                    g_renderer.viewport_width,
+                                    g_renderer.viewport_height);
+    }
+    if (g_renderer.text_renderer) {
+        minirend_text_renderer_begin(g_renderer.text_renderer,
+                                     g_renderer.viewport_width,
+                                     g_renderer.viewport_height);
+    }
+    if (use_layers) {
+        minirend_compositor_begin(g_renderer.compositor,
+                                  g_renderer.viewport_width,
+                                  g_renderer.viewport_height);
+    }
+    
+    /* Draw layout nodes */
+    paint_list(nodes, node_count, -1, use_layers, 0.0f, 0.0f);
+    
+    /* Update UI tree bounds for hit testing */
+    minirend_ui_tree_begin_bounds();
+    for (int i = 0; i < node_count; i++) {
+        const MinirendLayoutNode *node = &nodes[i];
         if (node->node_id > 0) {
             MinirendRect bounds = {
                 .x = node->x,
@@ -381,6 +1026,7 @@ void minirend_renderer_draw(MinirendApp *app) {
             minirend_ui_tree_set_bounds(node->node_id, bounds);
         }
     }
+    minirend_ui_tree_end_bounds();
     
     /* End rendering */
     if (g_renderer.box_renderer) {
@@ -389,6 +1035,36 @@ void minirend_renderer_draw(MinirendApp *app) {
     if (g_renderer.text_renderer) {
         minirend_text_renderer_end(g_renderer.text_renderer);
     }
+    if (use_layers) {
+        minirend_compositor_end(g_renderer.compositor);
+    }
+    if (g_renderer.soft_raster) {
+        minirend_soft_raster_flush(g_renderer.soft_raster);
+    }
+    
+    /* Glyphs used this frame (layers included) may be evicted from now on */
+    if (g_renderer.font_cache) {
+        minirend_font_cache_end_frame(g_renderer.font_cache);
+    }
+}
+
+bool minirend_renderer_write_png(const char *path) {
+    if (!g_renderer.soft_raster) {
+        fprintf(stderr, "[renderer] PNG output requires headless mode\n");
+        return false;
+    }
+    
+    if (!minirend_soft_raster_write_png(g_renderer.soft_raster, path)) {
+        fprintf(stderr, "[renderer] Failed to write PNG: %s\n", path);
+        return false;
+    }
+    
+    MinirendSoftRasterStats stats;
+    minirend_soft_raster_get_stats(g_renderer.soft_raster, &stats);
+    fprintf(stderr, "[renderer] Wrote %s (%llu quads, %llu pixels, %.2f ms raster)\n",
+            path, (unsigned long long)stats.commands,
+            (unsigned long long)stats.pixels, stats.total_ms);
+    return true;
 }
 
 /* ============================================================================
@@ -400,6 +1076,33 @@ int minirend_renderer_load_font(const char *path) {
     return minirend_font_cache_load_font(g_renderer.font_cache, path);
 }
 
+int minirend_renderer_register_font(const char *family, const char *path,
+                                    int weight, bool italic) {
+    if (!g_renderer.font_cache) return -1;
+    return minirend_font_cache_register_face(g_renderer.font_cache, family, path,
+                                             weight, italic);
+}
+
+bool minirend_renderer_add_fallback_font(const char *path) {
+    if (!g_renderer.font_cache) return false;
+    
+    /* Mapped only once a codepoint actually needs it */
+    int font_id = minirend_font_cache_register_face(g_renderer.font_cache, NULL, path,
+                                                    400, false);
+    if (font_id < 0) return false;
+    return minirend_font_cache_add_fallback(g_renderer.font_cache, font_id);
+}
+
+void minirend_renderer_set_sdf_text(bool enabled) {
+    if (!g_renderer.font_cache) return;
+    minirend_font_cache_set_sdf(g_renderer.font_cache, enabled);
+    
+    /* Cached layers hold text rasterized in the previous mode */
+    for (int i = 0; i < g_renderer.layer_cache_count; i++) {
+        g_renderer.layer_cache[i].valid = false;
+    }
+}
+
 /* ============================================================================
  * Stylesheet Management
  * ============================================================================ */
@@ -409,7 +1112,7 @@ bool minirend_renderer_add_stylesheet(const char *css, size_t len) {
     
     bool ok = minirend_style_resolver_add_stylesheet(g_renderer.style_resolver, css, len);
     if (ok) {
-        g_renderer.layout_dirty = true;
+        g_renderer.style_dirty = true;
     }
     return ok;
 }
@@ -0,0 +1,810 @@
+/*
+ * Soft Raster Implementation
+ *
+ * Tile-binned, multi-threaded CPU rasterization of axis-aligned quads.
+ */
+
+#include "soft_raster.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define TILE_SIZE 64
+#define MAX_THREADS 16
+#define INITIAL_COMMANDS 1024
+
+/* ============================================================================
+ * Internal Types
+ * ============================================================================ */
+
+typedef enum {
+    CMD_FILL = 0,
+    CMD_COVERAGE,
+    CMD_SDF,
+} CommandType;
+
+typedef struct {
+    uint8_t  type;
+    bool     opaque;
+
+    /* Covered pixels [px0, px1) x [py0, py1), already scissored */
+    int      px0, py0, px1, py1;
+
+    /* Quad and texture mapping (CMD_COVERAGE, CMD_SDF) */
+    float    x0, y0, x1, y1;
+    float    u0, v0, u1, v1;
+    const uint8_t *atlas;
+    int      atlas_size;
+    float    sdf_edge;  /* Smoothing half-width (CMD_SDF) */
+
+    float    z;
+    uint8_t  color[4];  /* RGBA8, straight alpha */
+} SoftCommand;
+
+typedef struct {
+    int *items;
+    int  count;
+    int  capacity;
+} TileBin;
+
+struct MinirendSoftRaster {
+    /* Target */
+    int       width;
+    int       height;
+    uint8_t  *color;    /* RGBA8 */
+    float    *depth;
+
+    /* Scissor (x0, y0, x1, y1) */
+    int       scissor[4];
+
+    /* Queued commands */
+    SoftCommand *cmds;
+    int          cmd_count;
+    int          cmd_capacity;
+
+    /* Tile bins (command indices in submission order) */
+    TileBin  *bins;
+    int       tiles_x;
+    int       tiles_y;
+
+    /* Worker pool; the flushing thread also shades tiles */
+    pthread_t       threads[MAX_THREADS];
+    int             worker_count;
+    pthread_mutex_t lock;
+    pthread_cond_t  work_cond;
+    pthread_cond_t  done_cond;
+    uint64_t        generation;
+    int             busy_workers;
+    bool            quit;
+    atomic_int      next_tile;
+    atomic_ullong   pixels;
+
+    MinirendSoftRasterStats stats;
+};
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static uint8_t to_u8(float v) {
+    if (v <= 0.0f) return 0;
+    if (v >= 1.0f) return 255;
+    return (uint8_t)(v * 255.0f + 0.5f);
+}
+
+/* x / 255 rounded, exact for x in [0, 255 * 255] */
+static inline uint32_t div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+/* Pixel centers covered by [a, b): same rule as the GPU rasterizer */
+static int pixel_edge(float v) {
+    return (int)ceilf(v - 0.5f);
+}
+
+/* ============================================================================
+ * Span Shading
+ * ============================================================================ */
+
+static inline void blend_pixel(uint8_t *dst, const uint8_t *src, uint32_t a) {
+    uint32_t inv = 255 - a;
+    dst[0] = (uint8_t)div255(dst[0] * inv + src[0] * a);
+    dst[1] = (uint8_t)div255(dst[1] * inv + src[1] * a);
+    dst[2] = (uint8_t)div255(dst[2] * inv + src[2] * a);
+    dst[3] = (uint8_t)div255(dst[3] * inv + 255 * a);
+}
+
+static void fill_span(uint8_t *dst, float *depth, int n, const SoftCommand *cmd) {
+    const uint8_t *c = cmd->color;
+    float z = cmd->z;
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128 z4 = _mm_set1_ps(z);
+
+    if (cmd->opaque) {
+        uint32_t packed;
+        memcpy(&packed, c, 4);
+        __m128i src = _mm_set1_epi32((int)packed);
+
+        for (; i + 4 <= n; i += 4) {
+            __m128 d = _mm_loadu_ps(depth + i);
+            __m128 pass = _mm_cmple_ps(z4, d);
+            __m128i mask = _mm_castps_si128(pass);
+            __m128i old = _mm_loadu_si128((const __m128i *)(dst + i * 4));
+
+            _mm_storeu_si128((__m128i *)(dst + i * 4),
+                _mm_or_si128(_mm_and_si128(mask, src), _mm_andnot_si128(mask, old)));
+            _mm_storeu_ps(depth + i,
+                _mm_or_ps(_mm_and_ps(pass, z4), _mm_andnot_ps(pass, d)));
+        }
+    } else {
+        uint32_t a = c[3];
+        __m128i zero = _mm_setzero_si128();
+        __m128i inv = _mm_set1_epi16((short)(255 - a));
+        __m128i add = _mm_set_epi16((short)(255 * a), (short)(c[2] * a),
+                                    (short)(c[1] * a), (short)(c[0] * a),
+                                    (short)(255 * a), (short)(c[2] * a),
+                                    (short)(c[1] * a), (short)(c[0] * a));
+        __m128i round = _mm_set1_epi16(128);
+
+        for (; i + 4 <= n; i += 4) {
+            __m128 pass = _mm_cmple_ps(z4, _mm_loadu_ps(depth + i));
+            __m128i mask = _mm_castps_si128(pass);
+            __m128i old = _mm_loadu_si128((const __m128i *)(dst + i * 4));
+
+            /* dst * (255 - a) + src * a, then / 255 in 16-bit lanes */
+            __m128i lo = _mm_unpacklo_epi8(old, zero);
+            __m128i hi = _mm_unpackhi_epi8(old, zero);
+            lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, inv), add), round);
+            hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, inv), add), round);
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+            __m128i blended = _mm_packus_epi16(lo, hi);
+
+            _mm_storeu_si128((__m128i *)(dst + i * 4),
+                _mm_or_si128(_mm_and_si128(mask, blended), _mm_andnot_si128(mask, old)));
+        }
+    }
+#endif
+
+    /* Remainder (or everything without SSE2) */
+    for (; i < n; i++) {
+        if (!(z <= depth[i])) continue;
+
+        uint8_t *p = dst + i * 4;
+        if (cmd->opaque) {
+            memcpy(p, c, 4);
+            depth[i] = z;
+        } else {
+            blend_pixel(p, c, c[3]);
+        }
+    }
+}
+
+static void coverage_span(uint8_t *dst, float *depth, int px, int py, int n,
+                          const SoftCommand *cmd) {
+    const uint8_t *c = cmd->color;
+    float z = cmd->z;
+    int size = cmd->atlas_size;
+
+    /* Nearest sampling at pixel centers */
+    float du = (cmd->u1 - cmd->u0) / (cmd->x1 - cmd->x0);
+    float dv = (cmd->v1 - cmd->v0) / (cmd->y1 - cmd->y0);
+    float v = cmd->v0 + ((float)py + 0.5f - cmd->y0) * dv;
+    int ty = (int)(v * (float)size);
+    if (ty < 0) ty = 0;
+    if (ty >= size) ty = size - 1;
+    const uint8_t *row = cmd->atlas + (size_t)ty * (size_t)size;
+
+    float u = cmd->u0 + ((float)px + 0.5f - cmd->x0) * du;
+
+    for (int i = 0; i < n; i++, u += du) {
+        if (!(z <= depth[i])) continue;
+
+        int tx = (int)(u * (float)size);
+        if (tx < 0) tx = 0;
+        if (tx >= size) tx = size - 1;
+
+        uint32_t cov = row[tx];
+        if (cmd->type == CMD_SDF) {
+            /* smoothstep(0.5 - e, 0.5 + e, d), as in the text shader */
+            float t = ((float)cov / 255.0f - 0.5f + cmd->sdf_edge) /
+                      (2.0f * cmd->sdf_edge);
+            if (t <= 0.0f) continue;
+            if (t > 1.0f) t = 1.0f;
+            cov = (uint32_t)(t * t * (3.0f - 2.0f * t) * 255.0f + 0.5f);
+        }
+
+        uint32_t a = div255(cov * c[3]);
+        if (a == 0) continue;
+
+        blend_pixel(dst + i * 4, c, a);
+    }
+}
+
+/* ============================================================================
+ * Tile Shading
+ * ============================================================================ */
+
+static uint64_t shade_tile(MinirendSoftRaster *sr, int tile) {
+    int tx0 = (tile % sr->tiles_x) * TILE_SIZE;
+    int ty0 = (tile / sr->tiles_x) * TILE_SIZE;
+    int tx1 = tx0 + TILE_SIZE < sr->width ? tx0 + TILE_SIZE : sr->width;
+    int ty1 = ty0 + TILE_SIZE < sr->height ? ty0 + TILE_SIZE : sr->height;
+    uint64_t pixels = 0;
+
+    const TileBin *bin = &sr->bins[tile];
+    for (int i = 0; i < bin->count; i++) {
+        const SoftCommand *cmd = &sr->cmds[bin->items[i]];
+
+        int x0 = cmd->px0 > tx0 ? cmd->px0 : tx0;
+        int x1 = cmd->px1 < tx1 ? cmd->px1 : tx1;
+        int y0 = cmd->py0 > ty0 ? cmd->py0 : ty0;
+        int y1 = cmd->py1 < ty1 ? cmd->py1 : ty1;
+        if (x0 >= x1 || y0 >= y1) continue;
+
+        for (int y = y0; y < y1; y++) {
+            size_t offset = (size_t)y * (size_t)sr->width + (size_t)x0;
+            uint8_t *dst = sr->color + offset * 4;
+            float *depth = sr->depth + offset;
+
+            if (cmd->type == CMD_FILL) {
+                fill_span(dst, depth, x1 - x0, cmd);
+            } else {
+                coverage_span(dst, depth, x0, y, x1 - x0, cmd);
+            }
+        }
+        pixels += (uint64_t)(x1 - x0) * (uint64_t)(y1 - y0);
+    }
+
+    return pixels;
+}
+
+static void shade_tiles(MinirendSoftRaster *sr) {
+    int tile_count = sr->tiles_x * sr->tiles_y;
+    uint64_t pixels = 0;
+
+    for (;;) {
+        int tile = atomic_fetch_add(&sr->next_tile, 1);
+        if (tile >= tile_count) break;
+        pixels += shade_tile(sr, tile);
+    }
+
+    atomic_fetch_add(&sr->pixels, pixels);
+}
+
+static void *worker_main(void *arg) {
+    MinirendSoftRaster *sr = arg;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&sr->lock);
+    for (;;) {
+        while (!sr->quit && sr->generation == seen) {
+            pthread_cond_wait(&sr->work_cond, &sr->lock);
+        }
+        if (sr->quit) break;
+        seen = sr->generation;
+        pthread_mutex_unlock(&sr->lock);
+
+        shade_tiles(sr);
+
+        pthread_mutex_lock(&sr->lock);
+        if (--sr->busy_workers == 0) {
+            pthread_cond_signal(&sr->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&sr->lock);
+
+    return NULL;
+}
+
+/* ============================================================================
+ * Create/Destroy
+ * ============================================================================ */
+
+static bool alloc_target(MinirendSoftRaster *sr, int width, int height) {
+    size_t pixels = (size_t)width * (size_t)height;
+    int tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    int tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    uint8_t *color = malloc(pixels * 4);
+    float *depth = malloc(pixels * sizeof(float));
+    TileBin *bins = calloc((size_t)tiles_x * (size_t)tiles_y, sizeof(TileBin));
+    if (!color || !depth || !bins) {
+        free(color);
+        free(depth);
+        free(bins);
+        return false;
+    }
+
+    if (sr->bins) {
+        for (int i = 0; i < sr->tiles_x * sr->tiles_y; i++) {
+            free(sr->bins[i].items);
+        }
+    }
+    free(sr->bins);
+    free(sr->color);
+    free(sr->depth);
+
+    sr->color = color;
+    sr->depth = depth;
+    sr->bins = bins;
+    sr->width = width;
+    sr->height = height;
+    sr->tiles_x = tiles_x;
+    sr->tiles_y = tiles_y;
+    minirend_soft_raster_clear_scissor(sr);
+    return true;
+}
+
+MinirendSoftRaster *minirend_soft_raster_create(int width, int height,
+                                                int thread_count) {
+    if (width <= 0 || height <= 0) return NULL;
+
+    MinirendSoftRaster *sr = calloc(1, sizeof(MinirendSoftRaster));
+    if (!sr) return NULL;
+
+    sr->cmd_capacity = INITIAL_COMMANDS;
+    sr->cmds = malloc(sr->cmd_capacity * sizeof(SoftCommand));
+    if (!sr->cmds || !alloc_target(sr, width, height)) {
+        free(sr->cmds);
+        free(sr);
+        return NULL;
+    }
+    minirend_soft_raster_clear(sr, 0.0f, 0.0f, 0.0f, 0.0f);
+
+    pthread_mutex_init(&sr->lock, NULL);
+    pthread_cond_init(&sr->work_cond, NULL);
+    pthread_cond_init(&sr->done_cond, NULL);
+    atomic_init(&sr->next_tile, 0);
+    atomic_init(&sr->pixels, 0);
+
+    if (thread_count <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpus > 0 ? (int)cpus : 1;
+    }
+    if (thread_count > MAX_THREADS) thread_count = MAX_THREADS;
+
+    /* The flushing thread is one of the shaders */
+    for (int i = 0; i < thread_count - 1; i++) {
+        if (pthread_create(&sr->threads[i], NULL, worker_main, sr) != 0) break;
+        sr->worker_count++;
+    }
+
+    return sr;
+}
+
+void minirend_soft_raster_destroy(MinirendSoftRaster *sr) {
+    if (!sr) return;
+
+    pthread_mutex_lock(&sr->lock);
+    sr->quit = true;
+    pthread_cond_broadcast(&sr->work_cond);
+    pthread_mutex_unlock(&sr->lock);
+
+    for (int i = 0; i < sr->worker_count; i++) {
+        pthread_join(sr->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&sr->done_cond);
+    pthread_cond_destroy(&sr->work_cond);
+    pthread_mutex_destroy(&sr->lock);
+
+    for (int i = 0; i < sr->tiles_x * sr->tiles_y; i++) {
+        free(sr->bins[i].items);
+    }
+    free(sr->bins);
+    free(sr->cmds);
+    free(sr->color);
+    free(sr->depth);
+    free(sr);
+}
+
+bool minirend_soft_raster_resize(MinirendSoftRaster *sr, int width, int height) {
+    if (!sr || width <= 0 || height <= 0) return false;
+    if (width == sr->width && height == sr->height) return true;
+
+    sr->cmd_count = 0;
+    return alloc_target(sr, width, height);
+}
+
+void minirend_soft_raster_clear(MinirendSoftRaster *sr,
+                                float r, float g, float b, float a) {
+    if (!sr) return;
+
+    uint8_t c[4] = { to_u8(r), to_u8(g), to_u8(b), to_u8(a) };
+    size_t pixels = (size_t)sr->width * (size_t)sr->height;
+
+    for (size_t i = 0; i < pixels; i++) {
+        memcpy(sr->color + i * 4, c, 4);
+        sr->depth[i] = 1.0f;
+    }
+
+    sr->cmd_count = 0;
+}
+
+/* ============================================================================
+ * Commands
+ * ============================================================================ */
+
+void minirend_soft_raster_set_scissor(MinirendSoftRaster *sr,
+                                      int x, int y, int width, int height) {
+    if (!sr) return;
+
+    int x1 = x + width;
+    int y1 = y + height;
+    sr->scissor[0] = x < 0 ? 0 : x;
+    sr->scissor[1] = y < 0 ? 0 : y;
+    sr->scissor[2] = x1 > sr->width ? sr->width : x1;
+    sr->scissor[3] = y1 > sr->height ? sr->height : y1;
+}
+
+void minirend_soft_raster_clear_scissor(MinirendSoftRaster *sr) {
+    if (!sr) return;
+
+    sr->scissor[0] = 0;
+    sr->scissor[1] = 0;
+    sr->scissor[2] = sr->width;
+    sr->scissor[3] = sr->height;
+}
+
+/* Append a command covering [x0, x1) x [y0, y1), clipped to the scissor.
+ * Returns NULL when nothing is covered. */
+static SoftCommand *push_command(MinirendSoftRaster *sr,
+                                 float x0, float y0, float x1, float y1) {
+    int px0 = pixel_edge(x0);
+    int py0 = pixel_edge(y0);
+    int px1 = pixel_edge(x1);
+    int py1 = pixel_edge(y1);
+
+    if (px0 < sr->scissor[0]) px0 = sr->scissor[0];
+    if (py0 < sr->scissor[1]) py0 = sr->scissor[1];
+    if (px1 > sr->scissor[2]) px1 = sr->scissor[2];
+    if (py1 > sr->scissor[3]) py1 = sr->scissor[3];
+    if (px0 >= px1 || py0 >= py1) return NULL;
+
+    if (sr->cmd_count >= sr->cmd_capacity) {
+        int new_cap = sr->cmd_capacity * 2;
+        SoftCommand *cmds = realloc(sr->cmds, new_cap * sizeof(SoftCommand));
+        if (!cmds) return NULL;
+
+        sr->cmds = cmds;
+        sr->cmd_capacity = new_cap;
+    }
+
+    SoftCommand *cmd = &sr->cmds[sr->cmd_count++];
+    memset(cmd, 0, sizeof(*cmd));
+    cmd->px0 = px0;
+    cmd->py0 = py0;
+    cmd->px1 = px1;
+    cmd->py1 = py1;
+    cmd->x0 = x0;
+    cmd->y0 = y0;
+    cmd->x1 = x1;
+    cmd->y1 = y1;
+    return cmd;
+}
+
+void minirend_soft_raster_fill_rect(MinirendSoftRaster *sr,
+                                    float x0, float y0, float x1, float y1,
+                                    float z, bool opaque,
+                                    float r, float g, float b, float a) {
+    if (!sr) return;
+    if (!opaque && a <= 0.0f) return;
+
+    SoftCommand *cmd = push_command(sr, x0, y0, x1, y1);
+    if (!cmd) return;
+
+    cmd->type = CMD_FILL;
+    cmd->opaque = opaque;
+    cmd->z = z;
+    cmd->color[0] = to_u8(r);
+    cmd->color[1] = to_u8(g);
+    cmd->color[2] = to_u8(b);
+    cmd->color[3] = opaque ? 255 : to_u8(a);
+}
+
+static SoftCommand *push_textured(MinirendSoftRaster *sr,
+                                  float x0, float y0, float x1, float y1,
+                                  float u0, float v0, float u1, float v1,
+                                  const uint8_t *atlas, int atlas_size,
+                                  float z,
+                                  float r, float g, float b, float a) {
+    if (!sr || !atlas || atlas_size <= 0 || a <= 0.0f) return NULL;
+    if (x1 <= x0 || y1 <= y0) return NULL;
+
+    SoftCommand *cmd = push_command(sr, x0, y0, x1, y1);
+    if (!cmd) return NULL;
+
+    cmd->type = CMD_COVERAGE;
+    cmd->u0 = u0;
+    cmd->v0 = v0;
+    cmd->u1 = u1;
+    cmd->v1 = v1;
+    cmd->atlas = atlas;
+    cmd->atlas_size = atlas_size;
+    cmd->z = z;
+    cmd->color[0] = to_u8(r);
+    cmd->color[1] = to_u8(g);
+    cmd->color[2] = to_u8(b);
+    cmd->color[3] = to_u8(a);
+    return cmd;
+}
+
+void minirend_soft_raster_draw_coverage(MinirendSoftRaster *sr,
+                                        float x0, float y0, float x1, float y1,
+                                        float u0, float v0, float u1, float v1,
+                                        const uint8_t *atlas, int atlas_size,
+                                        float z,
+                                        float r, float g, float b, float a) {
+    push_textured(sr, x0, y0, x1, y1, u0, v0, u1, v1, atlas, atlas_size,
+                  z, r, g, b, a);
+}
+
+void minirend_soft_raster_draw_sdf(MinirendSoftRaster *sr,
+                                   float x0, float y0, float x1, float y1,
+                                   float u0, float v0, float u1, float v1,
+                                   const uint8_t *atlas, int atlas_size,
+                                   float edge, float z,
+                                   float r, float g, float b, float a) {
+    if (edge <= 0.0f) return;
+
+    SoftCommand *cmd = push_textured(sr, x0, y0, x1, y1, u0, v0, u1, v1,
+                                     atlas, atlas_size, z, r, g, b, a);
+    if (!cmd) return;
+
+    cmd->type = CMD_SDF;
+    cmd->sdf_edge = edge;
+}
+
+/* ============================================================================
+ * Flush
+ * ============================================================================ */
+
+static bool bin_push(TileBin *bin, int index) {
+    if (bin->count >= bin->capacity) {
+        int new_cap = bin->capacity ? bin->capacity * 2 : 64;
+        int *items = realloc(bin->items, new_cap * sizeof(int));
+        if (!items) return false;
+
+        bin->items = items;
+        bin->capacity = new_cap;
+    }
+
+    bin->items[bin->count++] = index;
+    return true;
+}
+
+void minirend_soft_raster_flush(MinirendSoftRaster *sr) {
+    if (!sr || sr->cmd_count == 0) return;
+
+    double start = now_ms();
+    int tile_count = sr->tiles_x * sr->tiles_y;
+
+    /* Bin commands into the tiles they touch, keeping submission order */
+    for (int t = 0; t < tile_count; t++) {
+        sr->bins[t].count = 0;
+    }
+    for (int i = 0; i < sr->cmd_count; i++) {
+        const SoftCommand *cmd = &sr->cmds[i];
+        int bx0 = cmd->px0 / TILE_SIZE;
+        int by0 = cmd->py0 / TILE_SIZE;
+        int bx1 = (cmd->px1 - 1) / TILE_SIZE;
+        int by1 = (cmd->py1 - 1) / TILE_SIZE;
+
+        for (int by = by0; by <= by1; by++) {
+            for (int bx = bx0; bx <= bx1; bx++) {
+                bin_push(&sr->bins[by * sr->tiles_x + bx], i);
+            }
+        }
+    }
+
+    atomic_store(&sr->next_tile, 0);
+    atomic_store(&sr->pixels, 0);
+
+    /* Wake the workers and shade alongside them */
+    if (sr->worker_count > 0) {
+        pthread_mutex_lock(&sr->lock);
+        sr->busy_workers = sr->worker_count;
+        sr->generation++;
+        pthread_cond_broadcast(&sr->work_cond);
+        pthread_mutex_unlock(&sr->lock);
+    }
+
+    shade_tiles(sr);
+
+    if (sr->worker_count > 0) {
+        pthread_mutex_lock(&sr->lock);
+        while (sr->busy_workers > 0) {
+            pthread_cond_wait(&sr->done_cond, &sr->lock);
+        }
+        pthread_mutex_unlock(&sr->lock);
+    }
+
+    double elapsed = now_ms() - start;
+    sr->stats.commands += (uint64_t)sr->cmd_count;
+    sr->stats.pixels += atomic_load(&sr->pixels);
+    sr->stats.flushes++;
+    sr->stats.last_flush_ms = elapsed;
+    sr->stats.total_ms += elapsed;
+
+    sr->cmd_count = 0;
+}
+
+/* ============================================================================
+ * Output
+ * ============================================================================ */
+
+const uint8_t *minirend_soft_raster_pixels(const MinirendSoftRaster *sr,
+                                           int *out_width, int *out_height) {
+    if (!sr) {
+        if (out_width) *out_width = 0;
+        if (out_height) *out_height = 0;
+        return NULL;
+    }
+
+    if (out_width) *out_width = sr->width;
+    if (out_height) *out_height = sr->height;
+    return sr->color;
+}
+
+void minirend_soft_raster_get_stats(const MinirendSoftRaster *sr,
+                                    MinirendSoftRasterStats *out_stats) {
+    if (!out_stats) return;
+
+    if (!sr) {
+        memset(out_stats, 0, sizeof(*out_stats));
+        return;
+    }
+
+    *out_stats = sr->stats;
+}
+
+/* ============================================================================
+ * PNG Writer (uncompressed deflate, no external dependencies)
+ * ============================================================================ */
+
+static uint32_t g_crc_table[256];
+static bool     g_crc_ready = false;
+
+static void crc_init(void) {
+    if (g_crc_ready) return;
+
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        g_crc_table[n] = c;
+    }
+    g_crc_ready = true;
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc = g_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void put_u32be(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static bool write_chunk(FILE *f, const char *type, const uint8_t *data, size_t len) {
+    uint8_t header[8];
+    put_u32be(header, (uint32_t)len);
+    memcpy(header + 4, type, 4);
+
+    uint32_t crc = crc_update(0xFFFFFFFFu, header + 4, 4);
+    crc = crc_update(crc, data, len) ^ 0xFFFFFFFFu;
+
+    uint8_t trailer[4];
+    put_u32be(trailer, crc);
+
+    return fwrite(header, 1, 8, f) == 8 &&
+           (len == 0 || fwrite(data, 1, len, f) == len) &&
+           fwrite(trailer, 1, 4, f) == 4;
+}
+
+bool minirend_soft_raster_write_png(const MinirendSoftRaster *sr, const char *path) {
+    if (!sr || !path) return false;
+
+    crc_init();
+
+    /* Raw scanlines: filter byte 0 + RGBA row */
+    size_t row_len = 1 + (size_t)sr->width * 4;
+    size_t raw_len = row_len * (size_t)sr->height;
+    size_t block_count = (raw_len + 65534) / 65535;
+    size_t zlib_len = 2 + raw_len + block_count * 5 + 4;
+
+    uint8_t *zlib = malloc(zlib_len);
+    if (!zlib) return false;
+
+    /* zlib stream of stored deflate blocks */
+    uint8_t *p = zlib;
+    *p++ = 0x78;
+    *p++ = 0x01;
+
+    uint32_t adler_a = 1, adler_b = 0;
+    size_t remaining = raw_len;
+    size_t row = 0, col = 0;  /* Position within the raw scanline stream */
+
+    while (remaining > 0) {
+        size_t block = remaining < 65535 ? remaining : 65535;
+        remaining -= block;
+
+        *p++ = remaining == 0 ? 1 : 0;  /* BFINAL, BTYPE = stored */
+        *p++ = (uint8_t)(block & 0xFF);
+        *p++ = (uint8_t)(block >> 8);
+        *p++ = (uint8_t)(~block & 0xFF);
+        *p++ = (uint8_t)((~block >> 8) & 0xFF);
+
+        for (size_t i = 0; i < block; i++) {
+            uint8_t byte = col == 0 ? 0
+                : sr->color[row * (size_t)sr->width * 4 + (col - 1)];
+            if (++col == row_len) {
+                col = 0;
+                row++;
+            }
+
+            *p++ = byte;
+            adler_a = (adler_a + byte) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+    }
+
+    put_u32be(p, (adler_b << 16) | adler_a);
+
+    /* IHDR: width, height, 8-bit RGBA, no interlace */
+    uint8_t ihdr[13];
+    put_u32be(ihdr, (uint32_t)sr->width);
+    put_u32be(ihdr + 4, (uint32_t)sr->height);
+    ihdr[8] = 8;
+    ihdr[9] = 6;
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        free(zlib);
+        return false;
+    }
+
+    bool ok = fwrite(signature, 1, 8, f) == 8 &&
+              write_chunk(f, "IHDR", ihdr, sizeof(ihdr)) &&
+              write_chunk(f, "IDAT", zlib, zlib_len) &&
+              write_chunk(f, "IEND", NULL, 0);
+
+    free(zlib);
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
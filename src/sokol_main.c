@@ -28,6 +28,7 @@
 #include "dom_runtime.h"
 #include "ui_tree.h"
 #include "lexbor_adapter.h"
+#include "atlas_baker.h"
 
 /* =========================================================================
  * Application State
@@ -182,7 +183,8 @@ static void init_cb(void) {
     /* Load entry files */
     if (g_state.config.entry_html_path) {
         fprintf(stderr, "[minirend] HTML entry: %s\n", g_state.config.entry_html_path);
-        /* TODO: minirend_renderer_load_html(NULL, g_state.config.entry_html_path); */
+        /* TODO: minirend_renderer_load_html(NULL, g_state.config.entry_html_path);
+         * (before minirend_dom_init, which binds the renderer's document) */
     }
     
     if (g_state.config.entry_js_path) {
@@ -209,6 +211,12 @@ static void frame_cb(void) {
         minirend_js_tick_frame(g_state.js_ctx);
     }
 
+    /* Settle promise jobs, then apply the frame's DOM mutations in one go */
+    if (g_state.js_ctx) {
+        minirend_js_run_microtasks(g_state.js_ctx);
+        minirend_dom_flush(g_state.js_ctx);
+    }
+
     /* Tick audio engine (feeds saudio_push) */
     minirend_audio_tick();
     
@@ -219,7 +227,9 @@ static void frame_cb(void) {
     };
     sg_begin_pass(&pass);
     
-    /* TODO: Render HTML/CSS content here */
+    /* TODO: Render HTML/CSS content here; call
+     * minirend_renderer_update_layers first, before sg_begin_pass, since
+     * its offscreen passes cannot nest. */
     /* minirend_renderer_draw(NULL); */
     
     sg_end_pass();
@@ -232,7 +242,7 @@ static void cleanup_cb(void) {
     /* Tear down subsystems that hold JS refs before destroying the JS context. */
     if (g_state.js_ctx) {
         minirend_input_shutdown(g_state.js_ctx);
-        minirend_dom_runtime_shutdown(g_state.js_ctx);
+        minirend_dom_shutdown(g_state.js_ctx);
     }
     minirend_audio_shutdown();
     minirend_lexbor_adapter_shutdown();
@@ -287,6 +297,28 @@ static void event_cb(const sapp_event *ev) {
     }
 }
 
+/* =========================================================================
+ * Headless Screenshot
+ * ========================================================================= */
+
+/* Render an HTML file with the CPU rasterizer and write it as a PNG.
+ * Needs no window or GPU:  minirend --screenshot out.png [page.html] */
+static int run_screenshot(const char *png_path, const char *html_path) {
+    fprintf(stderr, "[minirend] Headless render: %s -> %s (%dx%d)\n",
+            html_path, png_path, g_state.config.width, g_state.config.height);
+    
+    minirend_lexbor_adapter_init();
+    minirend_renderer_init_headless(NULL, g_state.config.width, g_state.config.height);
+    minirend_renderer_load_html(NULL, html_path);
+    minirend_renderer_draw(NULL);
+    
+    bool ok = minirend_renderer_write_png(png_path);
+    
+    minirend_renderer_shutdown();
+    minirend_lexbor_adapter_shutdown();
+    return ok ? 0 : 1;
+}
+
 /* =========================================================================
  * Entry Point
  * ========================================================================= */
@@ -307,6 +339,17 @@ sapp_desc sokol_main(int argc, char* argv[]) {
     /* Load config from file */
     load_config(&g_state.config);
     
+    /* Headless screenshot mode never opens a window */
+    if (argc > 2 && strcmp(argv[1], "--screenshot") == 0) {
+        exit(run_screenshot(argv[2], argc > 3 ? argv[3] : "index.html"));
+    }
+    
+    /* Build step: prerasterize the app's glyphs (see the Makefile) */
+    if (argc > 4 && strcmp(argv[1], "--bake-atlas") == 0) {
+        exit(minirend_atlas_bake(argv[3], (const char *const *)&argv[4], argc - 4,
+                                 argv[2]) ? 0 : 1);
+    }
+    
     /* Set entry paths */
     if (argc > 1) {
         g_state.config.entry_html_path = argv[1];
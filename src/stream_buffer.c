@@ -0,0 +1,102 @@
+/*
+ * Stream Buffer Implementation
+ *
+ * Growable per-frame vertex stream using sg_append_buffer.
+ */
+
+#include "stream_buffer.h"
+
+#include <stdlib.h>
+
+#include "sokol_gfx.h"
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define MIN_STREAM_SIZE (64 * 1024)
+
+/* ============================================================================
+ * Stream Buffer Structure
+ * ============================================================================ */
+
+struct MinirendStreamBuffer {
+    sg_buffer buf;
+    size_t    capacity;
+};
+
+/* ============================================================================
+ * Create/Destroy
+ * ============================================================================ */
+
+static sg_buffer make_stream_buffer(size_t size) {
+    return sg_make_buffer(&(sg_buffer_desc){
+        .size = size,
+        .usage = SG_USAGE_STREAM,
+    });
+}
+
+MinirendStreamBuffer *minirend_stream_buffer_create(size_t initial_size) {
+    MinirendStreamBuffer *sb = calloc(1, sizeof(MinirendStreamBuffer));
+    if (!sb) return NULL;
+
+    sb->capacity = initial_size > MIN_STREAM_SIZE ? initial_size : MIN_STREAM_SIZE;
+    sb->buf = make_stream_buffer(sb->capacity);
+    if (sb->buf.id == SG_INVALID_ID) {
+        free(sb);
+        return NULL;
+    }
+
+    return sb;
+}
+
+void minirend_stream_buffer_destroy(MinirendStreamBuffer *sb) {
+    if (!sb) return;
+
+    sg_destroy_buffer(sb->buf);
+    free(sb);
+}
+
+/* ============================================================================
+ * Appending
+ * ============================================================================ */
+
+/* Replace the buffer with one that can hold at least `needed` bytes.
+ * Segments already appended this frame stay valid for the draws that
+ * reference them; the backends keep the old storage alive until the GPU
+ * is done with it. */
+static bool grow(MinirendStreamBuffer *sb, size_t needed) {
+    size_t new_cap = sb->capacity;
+    while (new_cap < needed) new_cap *= 2;
+    new_cap *= 2;
+
+    sg_buffer nb = make_stream_buffer(new_cap);
+    if (nb.id == SG_INVALID_ID) return false;
+
+    sg_destroy_buffer(sb->buf);
+    sb->buf = nb;
+    sb->capacity = new_cap;
+    return true;
+}
+
+bool minirend_stream_buffer_append(MinirendStreamBuffer *sb,
+                                   const void *data, size_t size,
+                                   uint32_t *out_buffer, int *out_offset) {
+    if (!sb || !data || size == 0) return false;
+
+    /* Out of room for this frame: continue in a larger buffer */
+    if (sg_query_buffer_will_overflow(sb->buf, size)) {
+        if (!grow(sb, size)) return false;
+    }
+
+    int offset = sg_append_buffer(sb->buf, &(sg_range){ .ptr = data, .size = size });
+    if (sg_query_buffer_overflow(sb->buf)) return false;
+
+    if (out_buffer) *out_buffer = sb->buf.id;
+    if (out_offset) *out_offset = offset;
+    return true;
+}
+
+size_t minirend_stream_buffer_capacity(const MinirendStreamBuffer *sb) {
+    return sb ? sb->capacity : 0;
+}
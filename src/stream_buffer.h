@@ -0,0 +1,44 @@
+#ifndef MINIREND_STREAM_BUFFER_H
+#define MINIREND_STREAM_BUFFER_H
+
+/*
+ * Stream Buffer - Per-frame streaming vertex ring built on sg_append_buffer.
+ *
+ * sokol_gfx allows a single sg_update_buffer per buffer per frame, but any
+ * number of sg_append_buffer calls. Each batch flush appends its vertices
+ * as a new segment and binds it through the returned offset, so renderers
+ * may flush as often as they need (scissor changes, batch overflow, ...).
+ *
+ * When a frame needs more space than the buffer holds, the buffer is
+ * replaced by a larger one and the append continues there.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ============================================================================
+ * Stream Buffer Context
+ * ============================================================================ */
+
+typedef struct MinirendStreamBuffer MinirendStreamBuffer;
+
+/* Create a stream buffer. Must be called after sokol_gfx is initialized.
+ * initial_size is the starting capacity in bytes. */
+MinirendStreamBuffer *minirend_stream_buffer_create(size_t initial_size);
+
+/* Destroy the stream buffer and free GPU resources. */
+void minirend_stream_buffer_destroy(MinirendStreamBuffer *sb);
+
+/* Append a segment of vertex data for this frame.
+ * On success, out_buffer receives the sg_buffer id to bind and out_offset
+ * the byte offset of the segment within it.
+ * Returns false if the data could not be uploaded. */
+bool minirend_stream_buffer_append(MinirendStreamBuffer *sb,
+                                   const void *data, size_t size,
+                                   uint32_t *out_buffer, int *out_offset);
+
+/* Current GPU capacity in bytes. */
+size_t minirend_stream_buffer_capacity(const MinirendStreamBuffer *sb);
+
+#endif /* MINIREND_STREAM_BUFFER_H */
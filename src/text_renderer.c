@@ -6,6 +6,8 @@
 
 #include "text_renderer.h"
 #include "font_cache.h"
+#include "stream_buffer.h"
+#include "soft_raster.h"
 #include "sokol_gfx.h"
 
 #include <stdlib.h>
@@ -25,9 +27,10 @@
  * ============================================================================ */
 
 typedef struct {
-    float x, y;           /* Position */
+    float x, y, z;        /* Position, z = depth (0 nearest, 1 farthest) */
     float u, v;           /* Texture coordinates */
     float r, g, b, a;     /* Color */
+    float sdf;            /* Distance field edge width, 0 = coverage bitmap */
 } TextVertex;
 
 /* ============================================================================
@@ -37,17 +40,20 @@ typedef struct {
 static const char *text_vs_glsl330 =
     "#version 330\n"
     "uniform vec2 u_viewport;\n"
-    "in vec2 a_pos;\n"
+    "in vec3 a_pos;\n"
     "in vec2 a_uv;\n"
     "in vec4 a_color;\n"
+    "in float a_sdf;\n"
     "out vec2 v_uv;\n"
     "out vec4 v_color;\n"
+    "out float v_sdf;\n"
     "void main() {\n"
-    "    vec2 pos = a_pos / u_viewport * 2.0 - 1.0;\n"
+    "    vec2 pos = a_pos.xy / u_viewport * 2.0 - 1.0;\n"
     "    pos.y = -pos.y;\n"
-    "    gl_Position = vec4(pos, 0.0, 1.0);\n"
+    "    gl_Position = vec4(pos, a_pos.z, 1.0);\n"
     "    v_uv = a_uv;\n"
     "    v_color = a_color;\n"
+    "    v_sdf = a_sdf;\n"
     "}\n";
 
 static const char *text_fs_glsl330 =
@@ -55,26 +61,31 @@ static const char *text_fs_glsl330 =
     "uniform sampler2D u_texture;\n"
     "in vec2 v_uv;\n"
     "in vec4 v_color;\n"
+    "in float v_sdf;\n"
     "out vec4 frag_color;\n"
     "void main() {\n"
     "    float alpha = texture(u_texture, v_uv).r;\n"
+    "    if (v_sdf > 0.0) alpha = smoothstep(0.5 - v_sdf, 0.5 + v_sdf, alpha);\n"
     "    frag_color = vec4(v_color.rgb, v_color.a * alpha);\n"
     "}\n";
 
 static const char *text_vs_glsl100 =
     "#version 100\n"
     "uniform vec2 u_viewport;\n"
-    "attribute vec2 a_pos;\n"
+    "attribute vec3 a_pos;\n"
     "attribute vec2 a_uv;\n"
     "attribute vec4 a_color;\n"
+    "attribute float a_sdf;\n"
     "varying vec2 v_uv;\n"
     "varying vec4 v_color;\n"
+    "varying float v_sdf;\n"
     "void main() {\n"
-    "    vec2 pos = a_pos / u_viewport * 2.0 - 1.0;\n"
+    "    vec2 pos = a_pos.xy / u_viewport * 2.0 - 1.0;\n"
     "    pos.y = -pos.y;\n"
-    "    gl_Position = vec4(pos, 0.0, 1.0);\n"
+    "    gl_Position = vec4(pos, a_pos.z, 1.0);\n"
     "    v_uv = a_uv;\n"
     "    v_color = a_color;\n"
+    "    v_sdf = a_sdf;\n"
     "}\n";
 
 static const char *text_fs_glsl100 =
@@ -83,8 +94,10 @@ static const char *text_fs_glsl100 =
     "uniform sampler2D u_texture;\n"
     "varying vec2 v_uv;\n"
     "varying vec4 v_color;\n"
+    "varying float v_sdf;\n"
     "void main() {\n"
     "    float alpha = texture2D(u_texture, v_uv).r;\n"
+    "    if (v_sdf > 0.0) alpha = smoothstep(0.5 - v_sdf, 0.5 + v_sdf, alpha);\n"
     "    gl_FragColor = vec4(v_color.rgb, v_color.a * alpha);\n"
     "}\n";
 
@@ -94,10 +107,12 @@ static const char *text_fs_glsl100 =
 
 struct MinirendTextRenderer {
     MinirendFontCache *font_cache;  /* Borrowed, not owned */
+    MinirendSoftRaster *soft;       /* CPU backend (borrowed); NULL for sokol_gfx */
     
     sg_shader     shader;
     sg_pipeline   pipeline;
-    sg_buffer     vbuf;
+    sg_pipeline   layer_pipeline;  /* Same state, compositor layer target */
+    MinirendStreamBuffer *vstream;
     sg_buffer     ibuf;
     sg_bindings   bindings;
     sg_sampler    sampler;
@@ -105,11 +120,16 @@ struct MinirendTextRenderer {
     TextVertex   *vertices;
     int           vertex_count;
     int           glyph_count;
+    int           page;         /* Atlas page the current batch samples */
     
     float         viewport_width;
     float         viewport_height;
     
+    float         depth;
+    
     bool          in_frame;
+    bool          to_layer;
+    bool          placeholders;  /* A glyph was not final since begin */
 };
 
 /* ============================================================================
@@ -165,6 +185,7 @@ MinirendTextRenderer *minirend_text_renderer_create(MinirendFontCache *font_cach
             [0] = { .name = "a_pos" },
             [1] = { .name = "a_uv" },
             [2] = { .name = "a_color" },
+            [3] = { .name = "a_sdf" },
         },
     };
     
@@ -187,9 +208,10 @@ MinirendTextRenderer *minirend_text_renderer_create(MinirendFontCache *font_cach
         .shader = r->shader,
         .layout = {
             .attrs = {
-                [0] = { .format = SG_VERTEXFORMAT_FLOAT2 },  /* a_pos */
+                [0] = { .format = SG_VERTEXFORMAT_FLOAT3 },  /* a_pos */
                 [1] = { .format = SG_VERTEXFORMAT_FLOAT2 },  /* a_uv */
                 [2] = { .format = SG_VERTEXFORMAT_FLOAT4 },  /* a_color */
+                [3] = { .format = SG_VERTEXFORMAT_FLOAT },   /* a_sdf */
             },
         },
         .colors[0] = {
@@ -203,13 +225,19 @@ MinirendTextRenderer *minirend_text_renderer_create(MinirendFontCache *font_cach
         },
         .depth = {
             .write_enabled = false,
-            .compare = SG_COMPAREFUNC_ALWAYS,
+            .compare = SG_COMPAREFUNC_LESS_EQUAL,
         },
         .primitive_type = SG_PRIMITIVETYPE_TRIANGLES,
     };
     
     r->pipeline = sg_make_pipeline(&pipeline_desc);
     
+    /* Layer passes render into single-sampled RGBA8 + depth targets */
+    pipeline_desc.sample_count = 1;
+    pipeline_desc.colors[0].pixel_format = SG_PIXELFORMAT_RGBA8;
+    pipeline_desc.depth.pixel_format = SG_PIXELFORMAT_DEPTH;
+    r->layer_pipeline = sg_make_pipeline(&pipeline_desc);
+    
     /* Create sampler */
     r->sampler = sg_make_sampler(&(sg_sampler_desc){
         .min_filter = SG_FILTER_LINEAR,
@@ -218,11 +246,9 @@ MinirendTextRenderer *minirend_text_renderer_create(MinirendFontCache *font_cach
         .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
     });
     
-    /* Create dynamic vertex buffer */
-    r->vbuf = sg_make_buffer(&(sg_buffer_desc){
-        .size = MAX_GLYPHS * VERTICES_PER_GLYPH * sizeof(TextVertex),
-        .usage = SG_USAGE_STREAM,
-    });
+    /* Create streaming vertex buffer (one batch's worth to start, grows) */
+    r->vstream = minirend_stream_buffer_create(
+        MAX_GLYPHS * VERTICES_PER_GLYPH * sizeof(TextVertex));
     
     /* Create static index buffer */
     uint16_t *indices = calloc(MAX_GLYPHS * INDICES_PER_GLYPH, sizeof(uint16_t));
@@ -246,19 +272,43 @@ MinirendTextRenderer *minirend_text_renderer_create(MinirendFontCache *font_cach
         free(indices);
     }
     
-    /* Set up bindings */
-    r->bindings.vertex_buffers[0] = r->vbuf;
+    /* Set up bindings (vertex buffer/offset are set per flush) */
     r->bindings.index_buffer = r->ibuf;
     r->bindings.fs.samplers[0] = r->sampler;
     
     return r;
 }
 
+MinirendTextRenderer *minirend_text_renderer_create_soft(MinirendFontCache *font_cache,
+                                                        MinirendSoftRaster *raster) {
+    if (!font_cache || !raster) return NULL;
+    
+    MinirendTextRenderer *r = calloc(1, sizeof(MinirendTextRenderer));
+    if (!r) return NULL;
+    
+    r->vertices = calloc(MAX_GLYPHS * VERTICES_PER_GLYPH, sizeof(TextVertex));
+    if (!r->vertices) {
+        free(r);
+        return NULL;
+    }
+    
+    r->font_cache = font_cache;
+    r->soft = raster;
+    return r;
+}
+
 void minirend_text_renderer_destroy(MinirendTextRenderer *r) {
     if (!r) return;
     
-    sg_destroy_buffer(r->vbuf);
+    if (r->soft) {
+        free(r->vertices);
+        free(r);
+        return;
+    }
+    
+    minirend_stream_buffer_destroy(r->vstream);
     sg_destroy_buffer(r->ibuf);
+    sg_destroy_pipeline(r->layer_pipeline);
     sg_destroy_pipeline(r->pipeline);
     sg_destroy_shader(r->shader);
     sg_destroy_sampler(r->sampler);
@@ -279,32 +329,81 @@ void minirend_text_renderer_begin(MinirendTextRenderer *r,
     r->viewport_height = viewport_height;
     r->vertex_count = 0;
     r->glyph_count = 0;
+    r->depth = 0.0f;
+    r->placeholders = false;
     r->in_frame = true;
+    r->to_layer = false;
+}
+
+void minirend_text_renderer_begin_layer(MinirendTextRenderer *r,
+                                        float width, float height) {
+    if (!r) return;
+    
+    minirend_text_renderer_begin(r, width, height);
+    r->to_layer = true;
+}
+
+/* Hand the batched glyph quads to the CPU rasterizer, sampling the atlas
+ * directly. Vertex 0 is top-left, vertex 2 bottom-right. */
+static void flush_batch_soft(MinirendTextRenderer *r) {
+    int atlas_size = 0;
+    const uint8_t *atlas = minirend_font_cache_get_atlas_data(r->font_cache,
+                                                              r->page,
+                                                              &atlas_size);
+    if (!atlas) return;
+    
+    for (int g = 0; g < r->glyph_count; g++) {
+        const TextVertex *v = &r->vertices[g * VERTICES_PER_GLYPH];
+        if (v[0].sdf > 0.0f) {
+            minirend_soft_raster_draw_sdf(r->soft,
+                                          v[0].x, v[0].y, v[2].x, v[2].y,
+                                          v[0].u, v[0].v, v[2].u, v[2].v,
+                                          atlas, atlas_size, v[0].sdf, v[0].z,
+                                          v[0].r, v[0].g, v[0].b, v[0].a);
+            continue;
+        }
+        minirend_soft_raster_draw_coverage(r->soft,
+                                           v[0].x, v[0].y, v[2].x, v[2].y,
+                                           v[0].u, v[0].v, v[2].u, v[2].v,
+                                           atlas, atlas_size, v[0].z,
+                                           v[0].r, v[0].g, v[0].b, v[0].a);
+    }
 }
 
 static void flush_batch(MinirendTextRenderer *r) {
     if (!r || r->glyph_count == 0) return;
     
-    /* Get atlas texture */
-    uint32_t tex_id = minirend_font_cache_get_texture(r->font_cache);
-    r->bindings.fs.images[0] = (sg_image){ tex_id };
-    
-    /* Upload vertices */
-    sg_update_buffer(r->vbuf, &(sg_range){
-        .ptr = r->vertices,
-        .size = r->vertex_count * sizeof(TextVertex),
-    });
-    
-    /* Apply pipeline and bindings */
-    sg_apply_pipeline(r->pipeline);
-    sg_apply_bindings(&r->bindings);
+    if (r->soft) {
+        flush_batch_soft(r);
+        r->vertex_count = 0;
+        r->glyph_count = 0;
+        return;
+    }
     
-    /* Set viewport uniform */
-    float viewport[2] = { r->viewport_width, r->viewport_height };
-    sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, &SG_RANGE(viewport));
+    /* Get atlas page texture */
+    uint32_t tex_id = minirend_font_cache_get_texture(r->font_cache, r->page);
+    r->bindings.fs.images[0] = (sg_image){ tex_id };
     
-    /* Draw */
-    sg_draw(0, r->glyph_count * INDICES_PER_GLYPH, 1);
+    /* Upload vertices as a new segment of the per-frame stream */
+    uint32_t vbuf_id = 0;
+    int vbuf_offset = 0;
+    if (minirend_stream_buffer_append(r->vstream, r->vertices,
+                                      r->vertex_count * sizeof(TextVertex),
+                                      &vbuf_id, &vbuf_offset)) {
+        r->bindings.vertex_buffers[0] = (sg_buffer){ vbuf_id };
+        r->bindings.vertex_buffer_offsets[0] = vbuf_offset;
+        
+        /* Apply pipeline and bindings */
+        sg_apply_pipeline(r->to_layer ? r->layer_pipeline : r->pipeline);
+        sg_apply_bindings(&r->bindings);
+        
+        /* Set viewport uniform */
+        float viewport[2] = { r->viewport_width, r->viewport_height };
+        sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, &SG_RANGE(viewport));
+        
+        /* Draw */
+        sg_draw(0, r->glyph_count * INDICES_PER_GLYPH, 1);
+    }
     
     /* Reset batch */
     r->vertex_count = 0;
@@ -322,37 +421,45 @@ void minirend_text_renderer_end(MinirendTextRenderer *r) {
  * Drawing Functions
  * ============================================================================ */
 
-static void push_glyph_quad(MinirendTextRenderer *r,
+static void push_glyph_quad(MinirendTextRenderer *r, int page, float sdf,
                             float x0, float y0, float x1, float y1,
                             float u0, float v0, float u1, float v1,
                             float cr, float cg, float cb, float ca) {
-    if (!r || r->glyph_count >= MAX_GLYPHS) {
+    /* A batch samples a single atlas page */
+    if (page != r->page) {
+        flush_batch(r);
+        r->page = page;
+    }
+    if (r->glyph_count >= MAX_GLYPHS) {
         flush_batch(r);
         if (r->glyph_count >= MAX_GLYPHS) return;
     }
     
     TextVertex *v = &r->vertices[r->vertex_count];
+    float z = r->depth;
     
     /* Top-left */
-    v[0].x = x0; v[0].y = y0;
+    v[0].x = x0; v[0].y = y0; v[0].z = z;
     v[0].u = u0; v[0].v = v0;
     v[0].r = cr; v[0].g = cg; v[0].b = cb; v[0].a = ca;
     
     /* Top-right */
-    v[1].x = x1; v[1].y = y0;
+    v[1].x = x1; v[1].y = y0; v[1].z = z;
     v[1].u = u1; v[1].v = v0;
     v[1].r = cr; v[1].g = cg; v[1].b = cb; v[1].a = ca;
     
     /* Bottom-right */
-    v[2].x = x1; v[2].y = y1;
+    v[2].x = x1; v[2].y = y1; v[2].z = z;
     v[2].u = u1; v[2].v = v1;
     v[2].r = cr; v[2].g = cg; v[2].b = cb; v[2].a = ca;
     
     /* Bottom-left */
-    v[3].x = x0; v[3].y = y1;
+    v[3].x = x0; v[3].y = y1; v[3].z = z;
     v[3].u = u0; v[3].v = v1;
     v[3].r = cr; v[3].g = cg; v[3].b = cb; v[3].a = ca;
     
+    v[0].sdf = v[1].sdf = v[2].sdf = v[3].sdf = sdf;
+    
     r->vertex_count += 4;
     r->glyph_count++;
 }
@@ -365,38 +472,46 @@ void minirend_text_draw_with_font(MinirendTextRenderer *r,
                                   MinirendColor color) {
     if (!r || !text) return;
     
-    (void)font_weight;  /* TODO: select font variant by weight */
+    /* Unspecified fonts: the default family's face for this weight */
+    if (font_id < 0) {
+        font_id = minirend_font_cache_match_face(r->font_cache, NULL, font_weight, false);
+    }
     
     float cr = color.r / 255.0f;
     float cg = color.g / 255.0f;
     float cb = color.b / 255.0f;
     float ca = color.a / 255.0f;
     
-    if (len < 0) len = (int32_t)strlen(text);
-    
-    float cursor_x = x;
+    /* Shaped (or fetched from the run cache, usually filled by layout) */
+    MinirendShapedRun run;
+    if (!minirend_font_cache_shape(r->font_cache, font_id, text, len,
+                                   font_size, &run)) {
+        return;
+    }
     
-    for (int32_t i = 0; i < len; i++) {
-        int codepoint = (unsigned char)text[i];
-        
+    for (int i = 0; i < run.glyph_count; i++) {
         MinirendGlyph glyph;
-        if (!minirend_font_cache_get_glyph(r->font_cache, font_id, codepoint,
-                                          font_size, &glyph)) {
+        if (!minirend_font_cache_get_glyph_by_index(r->font_cache, run.glyphs[i].font_id,
+                                                   run.glyphs[i].glyph,
+                                                   font_size, &glyph)) {
             continue;
         }
         
+        if (glyph.placeholder) r->placeholders = true;
+        
+        /* Whitespace (or a bitmap still in flight) has nothing to draw */
+        if (glyph.page < 0) continue;
+        
         /* Calculate quad position */
-        float x0 = cursor_x + glyph.x_offset;
+        float x0 = x + run.glyphs[i].x + glyph.x_offset;
         float y0 = y + glyph.y_offset;
         float x1 = x0 + glyph.width;
         float y1 = y0 + glyph.height;
         
         /* Draw glyph quad */
-        push_glyph_quad(r, x0, y0, x1, y1,
+        push_glyph_quad(r, glyph.page, glyph.sdf_edge, x0, y0, x1, y1,
                         glyph.u0, glyph.v0, glyph.u1, glyph.v1,
                         cr, cg, cb, ca);
-        
-        cursor_x += glyph.advance;
     }
 }
 
@@ -408,6 +523,15 @@ void minirend_text_draw(MinirendTextRenderer *r,
     minirend_text_draw_with_font(r, -1, text, len, x, y, font_size, font_weight, color);
 }
 
+bool minirend_text_renderer_drew_placeholders(const MinirendTextRenderer *r) {
+    return r && r->placeholders;
+}
+
+void minirend_text_set_depth(MinirendTextRenderer *r, float depth) {
+    if (!r) return;
+    r->depth = depth;
+}
+
 void minirend_text_measure(MinirendTextRenderer *r,
                            const char *text, int32_t len,
                            float font_size, int font_weight,
@@ -418,8 +542,8 @@ void minirend_text_measure(MinirendTextRenderer *r,
         return;
     }
     
-    (void)font_weight;
-    minirend_font_cache_measure_text(r->font_cache, -1, text, len,
+    int font_id = minirend_font_cache_match_face(r->font_cache, NULL, font_weight, false);
+    minirend_font_cache_measure_text(r->font_cache, font_id, text, len,
                                      font_size, out_width, out_height);
 }
 
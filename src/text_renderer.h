@@ -15,6 +15,7 @@
 
 /* Forward declarations */
 typedef struct MinirendFontCache MinirendFontCache;
+typedef struct MinirendSoftRaster MinirendSoftRaster;
 
 /* ============================================================================
  * Text Renderer Context
@@ -26,6 +27,11 @@ typedef struct MinirendTextRenderer MinirendTextRenderer;
  * font_cache is borrowed (not owned). */
 MinirendTextRenderer *minirend_text_renderer_create(MinirendFontCache *font_cache);
 
+/* Create a text renderer that rasterizes on the CPU into `raster`.
+ * font_cache and raster are borrowed. Needs no graphics context. */
+MinirendTextRenderer *minirend_text_renderer_create_soft(MinirendFontCache *font_cache,
+                                                        MinirendSoftRaster *raster);
+
 /* Destroy the text renderer and free GPU resources. */
 void minirend_text_renderer_destroy(MinirendTextRenderer *renderer);
 
@@ -33,6 +39,12 @@ void minirend_text_renderer_destroy(MinirendTextRenderer *renderer);
 void minirend_text_renderer_begin(MinirendTextRenderer *renderer,
                                   float viewport_width, float viewport_height);
 
+/* Begin drawing into a compositor layer instead of the swapchain.
+ * Call inside minirend_compositor_begin_layer(); width/height are the
+ * layer's texture size. Finish with minirend_text_renderer_end(). */
+void minirend_text_renderer_begin_layer(MinirendTextRenderer *renderer,
+                                        float width, float height);
+
 /* End the frame and flush all batched draws. */
 void minirend_text_renderer_end(MinirendTextRenderer *renderer);
 
@@ -55,6 +67,15 @@ void minirend_text_draw_with_font(MinirendTextRenderer *renderer,
                                   float font_size, int font_weight,
                                   MinirendColor color);
 
+/* True if text drawn since begin used stand-ins for glyphs still being
+ * rasterized (see minirend_font_cache_start_workers). Cached output
+ * should be repainted on a later frame. */
+bool minirend_text_renderer_drew_placeholders(const MinirendTextRenderer *renderer);
+
+/* Set the depth of subsequent glyphs (0 = nearest, 1 = farthest; default 0).
+ * Glyphs are depth tested against opaque content with LESS_EQUAL. */
+void minirend_text_set_depth(MinirendTextRenderer *renderer, float depth);
+
 /* Measure text dimensions. */
 void minirend_text_measure(MinirendTextRenderer *renderer,
                            const char *text, int32_t len,
@@ -2,59 +2,370 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 typedef struct UiNode {
     int32_t     id;
     MinirendRect bounds;
+    bool        in_use;
     bool        has_bounds;
     bool        visible;
     bool        pointer_events;
     uint32_t    order; /* larger = on top */
+    uint32_t    pass;  /* last bounds pass that set it */
+    int32_t     next_free; /* free list link while !in_use */
+    bool        in_grid;
+    int16_t     cx0, cy0, cx1, cy1; /* grid cells covered while in_grid */
 } UiNode;
 
+/* Node ids map to slots in g_nodes. Ids are small sequential integers
+ * (layout and DOM counters), so they index g_dense directly; ids beyond
+ * DENSE_ID_LIMIT (or negative) go through an open-addressing table.
+ * Removed slots are chained on a free list and reused. */
+#define DENSE_ID_LIMIT (1 << 20)
+
+#define SPARSE_EMPTY     (-1)
+#define SPARSE_TOMBSTONE (-2)
+
+typedef struct {
+    int32_t id;
+    int32_t slot; /* or SPARSE_EMPTY / SPARSE_TOMBSTONE */
+} SparseEntry;
+
 static UiNode   *g_nodes = NULL;
-static int       g_nodes_len = 0;
+static int       g_nodes_len = 0; /* slots ever used */
 static int       g_nodes_cap = 0;
+static int32_t   g_free_head = -1;
 static uint32_t  g_next_order = 1;
+static uint32_t  g_pass = 0;
+static uint32_t  g_last_order = 0; /* node last given bounds this pass */
+
+static int32_t  *g_dense = NULL; /* id -> slot + 1 (0 = none) */
+static int32_t   g_dense_cap = 0;
+
+static SparseEntry *g_sparse = NULL;
+static uint32_t     g_sparse_mask = 0;
+static uint32_t     g_sparse_used = 0; /* live entries + tombstones */
 
 static int g_viewport_w = 0;
 static int g_viewport_h = 0;
 
+/* Hit testing goes through a uniform grid over the viewport. Each cell
+ * lists the slots whose bounds overlap it, sorted by order, so the
+ * topmost hit is the first match scanning a cell from the back. Bounds
+ * outside the viewport are clamped into the edge cells. */
+#define GRID_CELL_SIZE 64.0f
+#define GRID_MAX_CELLS 128 /* per axis; cells grow for larger viewports */
+
+typedef struct {
+    int32_t *slots;
+    int      len;
+    int      cap;
+} GridCell;
+
+static GridCell *g_cells = NULL;
+static int       g_grid_cols = 0;
+static int       g_grid_rows = 0;
+static float     g_cell_w = GRID_CELL_SIZE;
+static float     g_cell_h = GRID_CELL_SIZE;
+
+static bool is_dense_id(int32_t id) {
+    return id >= 0 && id < DENSE_ID_LIMIT;
+}
+
+static uint32_t id_hash(int32_t id) {
+    uint32_t h = (uint32_t)id * 0x9E3779B1u;
+    return h ^ (h >> 16);
+}
+
+static int32_t sparse_find(int32_t id) {
+    if (!g_sparse) return -1;
+    uint32_t i = id_hash(id) & g_sparse_mask;
+    while (g_sparse[i].slot != SPARSE_EMPTY) {
+        if (g_sparse[i].slot >= 0 && g_sparse[i].id == id) return (int32_t)i;
+        i = (i + 1) & g_sparse_mask;
+    }
+    return -1;
+}
+
+static bool sparse_insert(int32_t id, int32_t slot) {
+    /* Keep at most half full, counting tombstones; rebuilding drops them */
+    if (!g_sparse || (g_sparse_used + 1) * 2 > g_sparse_mask + 1) {
+        uint32_t old_cap = g_sparse ? g_sparse_mask + 1 : 0;
+        uint32_t new_cap = old_cap ? old_cap * 2 : 64;
+        SparseEntry *entries = (SparseEntry *)malloc((size_t)new_cap * sizeof(SparseEntry));
+        if (!entries) return false;
+        for (uint32_t i = 0; i < new_cap; i++) entries[i].slot = SPARSE_EMPTY;
+
+        SparseEntry *old = g_sparse;
+        g_sparse = entries;
+        g_sparse_mask = new_cap - 1;
+        g_sparse_used = 0;
+        for (uint32_t i = 0; i < old_cap; i++) {
+            if (old[i].slot >= 0) sparse_insert(old[i].id, old[i].slot);
+        }
+        free(old);
+    }
+
+    uint32_t i = id_hash(id) & g_sparse_mask;
+    while (g_sparse[i].slot >= 0) i = (i + 1) & g_sparse_mask;
+    if (g_sparse[i].slot == SPARSE_EMPTY) g_sparse_used++;
+    g_sparse[i].id = id;
+    g_sparse[i].slot = slot;
+    return true;
+}
+
 static UiNode *find_node(int32_t id) {
-    for (int i = 0; i < g_nodes_len; i++) {
-        if (g_nodes[i].id == id) return &g_nodes[i];
+    if (is_dense_id(id)) {
+        if (id >= g_dense_cap || g_dense[id] == 0) return NULL;
+        return &g_nodes[g_dense[id] - 1];
     }
-    return NULL;
+    int32_t e = sparse_find(id);
+    return e >= 0 ? &g_nodes[g_sparse[e].slot] : NULL;
 }
 
-static UiNode *ensure_node(int32_t id) {
-    UiNode *n = find_node(id);
-    if (n) return n;
+static bool map_id(int32_t id, int32_t slot) {
+    if (!is_dense_id(id)) return sparse_insert(id, slot);
+
+    if (id >= g_dense_cap) {
+        int32_t new_cap = g_dense_cap ? g_dense_cap : 256;
+        while (new_cap <= id) new_cap *= 2;
+        int32_t *nd = (int32_t *)realloc(g_dense, (size_t)new_cap * sizeof(int32_t));
+        if (!nd) return false;
+        memset(nd + g_dense_cap, 0, (size_t)(new_cap - g_dense_cap) * sizeof(int32_t));
+        g_dense = nd;
+        g_dense_cap = new_cap;
+    }
+    g_dense[id] = slot + 1;
+    return true;
+}
+
+static int32_t alloc_slot(void) {
+    if (g_free_head >= 0) {
+        int32_t slot = g_free_head;
+        g_free_head = g_nodes[slot].next_free;
+        return slot;
+    }
 
     if (g_nodes_len == g_nodes_cap) {
         int new_cap = g_nodes_cap ? (g_nodes_cap * 2) : 16;
         UiNode *nn = (UiNode *)realloc(g_nodes, (size_t)new_cap * sizeof(UiNode));
-        if (!nn) return NULL;
+        if (!nn) return -1;
         g_nodes = nn;
         g_nodes_cap = new_cap;
     }
+    return g_nodes_len++;
+}
+
+static UiNode *ensure_node(int32_t id) {
+    UiNode *n = find_node(id);
+    if (n) return n;
+
+    int32_t slot = alloc_slot();
+    if (slot < 0) return NULL;
+    if (!map_id(id, slot)) {
+        g_nodes[slot].in_use = false;
+        g_nodes[slot].next_free = g_free_head;
+        g_free_head = slot;
+        return NULL;
+    }
 
     UiNode fresh;
     memset(&fresh, 0, sizeof(fresh));
     fresh.id = id;
+    fresh.in_use = true;
     fresh.visible = true;
     fresh.pointer_events = true;
     fresh.order = g_next_order++;
+    fresh.next_free = -1;
 
-    g_nodes[g_nodes_len++] = fresh;
-    return &g_nodes[g_nodes_len - 1];
+    g_nodes[slot] = fresh;
+    return &g_nodes[slot];
 }
 
-void minirend_ui_tree_init(void) {
+static int cell_coord(float v, float cell, int count) {
+    if (!(v > 0.0f)) return 0; /* also NaN */
+    float c = v / cell;
+    if (c >= (float)(count - 1)) return count - 1;
+    return (int)c;
+}
+
+static void cell_remove(GridCell *cell, int32_t slot) {
+    for (int i = cell->len - 1; i >= 0; i--) {
+        if (cell->slots[i] == slot) {
+            memmove(&cell->slots[i], &cell->slots[i + 1],
+                    (size_t)(cell->len - i - 1) * sizeof(int32_t));
+            cell->len--;
+            return;
+        }
+    }
+}
+
+static bool cell_insert(GridCell *cell, int32_t slot) {
+    if (cell->len == cell->cap) {
+        int new_cap = cell->cap ? (cell->cap * 2) : 8;
+        int32_t *ns = (int32_t *)realloc(cell->slots, (size_t)new_cap * sizeof(int32_t));
+        if (!ns) return false;
+        cell->slots = ns;
+        cell->cap = new_cap;
+    }
+
+    /* Usually the node was just raised to the top, so this appends */
+    uint32_t order = g_nodes[slot].order;
+    int i = cell->len;
+    while (i > 0 && g_nodes[cell->slots[i - 1]].order > order) i--;
+    memmove(&cell->slots[i + 1], &cell->slots[i], (size_t)(cell->len - i) * sizeof(int32_t));
+    cell->slots[i] = slot;
+    cell->len++;
+    return true;
+}
+
+static void grid_remove(int32_t slot) {
+    UiNode *n = &g_nodes[slot];
+    if (!n->in_grid) return;
+    for (int cy = n->cy0; cy <= n->cy1; cy++) {
+        for (int cx = n->cx0; cx <= n->cx1; cx++) {
+            cell_remove(&g_cells[cy * g_grid_cols + cx], slot);
+        }
+    }
+    n->in_grid = false;
+}
+
+/* The cells a node should be listed in; false if it takes no hits. */
+static bool node_cells(const UiNode *n, int *cx0, int *cy0, int *cx1, int *cy1) {
+    if (!g_cells || !n->has_bounds || !n->visible || !n->pointer_events) return false;
+    if (!(n->bounds.w > 0.0f) || !(n->bounds.h > 0.0f)) return false;
+
+    *cx0 = cell_coord(n->bounds.x, g_cell_w, g_grid_cols);
+    *cy0 = cell_coord(n->bounds.y, g_cell_h, g_grid_rows);
+    *cx1 = cell_coord(n->bounds.x + n->bounds.w, g_cell_w, g_grid_cols);
+    *cy1 = cell_coord(n->bounds.y + n->bounds.h, g_cell_h, g_grid_rows);
+    return true;
+}
+
+static void grid_insert(int32_t slot) {
+    UiNode *n = &g_nodes[slot];
+    int cx0, cy0, cx1, cy1;
+    if (!node_cells(n, &cx0, &cy0, &cx1, &cy1)) return;
+
+    n->cx0 = (int16_t)cx0;
+    n->cy0 = (int16_t)cy0;
+    n->cx1 = (int16_t)cx1;
+    n->cy1 = (int16_t)cy1;
+    n->in_grid = true;
+
+    for (int cy = n->cy0; cy <= n->cy1; cy++) {
+        for (int cx = n->cx0; cx <= n->cx1; cx++) {
+            if (!cell_insert(&g_cells[cy * g_grid_cols + cx], slot)) {
+                /* Out of memory: keep the node out of the grid entirely */
+                grid_remove(slot);
+                return;
+            }
+        }
+    }
+}
+
+/* After a bounds change that kept the node's order: only the cells it
+ * left or entered change (its position in the others is still right). */
+static void grid_move(int32_t slot) {
+    UiNode *n = &g_nodes[slot];
+    int cx0, cy0, cx1, cy1;
+    if (!n->in_grid || !node_cells(n, &cx0, &cy0, &cx1, &cy1)) {
+        grid_remove(slot);
+        grid_insert(slot);
+        return;
+    }
+
+    int ox0 = n->cx0, oy0 = n->cy0, ox1 = n->cx1, oy1 = n->cy1;
+    if (ox0 == cx0 && oy0 == cy0 && ox1 == cx1 && oy1 == cy1) return;
+
+    for (int cy = oy0; cy <= oy1; cy++) {
+        for (int cx = ox0; cx <= ox1; cx++) {
+            if (cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1) continue;
+            cell_remove(&g_cells[cy * g_grid_cols + cx], slot);
+        }
+    }
+    n->cx0 = (int16_t)cx0;
+    n->cy0 = (int16_t)cy0;
+    n->cx1 = (int16_t)cx1;
+    n->cy1 = (int16_t)cy1;
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            if (cx >= ox0 && cx <= ox1 && cy >= oy0 && cy <= oy1) continue;
+            if (!cell_insert(&g_cells[cy * g_grid_cols + cx], slot)) {
+                grid_remove(slot); /* cells it never reached don't list it */
+                return;
+            }
+        }
+    }
+}
+
+static int compare_slot_order(const void *a, const void *b) {
+    uint32_t oa = g_nodes[*(const int32_t *)a].order;
+    uint32_t ob = g_nodes[*(const int32_t *)b].order;
+    return (oa > ob) - (oa < ob);
+}
+
+static void free_grid(void) {
+    for (int i = 0; i < g_grid_cols * g_grid_rows; i++) free(g_cells[i].slots);
+    free(g_cells);
+    g_cells = NULL;
+    g_grid_cols = 0;
+    g_grid_rows = 0;
+}
+
+/* Size the grid to the viewport and reinsert every node. */
+static void rebuild_grid(void) {
+    int w = g_viewport_w > 0 ? g_viewport_w : 1;
+    int h = g_viewport_h > 0 ? g_viewport_h : 1;
+    int cols = (int)ceilf((float)w / GRID_CELL_SIZE);
+    int rows = (int)ceilf((float)h / GRID_CELL_SIZE);
+    if (cols > GRID_MAX_CELLS) cols = GRID_MAX_CELLS;
+    if (rows > GRID_MAX_CELLS) rows = GRID_MAX_CELLS;
+
+    if (cols != g_grid_cols || rows != g_grid_rows) {
+        free_grid();
+        g_cells = (GridCell *)calloc((size_t)cols * (size_t)rows, sizeof(GridCell));
+        if (!g_cells) return;
+        g_grid_cols = cols;
+        g_grid_rows = rows;
+    } else {
+        for (int i = 0; i < cols * rows; i++) g_cells[i].len = 0;
+    }
+    g_cell_w = (float)w / (float)cols;
+    g_cell_h = (float)h / (float)rows;
+
+    /* Insert in z-order so every cell_insert appends */
+    int32_t *slots = (int32_t *)malloc((size_t)(g_nodes_len ? g_nodes_len : 1) * sizeof(int32_t));
+    int count = 0;
+    for (int i = 0; i < g_nodes_len; i++) {
+        g_nodes[i].in_grid = false;
+        if (g_nodes[i].in_use && slots) slots[count++] = i;
+    }
+    if (!slots) return;
+    qsort(slots, (size_t)count, sizeof(int32_t), compare_slot_order);
+    for (int i = 0; i < count; i++) grid_insert(slots[i]);
+    free(slots);
+}
+
+static void reset_tables(void) {
     g_nodes_len = 0;
+    g_free_head = -1;
+    if (g_dense) memset(g_dense, 0, (size_t)g_dense_cap * sizeof(int32_t));
+    free(g_sparse);
+    g_sparse = NULL;
+    g_sparse_mask = 0;
+    g_sparse_used = 0;
+    for (int i = 0; i < g_grid_cols * g_grid_rows; i++) g_cells[i].len = 0;
+}
+
+void minirend_ui_tree_init(void) {
+    reset_tables();
     g_next_order = 1;
+    g_last_order = 0;
     g_viewport_w = 0;
     g_viewport_h = 0;
+    rebuild_grid();
 
     /* Ensure document/body exist. */
     minirend_ui_tree_register_node(MINIREND_NODE_DOCUMENT);
@@ -62,10 +373,14 @@ void minirend_ui_tree_init(void) {
 }
 
 void minirend_ui_tree_shutdown(void) {
+    reset_tables();
     free(g_nodes);
     g_nodes = NULL;
-    g_nodes_len = 0;
     g_nodes_cap = 0;
+    free(g_dense);
+    g_dense = NULL;
+    g_dense_cap = 0;
+    free_grid();
 }
 
 void minirend_ui_tree_set_viewport(int width_css_px, int height_css_px) {
@@ -78,18 +393,69 @@ void minirend_ui_tree_set_viewport(int width_css_px, int height_css_px) {
         body->bounds = (MinirendRect){ .x = 0, .y = 0, .w = (float)g_viewport_w, .h = (float)g_viewport_h };
         body->has_bounds = true;
     }
+
+    /* Cell sizes follow the viewport, so every node is reinserted */
+    rebuild_grid();
 }
 
 void minirend_ui_tree_register_node(int32_t node_id) {
     (void)ensure_node(node_id);
 }
 
+void minirend_ui_tree_remove_node(int32_t node_id) {
+    UiNode *n = find_node(node_id);
+    if (!n) return;
+
+    if (is_dense_id(node_id)) {
+        g_dense[node_id] = 0;
+    } else {
+        g_sparse[sparse_find(node_id)].slot = SPARSE_TOMBSTONE;
+    }
+
+    int32_t slot = (int32_t)(n - g_nodes);
+    grid_remove(slot);
+    n->in_use = false;
+    n->next_free = g_free_head;
+    g_free_head = slot;
+}
+
+void minirend_ui_tree_begin_bounds(void) {
+    g_pass++;
+    g_last_order = 0;
+}
+
+void minirend_ui_tree_end_bounds(void) {
+    /* Nodes the pass skipped are no longer painted; they used to end up
+     * below every painted one, so they could not take hits either. */
+    for (int i = 0; i < g_nodes_len; i++) {
+        if (g_nodes[i].in_use && g_nodes[i].in_grid && g_nodes[i].pass != g_pass) grid_remove(i);
+    }
+}
+
 void minirend_ui_tree_set_bounds(int32_t node_id, MinirendRect r) {
     UiNode *n = ensure_node(node_id);
     if (!n) return;
+
+    /* Painted over a node it used to be below: raise it to the top. */
+    bool raise = n->order < g_last_order;
+    /* (a node the last pass skipped was dropped from the grid) */
+    bool same = n->has_bounds && n->pass + 1 == g_pass &&
+                n->bounds.x == r.x && n->bounds.y == r.y &&
+                n->bounds.w == r.w && n->bounds.h == r.h;
+    if (raise) n->order = g_next_order++;
+    g_last_order = n->order;
+    n->pass = g_pass;
+    if (same && !raise) return;
+
+    int32_t slot = (int32_t)(n - g_nodes);
     n->bounds = r;
     n->has_bounds = true;
-    n->order = g_next_order++;
+    if (raise) {
+        grid_remove(slot);
+        grid_insert(slot);
+    } else {
+        grid_move(slot);
+    }
 }
 
 bool minirend_ui_tree_get_bounds(int32_t node_id, MinirendRect *out_r) {
@@ -104,21 +470,18 @@ static bool rect_contains(MinirendRect r, float x, float y) {
 }
 
 int32_t minirend_ui_hit_test(float x_css_px, float y_css_px) {
-    /* Z-order: pick topmost node that contains point. */
-    uint32_t best_order = 0;
-    int32_t best_id = MINIREND_NODE_BODY;
+    if (!g_cells) return MINIREND_NODE_BODY;
 
-    for (int i = 0; i < g_nodes_len; i++) {
-        UiNode *n = &g_nodes[i];
-        if (!n->visible || !n->pointer_events || !n->has_bounds) continue;
-        if (!rect_contains(n->bounds, x_css_px, y_css_px)) continue;
-        if (n->order >= best_order) {
-            best_order = n->order;
-            best_id = n->id;
-        }
+    /* Z-order: the topmost node containing the point is the last match
+     * in its cell. */
+    int cx = cell_coord(x_css_px, g_cell_w, g_grid_cols);
+    int cy = cell_coord(y_css_px, g_cell_h, g_grid_rows);
+    const GridCell *cell = &g_cells[cy * g_grid_cols + cx];
+
+    for (int i = cell->len - 1; i >= 0; i--) {
+        const UiNode *n = &g_nodes[cell->slots[i]];
+        if (rect_contains(n->bounds, x_css_px, y_css_px)) return n->id;
     }
 
-    return best_id;
+    return MINIREND_NODE_BODY;
 }
-
-
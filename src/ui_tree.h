@@ -28,7 +28,14 @@ void    minirend_ui_tree_shutdown(void);
 
 void    minirend_ui_tree_set_viewport(int width_css_px, int height_css_px);
 void    minirend_ui_tree_register_node(int32_t node_id);
+void    minirend_ui_tree_remove_node(int32_t node_id);
+/* Bounds are set back to front between begin_bounds and end_bounds, each
+ * node landing on top of the ones set before it in the pass. Nodes whose
+ * bounds and relative order did not change since the last pass cost
+ * nothing; nodes the pass skips stop taking hits. */
+void    minirend_ui_tree_begin_bounds(void);
 void    minirend_ui_tree_set_bounds(int32_t node_id, MinirendRect r);
+void    minirend_ui_tree_end_bounds(void);
 bool    minirend_ui_tree_get_bounds(int32_t node_id, MinirendRect *out_r);
 
 /* Returns node_id hit at (x,y) in CSS pixels. Always returns at least BODY. */